@@ -0,0 +1,326 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/compression/codec.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace compression = keycap::root::compression;
+
+namespace
+{
+    enum class corpus : int64_t
+    {
+        // Short chat and text packets
+        Text,
+        // Small binary packets as sent for movement updates
+        Movement,
+        // A large XML document as used for configuration or bulk transfers
+        Xml,
+        // Incompressible data, e.g. already encrypted or compressed payloads
+        Random,
+    };
+
+    std::vector<uint8_t> make_text()
+    {
+        std::string const words[] = {"hello", "group", "raid", "tonight", "anyone", "LFG", "need", "heal", "tank", "dps",
+                                     "the",   "at",    "in",   "boss",    "loot",   "ok",  "lol",  "brb",  "wtb",  "gold"};
+
+        std::mt19937 rng{42};
+        std::string text;
+        while (text.size() < 200)
+        {
+            text += words[rng() % std::size(words)];
+            text += ' ';
+        }
+
+        return {text.begin(), text.end()};
+    }
+
+    std::vector<uint8_t> make_movement()
+    {
+        struct movement
+        {
+            uint64_t guid;
+            uint32_t flags;
+            uint32_t time;
+            float x, y, z, orientation;
+        };
+
+        std::vector<uint8_t> data;
+        for (uint32_t i = 0; i < 8; ++i)
+        {
+            movement update{0x0700000000001234, 0x1, 1000 + i * 50, 1234.5f + static_cast<float>(i) * 0.25f, -321.0f,
+                            42.0f, 1.5f};
+
+            auto position = data.size();
+            data.resize(position + sizeof(update));
+            std::memcpy(data.data() + position, &update, sizeof(update));
+        }
+
+        return data;
+    }
+
+    std::vector<uint8_t> make_xml()
+    {
+        std::string xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<items>\n";
+        for (int i = 0; xml.size() < 256 * 1024; ++i)
+        {
+            xml += "  <item id=\"" + std::to_string(i) + "\" quality=\"" + std::to_string(i % 5) + "\">\n";
+            xml += "    <name>Item " + std::to_string(i * 31 % 1000) + "</name>\n";
+            xml += "    <price>" + std::to_string(i * 17 % 10000) + "</price>\n";
+            xml += "  </item>\n";
+        }
+        xml += "</items>\n";
+
+        return {xml.begin(), xml.end()};
+    }
+
+    std::vector<uint8_t> make_random()
+    {
+        std::mt19937 rng{42};
+        std::vector<uint8_t> data(64 * 1024);
+        for (auto& byte : data)
+            byte = static_cast<uint8_t>(rng());
+
+        return data;
+    }
+
+    std::vector<uint8_t> const& get_corpus(corpus type)
+    {
+        static std::vector<uint8_t> const corpora[] = {make_text(), make_movement(), make_xml(), make_random()};
+        return corpora[static_cast<size_t>(type)];
+    }
+
+    char const* corpus_name(corpus type)
+    {
+        switch (type)
+        {
+            case corpus::Text:
+                return "text";
+            case corpus::Movement:
+                return "movement";
+            case corpus::Xml:
+                return "xml";
+            case corpus::Random:
+                return "random";
+        }
+
+        return "";
+    }
+
+    char const* codec_name(compression::codec_type type)
+    {
+        switch (type)
+        {
+            case compression::codec_type::None:
+                return "none";
+            case compression::codec_type::Zlib:
+                return "zlib";
+            case compression::codec_type::Lz4:
+                return "lz4";
+            case compression::codec_type::Zstd:
+                return "zstd";
+        }
+
+        return "";
+    }
+
+    // Arguments: codec_type, level, corpus
+    void codecs(benchmark::internal::Benchmark* benchmark)
+    {
+        benchmark->ArgNames({"codec", "level", "corpus"});
+
+        std::pair<compression::codec_type, int> const configurations[] = {
+            {compression::codec_type::Zlib, 1}, {compression::codec_type::Zlib, 8}, {compression::codec_type::Lz4, 0},
+            {compression::codec_type::Lz4, 9},  {compression::codec_type::Zstd, 1}, {compression::codec_type::Zstd, 3},
+            {compression::codec_type::Zstd, 19},
+        };
+
+        for (auto [type, level] : configurations)
+        {
+            for (auto type_of_corpus : {corpus::Text, corpus::Movement, corpus::Xml, corpus::Random})
+                benchmark->Args({static_cast<int64_t>(type), level, static_cast<int64_t>(type_of_corpus)});
+        }
+    }
+
+    // Returns the codec selected by the benchmark's arguments or skips the benchmark if it isn't supported
+    std::unique_ptr<compression::codec> make_codec(benchmark::State& state)
+    {
+        auto type = static_cast<compression::codec_type>(state.range(0));
+        auto type_of_corpus = static_cast<corpus>(state.range(2));
+        state.SetLabel(std::string{codec_name(type)} + "/" + corpus_name(type_of_corpus));
+
+        auto codec = compression::make_codec(type, static_cast<int>(state.range(1)));
+        if (!codec)
+            state.SkipWithError("Codec not supported by this build");
+
+        return codec;
+    }
+}
+
+static void codec_compress(benchmark::State& state)
+{
+    auto codec = make_codec(state);
+    if (!codec)
+        return;
+
+    auto const& data = get_corpus(static_cast<corpus>(state.range(2)));
+    std::vector<uint8_t> output(codec->bound(data.size()));
+    size_t compressed_size = 0;
+
+    for (auto _ : state)
+    {
+        auto size = codec->compress(data, output);
+        benchmark::DoNotOptimize(size);
+        compressed_size = size.value_or(data.size());
+    }
+
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(data.size()));
+    state.counters["ratio"] = static_cast<double>(data.size()) / static_cast<double>(compressed_size);
+}
+BENCHMARK(codec_compress)->Apply(codecs);
+
+static void codec_decompress(benchmark::State& state)
+{
+    auto codec = make_codec(state);
+    if (!codec)
+        return;
+
+    auto const& data = get_corpus(static_cast<corpus>(state.range(2)));
+    std::vector<uint8_t> compressed(codec->bound(data.size()));
+    compressed.resize(codec->compress(data, compressed).value_or(0));
+    std::vector<uint8_t> output(data.size());
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(codec->decompress(compressed, output));
+
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(data.size()));
+    state.counters["ratio"] = static_cast<double>(data.size()) / static_cast<double>(compressed.size());
+}
+BENCHMARK(codec_decompress)->Apply(codecs);
+
+// Includes the frame_header and the fallback to uncompressed frames, as used when sending packets
+static void codec_frame(benchmark::State& state)
+{
+    auto codec = make_codec(state);
+    if (!codec)
+        return;
+
+    auto const& data = get_corpus(static_cast<corpus>(state.range(2)));
+    size_t frame_size = 0;
+
+    for (auto _ : state)
+    {
+        auto frame = compression::compress(*codec, data);
+        frame_size = frame.size();
+        benchmark::DoNotOptimize(compression::decompress(frame));
+    }
+
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(data.size()));
+    state.counters["ratio"] = static_cast<double>(data.size()) / static_cast<double>(frame_size);
+}
+BENCHMARK(codec_frame)->Apply(codecs);
+
+// Arguments: codec_type, number of threads. Uses the XML corpus, repeated to a snapshot of 16 MiB
+static void codec_blocks(benchmark::State& state)
+{
+    auto codec = compression::make_codec(static_cast<compression::codec_type>(state.range(0)));
+    if (!codec)
+    {
+        state.SkipWithError("Codec not supported by this build");
+        return;
+    }
+
+    auto const& xml = get_corpus(corpus::Xml);
+    std::vector<uint8_t> data;
+    while (data.size() < (16 << 20))
+        data.insert(data.end(), xml.begin(), xml.end());
+
+    auto threads = static_cast<size_t>(state.range(1));
+    size_t compressed_size = 0;
+
+    for (auto _ : state)
+    {
+        auto compressed = compression::compress_blocks(*codec, data, threads);
+        compressed_size = compressed.size();
+        benchmark::DoNotOptimize(compression::decompress_blocks(compressed, threads));
+    }
+
+    state.SetLabel(codec_name(codec->type()));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(data.size()));
+    state.counters["ratio"] = static_cast<double>(data.size()) / static_cast<double>(compressed_size);
+}
+BENCHMARK(codec_blocks)
+    ->ArgNames({"codec", "threads"})
+    ->ArgsProduct({{1, 2, 3}, {1, 2, 4, 8}})
+    ->UseRealTime();
+
+// Arguments: codec_type, whether or not to use a dictionary trained from similar packets
+static void codec_dictionary(benchmark::State& state)
+{
+    auto type = static_cast<compression::codec_type>(state.range(0));
+
+    std::vector<std::vector<uint8_t>> packets;
+    for (int i = 0; i < 1000; ++i)
+    {
+        auto text = "character_update name=\"Player" + std::to_string(i % 50) + "\" zone=\"" + std::to_string(i % 7)
+                    + "\" level=" + std::to_string(i % 80) + " online=1";
+        packets.emplace_back(text.begin(), text.end());
+    }
+
+    std::unique_ptr<compression::codec> codec;
+    if (state.range(1) != 0)
+    {
+        std::vector<std::span<uint8_t const>> samples(packets.begin(), packets.end());
+        codec = compression::make_codec(
+            type, std::make_shared<compression::dictionary const>(compression::train_dictionary(samples)));
+    }
+    else
+    {
+        codec = compression::make_codec(type);
+    }
+
+    if (!codec)
+    {
+        state.SkipWithError("Codec not supported by this build");
+        return;
+    }
+
+    size_t packet = 0;
+    size_t input_size = 0;
+    size_t frame_size = 0;
+
+    for (auto _ : state)
+    {
+        auto& data = packets[packet++ % packets.size()];
+        auto frame = compression::compress(*codec, data);
+        benchmark::DoNotOptimize(compression::decompress(*codec, frame));
+
+        input_size += data.size();
+        frame_size += frame.size();
+    }
+
+    state.SetLabel(std::string{codec_name(type)} + (state.range(1) != 0 ? "/dictionary" : ""));
+    state.SetBytesProcessed(static_cast<int64_t>(input_size));
+    state.counters["ratio"] = static_cast<double>(input_size) / static_cast<double>(frame_size);
+}
+BENCHMARK(codec_dictionary)->ArgNames({"codec", "dictionary"})->ArgsProduct({{1, 3}, {0, 1}});
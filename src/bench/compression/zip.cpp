@@ -0,0 +1,105 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/compression/zip.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+namespace zip = keycap::root::compression::zip;
+
+namespace
+{
+    // Repetitive, text-like data as found in typical payloads
+    std::vector<uint8_t> make_payload(int64_t size)
+    {
+        std::string const text = "The quick brown fox jumps over the lazy dog. 0123456789 ";
+
+        std::vector<uint8_t> data(static_cast<size_t>(size));
+        for (size_t i = 0; i < data.size(); ++i)
+            data[i] = static_cast<uint8_t>(text[(i * 7 + i / 64) % text.size()]);
+
+        return data;
+    }
+
+    void payload_sizes(benchmark::internal::Benchmark* benchmark)
+    {
+        benchmark->RangeMultiplier(16)->Range(256, 4 << 20);
+    }
+}
+
+static void zip_compress(benchmark::State& state)
+{
+    auto data = make_payload(state.range(0));
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(zip::compress(data.begin(), data.end()));
+
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(zip_compress)->Apply(payload_sizes);
+
+static void zip_decompress(benchmark::State& state)
+{
+    auto data = make_payload(state.range(0));
+    auto compressed = zip::compress(data.begin(), data.end());
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(zip::decompress(compressed.begin(), compressed.end()));
+
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(zip_decompress)->Apply(payload_sizes);
+
+// The uncompressed size is known up front, as it is for most compressed packets
+static void zip_decompress_known_size(benchmark::State& state)
+{
+    auto data = make_payload(state.range(0));
+    auto compressed = zip::compress(data.begin(), data.end());
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(zip::decompress(compressed.begin(), compressed.end(), data.size()));
+
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(zip_decompress_known_size)->Apply(payload_sizes);
+
+static void zip_decompress_into(benchmark::State& state)
+{
+    auto data = make_payload(state.range(0));
+    auto compressed = zip::compress(data.begin(), data.end());
+    std::vector<uint8_t> output(data.size());
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(zip::decompress_into(compressed, output));
+
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(zip_decompress_into)->Apply(payload_sizes);
+
+// Arguments: size of the input, number of threads
+static void zip_compress_parallel(benchmark::State& state)
+{
+    auto data = make_payload(state.range(0));
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(zip::compress_parallel(data, 8, static_cast<size_t>(state.range(1))));
+
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(zip_compress_parallel)->ArgsProduct({{16 << 20}, {1, 2, 4, 8}})->UseRealTime();
@@ -0,0 +1,40 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/cryptography/ARC4.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+namespace crypto = keycap::root::cryptography;
+
+static void ARC4_process(benchmark::State& state)
+{
+    crypto::ARC4 arc4{std::vector<uint8>{
+        0xC2, 0xB3, 0x72, 0x3C, 0xC6, 0xAE, 0xD9, 0xB5, 0x34, 0x3C, 0x53, 0xEE, 0x2F, 0x43, 0x67, 0xCE}};
+
+    std::vector<uint8> data(static_cast<size_t>(state.range(0)), 0x42);
+
+    for (auto _ : state)
+    {
+        arc4.process(data.data(), data.size());
+        benchmark::DoNotOptimize(data.data());
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(ARC4_process)->RangeMultiplier(16)->Range(16, 64 << 10);
@@ -0,0 +1,76 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/network/broadcaster.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+namespace net = keycap::root::network;
+
+namespace
+{
+    class null_connection : public net::connection_base
+    {
+      public:
+        explicit null_connection(boost::asio::io_context& context)
+          : net::connection_base{boost::asio::ip::tcp::socket{context}, context}
+        {
+        }
+
+        void send(std::span<uint8_t> data) override
+        {
+            benchmark::DoNotOptimize(data.data());
+        }
+
+        void send(net::shared_buffer data) override
+        {
+            benchmark::DoNotOptimize(data.get());
+        }
+    };
+}
+
+// A zone-wide broadcast: state.range(0) players spread across 4 io_contexts
+static void broadcaster_zone(benchmark::State& state)
+{
+    std::vector<boost::asio::io_context> contexts(4);
+    std::vector<std::shared_ptr<null_connection>> connections;
+
+    net::broadcaster broadcaster;
+    for (int64_t i = 0; i < state.range(0); ++i)
+    {
+        connections.push_back(std::make_shared<null_connection>(contexts[i % contexts.size()]));
+        broadcaster.subscribe(0, connections.back());
+    }
+
+    std::vector<uint8_t> payload(128, 0x42);
+
+    for (auto _ : state)
+    {
+        broadcaster.broadcast(0, payload);
+
+        for (auto& context : contexts)
+        {
+            context.restart();
+            context.run();
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(broadcaster_zone)->Arg(100)->Arg(2000);
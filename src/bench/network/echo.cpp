@@ -0,0 +1,278 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/network/connection.hpp>
+#include <keycap/root/network/data_router.hpp>
+#include <keycap/root/network/message_handler.hpp>
+#include <keycap/root/network/service.hpp>
+#include <keycap/root/utility/hdr_histogram.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace net = keycap::root::network;
+namespace util = keycap::root::utility;
+
+namespace
+{
+    constexpr size_t message_size = 64;
+
+    // Round trips performed by all connections together per iteration
+    constexpr int64_t round_trips = 1000;
+
+    struct echo_connection;
+
+    struct echo_server : public net::service<echo_connection>
+    {
+        echo_server()
+          : service{net::service_mode::Server, net::service_type{0}}
+        {
+        }
+
+        SharedHandler make_handler(boost::asio::ip::tcp::socket socket) override
+        {
+            return std::make_shared<echo_connection>(std::move(socket), *this);
+        }
+    };
+
+    // Sends everything it receives straight back
+    struct echo_connection : public net::connection, public net::message_handler
+    {
+        echo_connection(boost::asio::ip::tcp::socket socket, net::service_base& service)
+          : connection{std::move(socket), service}
+        {
+            router_.configure_inbound(this);
+        }
+
+        echo_connection(std::unique_ptr<net::transport> transport, net::service_base& service)
+          : connection{std::move(transport), service}
+        {
+            router_.configure_inbound(this);
+        }
+
+        bool on_data(net::data_router const& router, net::service_type service, std::span<uint8_t> data) override
+        {
+            send(data);
+            return true;
+        }
+
+        bool on_link(net::data_router const& router, net::service_type service, net::link_status status) override
+        {
+            return true;
+        }
+    };
+
+    // Shared by all clients of a benchmark
+    struct echo_state
+    {
+        std::atomic<int64_t> remaining = 0;
+        std::atomic<int64_t> idle = 0;
+        util::hdr_histogram latency{10'000'000'000, 3};
+    };
+
+    // Keeps a single message in flight and sends the next one as soon as the echo of the previous one arrived
+    class echo_client_connection : public net::connection, public net::message_handler
+    {
+      public:
+        echo_client_connection(boost::asio::ip::tcp::socket socket, net::service_base& service, echo_state& state)
+          : connection{std::move(socket), service}
+          , state_{state}
+        {
+            router_.configure_inbound(this);
+        }
+
+        echo_client_connection(
+            std::unique_ptr<net::transport> transport, net::service_base& service, echo_state& state)
+          : connection{std::move(transport), service}
+          , state_{state}
+        {
+            router_.configure_inbound(this);
+        }
+
+        // Starts sending messages until the state has no round trips remaining
+        void start()
+        {
+            if (state_.remaining.fetch_sub(1, std::memory_order_relaxed) > 0)
+                ping();
+            else
+                state_.idle.fetch_add(1, std::memory_order_release);
+        }
+
+        bool on_data(net::data_router const& router, net::service_type service, std::span<uint8_t> data) override
+        {
+            // Echoes may arrive split or coalesced, but there is never more than one message in flight
+            received_ += data.size();
+            if (received_ < message_size)
+                return true;
+
+            received_ -= message_size;
+            state_.latency.record(
+                static_cast<uint64>(std::chrono::nanoseconds{std::chrono::steady_clock::now() - sent_at_}.count()));
+
+            start();
+            return true;
+        }
+
+        bool on_link(net::data_router const& router, net::service_type service, net::link_status status) override
+        {
+            return true;
+        }
+
+      private:
+        void ping()
+        {
+            sent_at_ = std::chrono::steady_clock::now();
+            send(payload_);
+        }
+
+        echo_state& state_;
+        std::vector<uint8_t> payload_ = std::vector<uint8_t>(message_size, 0x42);
+        std::chrono::steady_clock::time_point sent_at_;
+        size_t received_ = 0;
+    };
+
+    // Connects through a loopback_transport to servers within the same process
+    struct loopback_client_connection : public echo_client_connection
+    {
+        loopback_client_connection(std::unique_ptr<net::transport> transport, net::service_base& service,
+                                   echo_state& state)
+          : echo_client_connection{std::move(transport), service, state}
+        {
+        }
+
+        loopback_client_connection(boost::asio::ip::tcp::socket socket, net::service_base& service, echo_state& state)
+          : echo_client_connection{std::move(socket), service, state}
+        {
+        }
+    };
+
+    // Only supports TCP and therefore always connects through the network stack
+    struct tcp_client_connection : public echo_client_connection
+    {
+        tcp_client_connection(boost::asio::ip::tcp::socket socket, net::service_base& service, echo_state& state)
+          : echo_client_connection{std::move(socket), service, state}
+        {
+        }
+    };
+
+    template <typename Connection>
+    struct echo_client : public net::service<Connection>
+    {
+        using typename net::service<Connection>::SharedHandler;
+
+        explicit echo_client(echo_state& state)
+          : net::service<Connection>{net::service_mode::Client, net::service_type{0}}
+          , state_{state}
+        {
+        }
+
+        SharedHandler make_handler(boost::asio::ip::tcp::socket socket) override
+        {
+            return std::make_shared<Connection>(std::move(socket), *this, state_);
+        }
+
+        SharedHandler make_local_handler(std::unique_ptr<net::transport> transport) override
+        {
+            if constexpr (std::is_constructible_v<Connection, std::unique_ptr<net::transport>, net::service_base&,
+                                                  echo_state&>)
+                return std::make_shared<Connection>(std::move(transport), *this, state_);
+            else
+                return nullptr;
+        }
+
+        bool on_new_connection(SharedHandler handler) override
+        {
+            connection = handler;
+            return true;
+        }
+
+        // Starts the round trips on the connection's thread
+        void start_round_trips()
+        {
+            boost::asio::post(this->io_context(), [handler = connection.load()] { handler->start(); });
+        }
+
+        std::atomic<SharedHandler> connection;
+
+      private:
+        echo_state& state_;
+    };
+
+    template <typename Connection>
+    uint16_t echo_port();
+
+    template <>
+    uint16_t echo_port<loopback_client_connection>()
+    {
+        return 4200;
+    }
+
+    template <>
+    uint16_t echo_port<tcp_client_connection>()
+    {
+        return 4201;
+    }
+}
+
+// state.range(0) clients, each running its own service and connection, echoing 64 byte messages through a server
+template <typename Connection>
+static void echo(benchmark::State& state)
+{
+    auto const endpoint = net::service_endpoint::tcp("localhost", echo_port<Connection>());
+
+    echo_server server;
+    server.start(endpoint);
+
+    echo_state shared;
+    std::vector<std::unique_ptr<echo_client<Connection>>> clients;
+    for (int64_t i = 0; i < state.range(0); ++i)
+    {
+        clients.push_back(std::make_unique<echo_client<Connection>>(shared));
+        clients.back()->start(endpoint);
+    }
+
+    for (auto& client : clients)
+    {
+        while (!client->connection.load())
+            std::this_thread::yield();
+    }
+
+    for (auto _ : state)
+    {
+        shared.idle = 0;
+        shared.remaining = round_trips;
+
+        for (auto& client : clients)
+            client->start_round_trips();
+
+        while (shared.idle.load(std::memory_order_acquire) < state.range(0))
+            std::this_thread::yield();
+    }
+
+    state.SetItemsProcessed(state.iterations() * round_trips);
+    state.counters["msgs/s"] = benchmark::Counter(static_cast<double>(state.iterations() * round_trips),
+                                                  benchmark::Counter::kIsRate);
+    state.counters["p50_us"] = static_cast<double>(shared.latency.value_at_percentile(50.0)) / 1000.0;
+    state.counters["p99_us"] = static_cast<double>(shared.latency.value_at_percentile(99.0)) / 1000.0;
+}
+BENCHMARK_TEMPLATE(echo, loopback_client_connection)->Arg(1)->Arg(4)->Arg(16)->UseRealTime();
+BENCHMARK_TEMPLATE(echo, tcp_client_connection)->Arg(1)->Arg(4)->Arg(16)->UseRealTime();
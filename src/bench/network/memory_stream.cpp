@@ -0,0 +1,73 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/network/memory_stream.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+namespace net = keycap::root::network;
+
+static void memory_stream_put(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        net::memory_stream stream;
+        for (int64_t i = 0; i < state.range(0); ++i)
+            stream.put(static_cast<uint32_t>(i));
+
+        benchmark::DoNotOptimize(stream.data());
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0) * static_cast<int64_t>(sizeof(uint32_t)));
+}
+BENCHMARK(memory_stream_put)->Arg(16)->Arg(1024);
+
+static void memory_stream_get(benchmark::State& state)
+{
+    net::memory_stream source;
+    for (int64_t i = 0; i < state.range(0); ++i)
+        source.put(static_cast<uint32_t>(i));
+
+    for (auto _ : state)
+    {
+        net::memory_stream stream{source};
+        uint32_t sum = 0;
+        for (int64_t i = 0; i < state.range(0); ++i)
+            sum += stream.get<uint32_t>();
+
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0) * static_cast<int64_t>(sizeof(uint32_t)));
+}
+BENCHMARK(memory_stream_get)->Arg(16)->Arg(1024);
+
+static void memory_stream_string(benchmark::State& state)
+{
+    std::string const text(static_cast<size_t>(state.range(0)), 'x');
+
+    for (auto _ : state)
+    {
+        net::memory_stream stream;
+        stream.put(text);
+        benchmark::DoNotOptimize(stream.get_string());
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(memory_stream_string)->Arg(16)->Arg(4096);
@@ -0,0 +1,85 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/network/data_router.hpp>
+#include <keycap/root/network/message_handler.hpp>
+
+#include <benchmark/benchmark.h>
+#include <boost/uuid/random_generator.hpp>
+#include <boost/uuid/uuid.hpp>
+
+namespace net = keycap::root::network;
+
+namespace
+{
+    class null_handler : public net::message_handler
+    {
+      public:
+        bool on_data(net::data_router const& router, net::service_type service, std::span<uint8_t> data) override
+        {
+            return true;
+        }
+
+        bool on_link(net::data_router const& router, net::service_type service, net::link_status status) override
+        {
+            return true;
+        }
+    };
+
+    void connections_per_second(benchmark::State& state)
+    {
+        state.counters["connections"] = benchmark::Counter(static_cast<double>(state.iterations()),
+                                                           benchmark::Counter::kIsRate);
+    }
+}
+
+// The identity every message_handler used to generate
+static void message_handler_uuid(benchmark::State& state)
+{
+    for (auto _ : state)
+        benchmark::DoNotOptimize(boost::uuids::random_generator{}());
+
+    connections_per_second(state);
+}
+BENCHMARK(message_handler_uuid);
+
+static void message_handler_construct(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        null_handler handler;
+        benchmark::DoNotOptimize(handler.id());
+    }
+
+    connections_per_second(state);
+}
+BENCHMARK(message_handler_construct);
+
+// What every connection goes through: creating its handler, registering it with the router and removing it again
+static void message_handler_lifecycle(benchmark::State& state)
+{
+    net::data_router router;
+
+    for (auto _ : state)
+    {
+        null_handler handler;
+        router.configure_inbound(&handler);
+        router.remove_handler(&handler);
+    }
+
+    connections_per_second(state);
+}
+BENCHMARK(message_handler_lifecycle);
@@ -0,0 +1,93 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/network/registered_message.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+namespace net = keycap::root::network;
+
+namespace
+{
+    net::registered_message make_message(int64_t size)
+    {
+        net::registered_message message;
+        message.sender = 42;
+        message.command = net::registered_command::Update;
+        message.payload = net::memory_stream{std::vector<uint8>(static_cast<size_t>(size), 0x42)};
+        return message;
+    }
+
+    void payload_sizes(benchmark::internal::Benchmark* benchmark)
+    {
+        benchmark->RangeMultiplier(16)->Range(16, 64 << 10);
+    }
+}
+
+static void registered_message_encode(benchmark::State& state)
+{
+    auto message = make_message(state.range(0));
+
+    for (auto _ : state)
+    {
+        message.sign();
+        auto encoded = message.encode();
+        benchmark::DoNotOptimize(encoded.data());
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(registered_message_encode)->Apply(payload_sizes);
+
+static void registered_message_decode(benchmark::State& state)
+{
+    auto message = make_message(state.range(0));
+    message.sign();
+    auto encoded = message.encode();
+
+    for (auto _ : state)
+    {
+        net::memory_stream stream{encoded};
+        auto decoded = net::registered_message::decode(stream);
+        benchmark::DoNotOptimize(decoded.validate());
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(registered_message_decode)->Apply(payload_sizes);
+
+// Many small messages sent within the flush window of the service_locator
+static void registered_batch_unpack(benchmark::State& state)
+{
+    net::registered_batch batch;
+    auto payload = net::memory_stream{std::vector<uint8>(32, 0x42)};
+    for (int64_t i = 0; i < state.range(0); ++i)
+        batch.add(42, net::registered_command::Update, payload);
+
+    auto message = batch.to_message();
+
+    for (auto _ : state)
+    {
+        auto copy = message.payload;
+        auto messages = net::registered_batch::unpack(copy);
+        benchmark::DoNotOptimize(messages);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(registered_batch_unpack)->Arg(64);
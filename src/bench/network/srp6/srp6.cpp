@@ -0,0 +1,71 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/network/srp6/client.hpp>
+#include <keycap/root/network/srp6/server.hpp>
+#include <keycap/root/network/srp6/utility.hpp>
+
+#include <benchmark/benchmark.h>
+
+namespace srp = keycap::root::network::srp6;
+
+namespace
+{
+    constexpr auto compliance = srp::compliance::Wow;
+}
+
+static void srp6_generate_verifier(benchmark::State& state)
+{
+    auto parameter = srp::get_parameters(static_cast<srp::group_parameters>(state.range(0)));
+    Botan::BigInt salt("0x93C999AFF408B3A3CF78D1CF36482C09F7FF0714EF2A982C46C3DFF5A9DC0DE6");
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(srp::generate_verifier("ADMIN", "ADMIN", parameter, salt, compliance));
+}
+BENCHMARK(srp6_generate_verifier)
+    ->Arg(static_cast<int64_t>(srp::group_parameters::_256))
+    ->Arg(static_cast<int64_t>(srp::group_parameters::_2048));
+
+// A complete login: both sides create their ephemeral values, derive the session key and prove it to each other
+static void srp6_handshake(benchmark::State& state)
+{
+    auto parameter = srp::get_parameters(static_cast<srp::group_parameters>(state.range(0)));
+
+    std::string const account_name = "ADMIN";
+    Botan::BigInt salt("0x93C999AFF408B3A3CF78D1CF36482C09F7FF0714EF2A982C46C3DFF5A9DC0DE6");
+    auto verifier = srp::generate_verifier(account_name, account_name, parameter, salt, compliance);
+
+    for (auto _ : state)
+    {
+        srp::client client{parameter, account_name, compliance};
+        srp::server server{parameter, verifier, compliance};
+
+        auto client_key = client.session_key(server.public_ephemeral_value(), account_name, account_name, salt);
+        auto server_key = server.session_key(client.public_ephemeral_value());
+
+        auto client_proof = srp::generate_client_proof(
+            server.prime(), server.generator(), salt, account_name, client.public_ephemeral_value(),
+            server.public_ephemeral_value(), client_key, compliance);
+
+        benchmark::DoNotOptimize(server.proof(client_proof, server_key));
+    }
+
+    state.counters["handshakes"] = benchmark::Counter(static_cast<double>(state.iterations()),
+                                                      benchmark::Counter::kIsRate);
+}
+BENCHMARK(srp6_handshake)
+    ->Arg(static_cast<int64_t>(srp::group_parameters::_256))
+    ->Arg(static_cast<int64_t>(srp::group_parameters::_2048));
@@ -0,0 +1,78 @@
+/*
+   Copyright 2017 KeycapEmu
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include <keycap/root/utility/crc32.hpp>
+
+#include <benchmark/benchmark.h>
+#include <boost/crc.hpp>
+
+#include <numeric>
+#include <vector>
+
+namespace util = keycap::root::utility;
+
+namespace
+{
+    std::vector<uint8> make_payload(size_t size)
+    {
+        std::vector<uint8> data(size);
+        std::iota(data.begin(), data.end(), uint8{0});
+        return data;
+    }
+
+    void payload_sizes(benchmark::internal::Benchmark* benchmark)
+    {
+        benchmark->RangeMultiplier(4)->Range(16, 1 << 20);
+    }
+}
+
+// The table-driven implementation registered_message used before
+static void crc32_boost(benchmark::State& state)
+{
+    auto data = make_payload(static_cast<size_t>(state.range(0)));
+
+    for (auto _ : state)
+    {
+        boost::crc_32_type crc;
+        crc.process_bytes(data.data(), data.size());
+        benchmark::DoNotOptimize(crc.checksum());
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(crc32_boost)->Apply(payload_sizes);
+
+static void crc32(benchmark::State& state)
+{
+    auto data = make_payload(static_cast<size_t>(state.range(0)));
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(util::crc32_update(0, data.data(), data.size()));
+
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(crc32)->Apply(payload_sizes);
+
+static void crc32c(benchmark::State& state)
+{
+    auto data = make_payload(static_cast<size_t>(state.range(0)));
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(util::crc32c_update(0, data.data(), data.size()));
+
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(crc32c)->Apply(payload_sizes);
@@ -0,0 +1,36 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/utility/md5.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <numeric>
+#include <vector>
+
+namespace util = keycap::root::utility;
+
+static void md5(benchmark::State& state)
+{
+    std::vector<uint8> data(static_cast<size_t>(state.range(0)));
+    std::iota(data.begin(), data.end(), uint8{0});
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(util::md5(data));
+
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(md5)->RangeMultiplier(16)->Range(16, 64 << 10);
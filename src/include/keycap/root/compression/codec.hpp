@@ -0,0 +1,151 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#pragma once
+
+#include "dictionary.hpp"
+
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace keycap::root::compression
+{
+    // The algorithms data can be compressed with. The values are part of the frame header and must not change
+    enum class codec_type : uint8_t
+    {
+        // The data is stored uncompressed
+        None = 0,
+        Zlib = 1,
+        // Fast compression for latency sensitive paths
+        Lz4 = 2,
+        // Good ratios at reasonable speed for bulk transfers
+        Zstd = 3,
+    };
+
+    // Compresses and decompresses whole buffers using a single algorithm. Codecs may be used by multiple threads at once
+    class codec
+    {
+      public:
+        virtual ~codec() = default;
+
+        virtual codec_type type() const noexcept = 0;
+
+        // Returns the level data is compressed with. Its meaning depends on the algorithm
+        virtual int level() const noexcept = 0;
+
+        // Returns the maximum size the compressed data of an input of the given size can take
+        virtual size_t bound(size_t size) const = 0;
+
+        // Compresses the input into the given output. Returns the size of the compressed data or an empty optional if
+        // it exceeds the output
+        virtual std::optional<size_t> compress(std::span<uint8_t const> input, std::span<uint8_t> output) const = 0;
+
+        // Decompresses the input into the given output, which must be able to hold all of the decompressed data.
+        // Returns the size of the decompressed data or an empty optional if the input is malformed
+        virtual std::optional<size_t> decompress(std::span<uint8_t const> input, std::span<uint8_t> output) const = 0;
+    };
+
+    // Returns whether or not the library has been built with support for the given codec
+    bool is_supported(codec_type type) noexcept;
+
+    // Returns the level a codec uses if none is given
+    int default_level(codec_type type) noexcept;
+
+    // Creates a codec of the given type compressing with the given level, or the default level if none is given.
+    // Levels are clamped to the range the algorithm supports. Returns nullptr if the codec isn't supported
+    std::unique_ptr<codec> make_codec(codec_type type, std::optional<int> level = {});
+
+    // Creates a codec compressing with the given dictionary, which the receiving end must use as well. Returns nullptr
+    // if the codec isn't supported or doesn't support dictionaries, which only zlib and zstd do
+    std::unique_ptr<codec> make_codec(codec_type type, std::shared_ptr<dictionary const> dictionary,
+                                      std::optional<int> level = {});
+
+    // The header preceding every frame: the codec_type followed by the size of the uncompressed data as a varint
+    struct frame_header
+    {
+        // The largest size a frame_header can take
+        static constexpr size_t max_size = 1 + 10;
+
+        codec_type codec = codec_type::None;
+        uint64_t uncompressed_size = 0;
+        // The number of bytes the header occupied
+        size_t size = 0;
+    };
+
+    // Reads the frame_header at the beginning of the given data. Returns an empty optional if it is incomplete
+    std::optional<frame_header> read_frame_header(std::span<uint8_t const> data);
+
+    // Compresses the input using the given codec and prepends a frame_header, so receivers can decompress it without
+    // knowing which codec has been used. Falls back to codec_type::None if compressing doesn't reduce the size
+    std::vector<uint8_t> compress(codec const& codec, std::span<uint8_t const> input);
+
+    // The largest amount of data decompressing a single frame or compress_blocks' result may yield by default. The size
+    // in a frame_header can't be trusted, so larger frames are rejected before any memory is allocated for them
+    constexpr size_t default_max_uncompressed_size = 1024 * 1024 * 1024;
+
+    // Decompresses a frame created by compress using the codec given by its header. Returns an empty vector if the
+    // frame is malformed, its codec isn't supported or it claims to hold more than max_size bytes or more than its
+    // codec could possibly have compressed into the payload
+    std::vector<uint8_t> decompress(std::span<uint8_t const> frame, size_t max_size = default_max_uncompressed_size);
+
+    // Decompresses a frame using the given codec, e.g. one with a dictionary, unless the frame is uncompressed.
+    // Returns an empty vector if the frame is malformed, claims to hold too much data as for decompress(frame) or has
+    // been compressed with a different codec
+    std::vector<uint8_t> decompress(codec const& codec, std::span<uint8_t const> frame,
+                                    size_t max_size = default_max_uncompressed_size);
+
+    // The size of the blocks compress_blocks splits its input into
+    constexpr size_t default_block_size = 256 * 1024;
+
+    // Splits the input into blocks which are compressed into frames independently on up to the given number of
+    // threads, where 0 uses one per hardware thread. The result starts with the number of blocks and the size of every
+    // frame as varints, followed by the frames, so decompress_blocks can decompress them in parallel as well. Blocks
+    // compressed with a dictionary must be decompressed using a codec with the same dictionary
+    std::vector<uint8_t> compress_blocks(codec const& codec, std::span<uint8_t const> input, size_t threads = 0,
+                                         size_t block_size = default_block_size);
+
+    // Decompresses the result of compress_blocks on up to the given number of threads. Returns an empty vector if the
+    // data is malformed, a codec isn't supported or the blocks claim to hold more than max_size bytes in total
+    std::vector<uint8_t> decompress_blocks(std::span<uint8_t const> data, size_t threads = 0,
+                                           size_t max_size = default_max_uncompressed_size);
+
+    // Decompresses the result of compress_blocks using the given codec, e.g. one with a dictionary, unless a block is
+    // uncompressed. Fails like decompress_blocks(data) and if a block has been compressed with a different codec
+    std::vector<uint8_t> decompress_blocks(codec const& codec, std::span<uint8_t const> data, size_t threads = 0,
+                                           size_t max_size = default_max_uncompressed_size);
+
+    template <typename Iter>
+    std::vector<uint8_t> compress(codec const& codec, Iter begin, Iter end)
+    {
+        static_assert(std::contiguous_iterator<Iter>, "The range must be contiguous!");
+
+        return compress(codec, std::span<uint8_t const>(reinterpret_cast<uint8_t const*>(std::to_address(begin)),
+                                                        static_cast<size_t>(end - begin) * sizeof(*begin)));
+    }
+
+    template <typename Iter>
+    std::vector<uint8_t> decompress(Iter begin, Iter end)
+    {
+        static_assert(std::contiguous_iterator<Iter>, "The range must be contiguous!");
+
+        return decompress(std::span<uint8_t const>(reinterpret_cast<uint8_t const*>(std::to_address(begin)),
+                                                   static_cast<size_t>(end - begin) * sizeof(*begin)));
+    }
+}
@@ -0,0 +1,66 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace keycap::root::network
+{
+    class memory_stream;
+}
+
+namespace keycap::root::compression
+{
+    // Data typical for the messages being compressed, which both ends of a connection share so that even tiny
+    // messages can refer to it instead of compressing on their own. Either trained with train_dictionary or raw data
+    class dictionary
+    {
+      public:
+        explicit dictionary(std::vector<uint8_t> content);
+
+        // Returns the content of the dictionary, as e.g. stored to be loaded by the other end
+        std::span<uint8_t const> content() const noexcept
+        {
+            return content_;
+        }
+
+        // Returns the adler32 checksum of the content, which zlib stores in compressed data to identify the dictionary
+        uint32_t id() const noexcept
+        {
+            return id_;
+        }
+
+      private:
+        std::vector<uint8_t> content_;
+        uint32_t id_ = 0;
+    };
+
+    // The size of a dictionary is a trade-off: larger dictionaries cover more messages but take longer to load.
+    // zlib only uses the last 32 KiB of a dictionary
+    constexpr size_t default_dictionary_size = 16 * 1024;
+
+    // Trains a dictionary of at most max_size bytes from the given samples, e.g. messages captured from a connection.
+    // Uses the zstd trainer if available, which needs a few hundred samples to work well. Otherwise, or if training
+    // fails, the dictionary consists of the samples themselves, the most frequent ones last
+    dictionary train_dictionary(std::span<std::span<uint8_t const> const> samples,
+                                size_t max_size = default_dictionary_size);
+
+    dictionary train_dictionary(std::span<network::memory_stream const> samples,
+                                size_t max_size = default_dictionary_size);
+}
@@ -0,0 +1,138 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#pragma once
+
+#include "codec.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace keycap::root::compression
+{
+    // Estimates the entropy of the data in bits per byte, between 0 and 8, from a histogram of its bytes.
+    // Data close to 8 bits per byte, e.g. data that already is compressed or encrypted, won't compress any further
+    double estimate_entropy(std::span<uint8_t const> data) noexcept;
+
+    struct policy_settings
+    {
+        // Inputs smaller than this aren't worth the time compressing them takes
+        size_t min_size = 128;
+
+        // The number of bytes at the beginning of the input the entropy is estimated from
+        size_t sample_size = 4 * 1024;
+
+        // Inputs whose sample exceeds this many bits per byte are considered incompressible. Samples too small to
+        // reach 8 bits even for random data are held to a proportionally lower threshold. 8 disables the check
+        double max_entropy = 7.5;
+
+        // Message types compressing by less than this fraction of their size on average are no longer compressed
+        double min_savings = 0.1;
+
+        // Every this many skipped messages of a type found not worth compressing, one is compressed again in case the
+        // data has changed
+        uint32_t probe_interval = 64;
+    };
+
+    // A snapshot of the decisions a compression_policy made and their outcome
+    struct policy_statistics
+    {
+        uint64_t compressed = 0;
+        uint64_t skipped_small = 0;
+        uint64_t skipped_entropy = 0;
+        uint64_t skipped_learned = 0;
+
+        // The size of the compressed inputs and the frames they have been compressed into
+        uint64_t input_bytes = 0;
+        uint64_t output_bytes = 0;
+
+        // Time spent compressing, in nanoseconds
+        uint64_t compress_time = 0;
+
+        // Returns the number of bytes compression saved, which is negative if it cost more than it saved
+        int64_t saved_bytes() const noexcept
+        {
+            return static_cast<int64_t>(input_bytes) - static_cast<int64_t>(output_bytes);
+        }
+    };
+
+    // Decides whether or not data is worth compressing before spending time on it: inputs that are too small or look
+    // incompressible are skipped, as are message types that didn't compress well recently. Skipped inputs are stored in
+    // uncompressed frames, so decompress reads the result either way. May be used by multiple threads at once
+    class compression_policy
+    {
+      public:
+        explicit compression_policy(std::shared_ptr<codec const> codec, policy_settings settings = {});
+
+        // Compresses the input into a frame using the codec if it's worth it, see compress(codec, input).
+        // The message_type groups messages that are expected to compress similarly, e.g. by their opcode
+        std::vector<uint8_t> compress(std::span<uint8_t const> input, uint32_t message_type = 0);
+
+        // Returns whether or not compress would compress the input. Doesn't count as a decision in the statistics
+        bool should_compress(std::span<uint8_t const> input, uint32_t message_type = 0) const;
+
+        policy_statistics statistics() const noexcept;
+
+        // Returns the codec inputs worth it are compressed with, which also decompresses them
+        codec const& get_codec() const noexcept
+        {
+            return *codec_;
+        }
+
+      private:
+        enum class decision
+        {
+            Compress,
+            TooSmall,
+            Incompressible,
+        };
+
+        // Tracks how well messages of a type compressed recently
+        struct type_state
+        {
+            // Exponential moving average of the compressed size relative to the input size
+            double ratio = 1.0;
+            bool measured = false;
+            bool pays_off = true;
+            uint32_t skipped = 0;
+        };
+
+        // Decides by the input alone, without taking the message type into account
+        decision inspect(std::span<uint8_t const> input) const noexcept;
+
+        void learn(uint32_t message_type, size_t input_size, size_t output_size);
+
+        std::shared_ptr<codec const> codec_;
+        std::unique_ptr<codec> uncompressed_;
+        policy_settings settings_;
+
+        std::unordered_map<uint32_t, type_state> types_;
+        mutable std::mutex types_mutex_;
+
+        std::atomic<uint64_t> compressed_ = 0;
+        std::atomic<uint64_t> skipped_small_ = 0;
+        std::atomic<uint64_t> skipped_entropy_ = 0;
+        std::atomic<uint64_t> skipped_learned_ = 0;
+        std::atomic<uint64_t> input_bytes_ = 0;
+        std::atomic<uint64_t> output_bytes_ = 0;
+        std::atomic<uint64_t> compress_time_ = 0;
+    };
+}
@@ -16,41 +16,171 @@
 
 #pragma once
 
-#include "../utility/assert.hpp"
-
-#include <cassert>
 #include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
 #include <vector>
 
+namespace keycap::root::network
+{
+    class memory_stream;
+}
+
 namespace keycap::root::compression::zip
 {
     namespace impl
     {
-        std::vector<uint8_t> compress(uint8_t* begin, unsigned long size);
-        std::vector<uint8_t> decompress(uint8_t* begin, unsigned long size);
+        std::vector<uint8_t> compress(uint8_t const* begin, size_t size);
+        std::vector<uint8_t> decompress(uint8_t const* begin, size_t size, size_t uncompressed_size = 0);
     }
 
+    // Ranges exceeding the 32 bit sizes of zlib are passed to it in multiple steps
     template <typename Iter>
     std::vector<uint8_t> compress(Iter begin, Iter end)
     {
-        constexpr unsigned long minus_one = -1;
-        kcr_assert((end - begin) < minus_one, "The range mustn't be bigger than 2^32 bytes!");
-
         if (begin == end)
             return {};
 
-        return impl::compress(reinterpret_cast<uint8_t*>(&*begin), static_cast<unsigned long>(end - begin));
+        return impl::compress(reinterpret_cast<uint8_t const*>(&*begin), static_cast<size_t>(end - begin));
     }
 
     template <typename Iter>
     std::vector<uint8_t> decompress(Iter begin, Iter end)
     {
-        constexpr unsigned long minus_one = -1;
-        kcr_assert((end - begin) < minus_one, "The range mustn't be bigger than 2^32 bytes!");
+        if (begin == end)
+            return {};
 
+        return impl::decompress(reinterpret_cast<uint8_t const*>(&*begin), static_cast<size_t>(end - begin));
+    }
+
+    // Decompresses the range into a buffer of uncompressed_size bytes, as e.g. transmitted along with the data, saving
+    // the buffer from being grown while decompressing. The buffer still grows if the size was too small
+    template <typename Iter>
+    std::vector<uint8_t> decompress(Iter begin, Iter end, size_t uncompressed_size)
+    {
         if (begin == end)
             return {};
 
-        return impl::decompress(reinterpret_cast<uint8_t*>(&*begin), static_cast<unsigned long>(end - begin));
+        return impl::decompress(
+            reinterpret_cast<uint8_t const*>(&*begin), static_cast<size_t>(end - begin), uncompressed_size);
     }
-}
\ No newline at end of file
+
+    // Returns the maximum size the compressed data of an input of the given size can take
+    size_t compress_bound(size_t size);
+
+    // Compresses the input into the given output using the given level between 0 (none) and 9 (best), which matches
+    // compress for level 8. A preset dictionary of data similar to the input improves the ratio of small inputs, but
+    // must be passed to decompress_into as well.
+    // Returns the size of the compressed data or an empty optional if it exceeds the output
+    std::optional<size_t> compress_into(std::span<uint8_t const> input, std::span<uint8_t> output, int level = 8,
+                                        std::span<uint8_t const> dictionary = {});
+
+    // Decompresses the input into the given output without allocating any buffers, using the given dictionary if the
+    // input has been compressed with one. Returns the size of the decompressed data or an empty optional if the input
+    // is malformed, exceeds the output or requires a different dictionary
+    std::optional<size_t> decompress_into(std::span<uint8_t const> input, std::span<uint8_t> output,
+                                          std::span<uint8_t const> dictionary = {});
+
+    // The size of the blocks compress_parallel splits its input into
+    constexpr size_t default_block_size = 128 * 1024;
+
+    // Compresses the input on up to the given number of threads, where 0 uses one per hardware thread, by splitting
+    // it into blocks which are compressed independently, each primed with the 32 KiB of input preceding it. The
+    // result is a single zlib stream that decompress reads as usual, and isn't limited to 2^32 bytes of input
+    std::vector<uint8_t> compress_parallel(std::span<uint8_t const> input, int level = 8, size_t threads = 0,
+                                           size_t block_size = default_block_size);
+
+    // The amount of input consumed and output produced by a call to deflate_stream or inflate_stream
+    struct stream_result
+    {
+        size_t consumed = 0;
+        size_t produced = 0;
+    };
+
+    // Compresses data into the zlib format while it arrives, so neither the input nor the output have to be kept in
+    // memory as a whole. The concatenated output equals the result of compress for the concatenated input
+    class deflate_stream
+    {
+      public:
+        explicit deflate_stream(int level = 8);
+        ~deflate_stream();
+
+        deflate_stream(deflate_stream&& rhs) noexcept;
+        deflate_stream& operator=(deflate_stream&& rhs) noexcept;
+
+        // Compresses as much of the input as fits into output. zlib may buffer input without producing any output
+        stream_result write(std::span<uint8_t const> input, std::span<uint8_t> output);
+
+        // Compresses the whole input, appending all output produced to the given buffer
+        stream_result write(std::span<uint8_t const> input, std::vector<uint8_t>& output);
+
+        stream_result write(std::span<uint8_t const> input, network::memory_stream& output);
+
+        // Writes all pending output and aligns it to a byte boundary without ending the stream, so the other end can
+        // decompress everything written so far while the stream keeps its history for the data that follows
+        size_t flush(std::span<uint8_t> output);
+
+        size_t flush(std::vector<uint8_t>& output);
+
+        size_t flush(network::memory_stream& output);
+
+        // Writes the remaining output and ends the stream. Returns the number of bytes produced, which may be less
+        // than output's size while the stream isn't finished yet
+        size_t finish(std::span<uint8_t> output);
+
+        size_t finish(std::vector<uint8_t>& output);
+
+        size_t finish(network::memory_stream& output);
+
+        // Returns whether or not the end of the stream has been written
+        bool finished() const noexcept;
+
+        // Starts a new stream with the same settings
+        void reset();
+
+      private:
+        struct state;
+        std::unique_ptr<state> state_;
+    };
+
+    // Decompresses zlib data while it arrives, e.g. chunk by chunk as it is read from a connection.
+    // Throws if the data is malformed
+    class inflate_stream
+    {
+      public:
+        inflate_stream();
+        ~inflate_stream();
+
+        inflate_stream(inflate_stream&& rhs) noexcept;
+        inflate_stream& operator=(inflate_stream&& rhs) noexcept;
+
+        // Decompresses as much of the input as fits into output. Input following the end of the stream isn't consumed
+        stream_result write(std::span<uint8_t const> input, std::span<uint8_t> output);
+
+        // Decompresses the whole input or until the end of the stream, appending the output to the given buffer
+        stream_result write(std::span<uint8_t const> input, std::vector<uint8_t>& output);
+
+        stream_result write(std::span<uint8_t const> input, network::memory_stream& output);
+
+        // Returns whether or not the end of the stream has been reached
+        bool finished() const noexcept;
+
+        // Starts a new stream
+        void reset();
+
+      private:
+        struct state;
+        std::unique_ptr<state> state_;
+    };
+
+    // Compresses the input file into the output file, which is replaced if it exists, in the format of compress. The
+    // input is mapped into memory where supported and streamed otherwise, so neither file is held in memory as a whole.
+    // Returns the size of the output file. Throws if a file can't be read or written
+    uint64_t compress_file(std::filesystem::path const& input, std::filesystem::path const& output, int level = 8);
+
+    // Decompresses the input file created by e.g. compress_file into the output file, which is replaced if it exists.
+    // Returns the size of the output file. Throws if a file can't be read or written or the input is malformed
+    uint64_t decompress_file(std::filesystem::path const& input, std::filesystem::path const& output);
+}
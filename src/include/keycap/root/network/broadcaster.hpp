@@ -0,0 +1,78 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#pragma once
+
+#include "../types.hpp"
+#include "connection_base.hpp"
+#include "memory_stream.hpp"
+
+#include <boost/asio/io_context.hpp>
+
+#include <memory>
+#include <shared_mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace keycap::root::network
+{
+    // Sends the same data to many connections at once. The data is copied into a single shared_buffer that all
+    // connections send from, and connections are grouped by their io_context so a broadcast only posts a single task
+    // to every io_context instead of one per connection.
+    // Connections subscribe to channels, e.g. a zone or a chat channel, and every broadcast targets one channel.
+    // The broadcaster keeps its subscribers alive, so connections have to unsubscribe once they're closed
+    class broadcaster
+    {
+      public:
+        using channel_id = uint64;
+
+        // Adds the connection to the given channel. Subscribing more than once has no effect
+        void subscribe(channel_id channel, std::shared_ptr<connection_base> connection);
+
+        // Removes the connection from the given channel
+        void unsubscribe(channel_id channel, connection_base const* connection);
+
+        // Removes the connection from all channels
+        void unsubscribe(connection_base const* connection);
+
+        // Returns the number of connections subscribed to the given channel
+        size_t subscribers(channel_id channel) const;
+
+        // Sends the given buffer to all connections subscribed to the given channel
+        void broadcast(channel_id channel, shared_buffer data) const;
+
+        // Sends the given data to all connections subscribed to the given channel
+        void broadcast(channel_id channel, std::span<uint8 const> data) const;
+
+        // Sends the given stream to all connections subscribed to the given channel
+        void broadcast(channel_id channel, memory_stream&& stream) const;
+
+      private:
+        using connection_list = std::vector<std::shared_ptr<connection_base>>;
+
+        // All subscribers of a channel running on the same io_context. The list itself is never modified once it
+        // has been published, so broadcasts only need to share ownership of it
+        struct group
+        {
+            boost::asio::io_context* context = nullptr;
+            std::shared_ptr<connection_list const> connections;
+        };
+
+        mutable std::shared_mutex mutex_;
+        std::unordered_map<channel_id, std::vector<group>> channels_;
+    };
+}
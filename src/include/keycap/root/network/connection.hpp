@@ -16,13 +16,17 @@ limitations under the License.
 
 #pragma once
 
+#include "../compression/zip.hpp"
 #include "../utility/utility.hpp"
 #include "connection_base.hpp"
 #include "data_router.hpp"
 
 #include <boost/asio/awaitable.hpp>
 
+#include <chrono>
+#include <optional>
 #include <span>
+#include <vector>
 
 namespace keycap::root::network
 {
@@ -34,7 +38,9 @@ namespace keycap::root::network
       public:
         connection(boost::asio::ip::tcp::socket socket, service_base& service);
 
-        // Returns the socket used by the connection handler
+        connection(std::unique_ptr<transport> transport, service_base& service);
+
+        // Returns the socket used by the connection handler. Throws if the connection doesn't use a tcp_transport
         boost::asio::ip::tcp::socket& socket();
 
         // The connection handler will start to asynchronously listen for incoming data
@@ -48,15 +54,55 @@ namespace keycap::root::network
 
         void send(std::span<char> data);
 
+        // Sends the given buffer asynchronously without copying it
+        void send(shared_buffer data) override;
+
+        // Sends the given buffer asynchronously using the given priority lane, see send_queue
+        void send(shared_buffer data, send_priority priority);
+
+        // Sends the given payload asynchronously in chunks of at most chunk_size bytes, allowing messages of higher
+        // priority to be sent in between. Every chunk is framed using the given framer, see send_queue
+        void send_chunked(shared_buffer data, send_priority priority, size_t chunk_size, send_queue::framer framer);
+
         data_router& get_router();
 
+        // Compresses everything sent and decompresses everything received using a single deflate and inflate stream
+        // that live as long as the connection, flushing the deflate stream after every message. Unlike compressing
+        // every message on its own, later messages refer back to the ones sent before, which pays off for the similar
+        // updates exchanged between services. Both ends must enable it before the connection starts to listen
+        void enable_compression(int level = 8);
+
+        // Returns whether or not enable_compression has been called
+        bool compressed() const noexcept;
+
       private:
         boost::asio::awaitable<void> do_read();
 
         boost::asio::awaitable<void> do_write();
 
+        // Returns the current time if the service records latencies, otherwise a default constructed time_point
+        std::chrono::steady_clock::time_point latency_start() const;
+
+        // Update the metrics of the connection and its service
+        void on_read(size_t size, std::chrono::steady_clock::time_point started);
+
+        void on_written(size_t size, std::chrono::steady_clock::time_point queued_at);
+
+        void on_error();
+
         void stop();
 
+        // Wakes up do_write once a message has been queued. The send timer must only be touched from within the
+        // io_context, so the wake-up is posted to it when sending from other threads
+        void wake_writer();
+
+        std::optional<compression::zip::deflate_stream> deflate_;
+        std::optional<compression::zip::inflate_stream> inflate_;
+
+        // Reused for every message to avoid allocations once they have grown large enough
+        std::vector<uint8_t> deflated_;
+        std::vector<uint8_t> inflated_;
+
       protected:
         data_router router_;
         service_base& service_;
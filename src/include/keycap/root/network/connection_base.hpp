@@ -16,12 +16,16 @@ limitations under the License.
 
 #pragma once
 
+#include "metrics.hpp"
+#include "send_queue.hpp"
+#include "shared_buffer.hpp"
+#include "transport.hpp"
+
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/io_context_strand.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/streambuf.hpp>
 
-#include <deque>
 #include <memory>
 #include <span>
 #include <vector>
@@ -32,10 +36,16 @@ namespace keycap::root::network
     {
       public:
         connection_base(boost::asio::ip::tcp::socket socket, boost::asio::io_context& ioService)
+          : connection_base{std::make_unique<tcp_transport>(std::move(socket)), ioService}
+        {
+        }
+
+        connection_base(std::unique_ptr<transport> transport, boost::asio::io_context& ioService)
           : io_service_{ioService}
-          , socket_{std::move(socket)}
+          , transport_{std::move(transport)}
           , write_strand_{ioService}
           , send_timer_{ioService}
+          , metrics_{std::make_shared<connection_metrics>()}
         {
             send_timer_.expires_at(std::chrono::steady_clock::time_point::max());
         }
@@ -46,13 +56,39 @@ namespace keycap::root::network
 
         virtual void send(std::span<uint8_t> data) = 0;
 
+        // Sends the given buffer without copying it. May be called from any thread, e.g. by data_router::route_outbound
+        virtual void send(shared_buffer data)
+        {
+            send(std::span<uint8_t>{const_cast<uint8_t*>(data->data()), data->size()});
+        }
+
+        // Returns the io_context the connection is running on
+        boost::asio::io_context& io_context() const
+        {
+            return io_service_;
+        }
+
+        // Returns the transport the connection sends and receives its data through
+        transport& get_transport() const
+        {
+            return *transport_;
+        }
+
+        // Returns the connection's metrics, which may outlive the connection
+        std::shared_ptr<connection_metrics const> metrics() const
+        {
+            return metrics_;
+        }
+
       protected:
         boost::asio::io_context& io_service_;
-        boost::asio::ip::tcp::socket socket_;
+        std::unique_ptr<transport> transport_;
         boost::asio::io_context::strand write_strand_;
         boost::asio::streambuf in_packet_;
-        std::deque<std::vector<std::uint8_t>> send_packet_queue_;
+        send_queue send_packet_queue_;
 
         boost::asio::steady_timer send_timer_;
+
+        std::shared_ptr<connection_metrics> metrics_;
     };
 }
\ No newline at end of file
@@ -19,11 +19,16 @@
 #include "link_status.hpp"
 
 #include "connection_base.hpp"
+#include "memory_stream.hpp"
 #include "message_handler.hpp"
+#include "opcode_table.hpp"
 
+#include <atomic>
 #include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <span>
 #include <vector>
 
@@ -31,6 +36,10 @@ namespace keycap::root::network
 {
     class service_base;
 
+    // Handlers are stored as copy-on-write snapshots which get replaced as a whole whenever a handler is added or
+    // removed. Routing only loads the current snapshot, so readers never block writers for long and routing may be
+    // done from any number of threads, while handlers can still be added and removed at runtime. Note that
+    // std::atomic<std::shared_ptr> uses a short internal lock in libstdc++ and thus isn't lock-free
     class data_router
     {
       public:
@@ -40,24 +49,48 @@ namespace keycap::root::network
         void configure_inbound(message_handler* handler);
 
         // Adds a new ConnectionHandler for outgoing data
+        // Connections own their router, so only a weak reference is kept and expired connections are skipped
         void configure_outbound(std::weak_ptr<connection_base> handler);
 
         // Removes the given MessageeHandler
+        // Data that is being routed by another thread at the same time may still reach the handler
         void remove_handler(message_handler* handler);
 
+        // Removes the given ConnectionHandler
+        void remove_outbound(connection_base const* handler);
+
+        // Switches the router into dispatch mode: inbound data will be split into frames using the table's
+        // frame_reader and every frame will be passed to the one handler registered for its opcode instead of to all
+        // message_handlers. Passing nullptr switches back to routing to all message_handlers.
+        void configure_dispatch(std::shared_ptr<opcode_table const> table);
+
         // Routes the updated link_status to all registered message_handlers
-        void route_updated_link_status(service_base& service, link_status status) const;
+        void route_updated_link_status(service_base& service, link_status status);
 
         // Routes the given data from the given Service to all registered message_handlers
         // Will call every registered message_handler, even if one of them fails
         // Returns whether or not all message_handler succeeded.
-        bool route_inbound(service_base& service, std::span<uint8_t> data) const;
+        // In dispatch mode every complete frame is routed to the handler registered for its opcode instead. Fails if
+        // there is no handler for a frame's opcode.
+        bool route_inbound(service_base& service, std::span<uint8_t> data);
 
         // Routes the given data to the given receiver
         void route_outbound(std::span<uint8_t> data) const;
 
       private:
-        std::vector<message_handler*> inbound_handlers_;
-        std::vector<std::weak_ptr<connection_base>> outbound_handlers;
+        using inbound_list = std::vector<message_handler*>;
+        using outbound_list = std::vector<std::weak_ptr<connection_base>>;
+
+        // Dispatches all complete frames within the given data and returns the number of bytes consumed
+        std::optional<size_t> dispatch(opcode_table const& table, service_type service, std::span<uint8_t> data) const;
+
+        // Serializes modifications of the snapshots, routing never acquires it
+        std::mutex update_mutex_;
+        std::atomic<std::shared_ptr<inbound_list const>> inbound_handlers_;
+        std::atomic<std::shared_ptr<outbound_list const>> outbound_handlers_;
+
+        std::atomic<std::shared_ptr<opcode_table const>> opcode_table_;
+        // Holds the beginning of a frame that hasn't been received completely in dispatch mode
+        memory_stream partial_frame_;
     };
 }
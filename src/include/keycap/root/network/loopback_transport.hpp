@@ -0,0 +1,84 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#pragma once
+
+#include "transport.hpp"
+
+#include <boost/asio/io_context.hpp>
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+namespace keycap::root::network
+{
+    namespace impl
+    {
+        struct loopback_channel;
+        struct loopback_signal;
+    }
+
+    // Connects two services within the same process without going through the kernel. Every direction is a
+    // lock-free single producer, single consumer ring buffer; the io_context of the other end is only notified if
+    // it's actually waiting for data or free space.
+    // Every end must only be used by a single connection and a single thread at a time
+    class loopback_transport final : public transport
+    {
+      public:
+        // Default number of bytes that can be in flight per direction
+        static constexpr size_t default_capacity = 256 * 1024;
+
+        ~loopback_transport() override;
+
+        boost::asio::awaitable<size_t> read_some(std::span<uint8_t> buffer) override;
+
+        boost::asio::awaitable<void> write(std::span<uint8_t const> data) override;
+
+        void close() override;
+
+        bool is_open() const override;
+
+        transport_kind kind() const override
+        {
+            return transport_kind::Loopback;
+        }
+
+        // Creates two connected ends, the first running on context1, the second on context2
+        friend std::pair<std::unique_ptr<transport>, std::unique_ptr<transport>> make_loopback_pair(
+            boost::asio::io_context& context1, boost::asio::io_context& context2, size_t capacity);
+
+      private:
+        loopback_transport(
+            std::shared_ptr<impl::loopback_channel> in, std::shared_ptr<impl::loopback_channel> out,
+            boost::asio::io_context& context);
+
+        std::shared_ptr<impl::loopback_channel> in_;
+        std::shared_ptr<impl::loopback_channel> out_;
+
+        // Wake up read_some and write respectively while they're waiting on the other end
+        std::shared_ptr<impl::loopback_signal> read_signal_;
+        std::shared_ptr<impl::loopback_signal> write_signal_;
+
+        // Whether or not this end has been closed
+        std::atomic<bool> closed_ = false;
+    };
+
+    // Creates two connected loopback_transports, the first running on context1, the second on context2
+    std::pair<std::unique_ptr<transport>, std::unique_ptr<transport>> make_loopback_pair(
+        boost::asio::io_context& context1, boost::asio::io_context& context2,
+        size_t capacity = loopback_transport::default_capacity);
+}
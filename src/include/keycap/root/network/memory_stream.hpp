@@ -265,11 +265,37 @@ namespace keycap::root::network
             return std::span<uint8_t>(buffer_.data() + read_position_, buffer_.data() + buffer_.size());
         }
 
+        // Appends size zero-initialized bytes to the stream and returns them so they can be written to directly.
+        // Must be followed by a call to commit, which removes the part that hasn't been written
+        std::span<uint8_t> prepare(size_t size)
+        {
+            auto position = buffer_.size();
+            buffer_.resize(position + size);
+            prepared_ = size;
+
+            return std::span<uint8_t>(buffer_.data() + position, size);
+        }
+
+        // Keeps the first size bytes of the space returned by the last call to prepare
+        void commit(size_t size)
+        {
+            if (size > prepared_)
+                throw exception{"Tried to commit more than has been prepared!"};
+
+            buffer_.resize(buffer_.size() - (prepared_ - size));
+            prepared_ = 0;
+        }
+
         // Decompresses the given length of the buffer
         // May resize (and therefore reallocate) the buffer
         // Returns the size of the decompressed data
         size_t decompress(uint32_t length);
 
+        // Decompresses compressed_length bytes at the read position into uncompressed_length bytes in their place,
+        // as e.g. transmitted by the protocol. Grows the buffer at most once and inflates straight into it.
+        // Returns the size of the decompressed data, which is 0 if the data is malformed or exceeds uncompressed_length
+        size_t decompress(size_t compressed_length, size_t uncompressed_length);
+
         bool has_data_remaining() const;
 
         // Writes the given amount of num_bytes to the given desitnation iterator
@@ -295,6 +321,7 @@ namespace keycap::root::network
 
       private:
         size_t read_position_ = 0;
+        size_t prepared_ = 0;
         std::vector<uint8_t> buffer_;
 
         bool has_remaining(size_t num_bytes) const
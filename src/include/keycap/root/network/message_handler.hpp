@@ -19,8 +19,7 @@
 #include "link_status.hpp"
 #include "service_type.hpp"
 
-#include <boost/uuid/uuid.hpp>
-
+#include <cstdint>
 #include <memory>
 #include <span>
 #include <vector>
@@ -41,6 +40,12 @@ namespace keycap::root::network
 
         bool operator==(message_handler const& rhs) noexcept;
 
+        // Returns the process-wide unique id of the handler. Copies receive a new id
+        std::uint64_t id() const noexcept
+        {
+            return id_;
+        }
+
         // Will get called whenever we've received data.
         virtual bool on_data(data_router const& router, service_type service, std::span<uint8_t> data) = 0;
 
@@ -49,6 +54,6 @@ namespace keycap::root::network
         virtual bool on_link(data_router const& router, service_type service, link_status status) = 0;
 
       protected:
-        boost::uuids::uuid uuid_;
+        std::uint64_t id_;
     };
 }
@@ -0,0 +1,199 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#pragma once
+
+#include <keycap/root/exception.hpp>
+#include "../types.hpp"
+#include "memory_stream.hpp"
+#include "opcode_table.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace keycap::root::network
+{
+    // Returns true if the given type can be decoded by a message_registry. A message declares its opcode as
+    // `static constexpr opcode` (a keycap_enum value or any integral) and its layout either by being trivially
+    // copyable, in which case its bytes are read as they are, or by providing `static Message decode(memory_stream&)`
+    template <typename Message>
+    constexpr bool is_registry_message()
+    {
+        constexpr bool has_opcode = requires { static_cast<uint32>(Message::opcode); };
+        constexpr bool has_decode = requires(memory_stream& stream) {
+            { Message::decode(stream) } -> std::same_as<Message>;
+        };
+
+        return has_opcode && (has_decode || std::is_trivially_copyable_v<Message>);
+    }
+
+    // A set of message types known at compile time. Dispatching a payload decodes it straight into the message
+    // type registered for its opcode and calls the matching overload of the handler, without virtual calls or
+    // runtime lookups. Opcodes below dense_limit are resolved using a constexpr jump table, all others by an
+    // unrolled comparison chain
+    template <typename... Messages>
+    class message_registry
+    {
+        static_assert(sizeof...(Messages) > 0, "A message_registry requires at least one message");
+        static_assert((is_registry_message<Messages>() && ...),
+                      "Messages require a static opcode and must either be trivially copyable or provide decode()");
+
+        static constexpr std::array<uint32, sizeof...(Messages)> opcodes_ = {static_cast<uint32>(Messages::opcode)...};
+
+        static constexpr bool unique_opcodes()
+        {
+            for (size_t i = 0; i < opcodes_.size(); ++i)
+            {
+                for (size_t j = i + 1; j < opcodes_.size(); ++j)
+                {
+                    if (opcodes_[i] == opcodes_[j])
+                        return false;
+                }
+            }
+
+            return true;
+        }
+
+        static_assert(unique_opcodes(), "Every message of a message_registry requires a unique opcode");
+
+      public:
+        // Opcodes up to this value are resolved by indexing a table instead of comparing them one by one
+        static constexpr uint32 dense_limit = 1024;
+
+        // Returns the number of registered messages
+        static constexpr size_t size()
+        {
+            return sizeof...(Messages);
+        }
+
+        // Returns true if a message with the given opcode is registered
+        static constexpr bool contains(uint32 opcode)
+        {
+            return ((opcode == static_cast<uint32>(Messages::opcode)) || ...);
+        }
+
+        // Decodes the given payload into the message registered for the opcode and calls handler(args..., message).
+        // The handler may either return void or a bool indicating success. Returns false if no message is registered
+        // for the opcode, the payload is malformed or the handler failed
+        template <typename Handler, typename... Args>
+        static bool dispatch(uint32 opcode, std::span<uint8_t const> payload, Handler&& handler, Args&&... args)
+        {
+            if constexpr (max_opcode() < dense_limit)
+            {
+                if (opcode > max_opcode())
+                    return false;
+
+                static constexpr auto table = make_jump_table<Handler, Args...>();
+                auto entry = table[opcode];
+                return entry ? entry(payload, handler, args...) : false;
+            }
+            else
+            {
+                bool result = false;
+                [[maybe_unused]] bool found =
+                    ((opcode == static_cast<uint32>(Messages::opcode) &&
+                      (result = invoke<Messages, Handler, Args...>(payload, handler, args...), true)) ||
+                     ...);
+                return result;
+            }
+        }
+
+        // Registers a handler for every message of the registry with the given opcode_table. The payload of a frame
+        // starts after header_size bytes. The handler is called with (router, service, message)
+        template <typename Handler>
+        static void add_to(opcode_table& table, size_t header_size, Handler handler)
+        {
+            (table.add(static_cast<uint32>(Messages::opcode),
+                       [handler, header_size](data_router const& router, service_type service, std::span<uint8_t> frame) {
+                           if (frame.size() < header_size)
+                               return false;
+
+                           return invoke<Messages>(frame.subspan(header_size), handler, router, service);
+                       }),
+             ...);
+        }
+
+      private:
+        static constexpr uint32 max_opcode()
+        {
+            uint32 result = 0;
+            for (auto opcode : opcodes_)
+                result = std::max(result, opcode);
+
+            return result;
+        }
+
+        template <typename Message>
+        static bool decode(std::span<uint8_t const> payload, Message& message)
+        {
+            if constexpr (requires(memory_stream& stream) { Message::decode(stream); })
+            {
+                try
+                {
+                    memory_stream stream{payload};
+                    message = Message::decode(stream);
+                }
+                catch (exception const&)
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                if (payload.size() < sizeof(Message))
+                    return false;
+
+                std::memcpy(&message, payload.data(), sizeof(Message));
+            }
+
+            return true;
+        }
+
+        template <typename Message, typename Handler, typename... Args>
+        static bool invoke(std::span<uint8_t const> payload, Handler& handler, Args&... args)
+        {
+            Message message{};
+            if (!decode(payload, message))
+                return false;
+
+            if constexpr (std::is_void_v<std::invoke_result_t<Handler&, Args&..., Message const&>>)
+            {
+                handler(args..., std::as_const(message));
+                return true;
+            }
+            else
+            {
+                return static_cast<bool>(handler(args..., std::as_const(message)));
+            }
+        }
+
+        template <typename Handler, typename... Args>
+        static constexpr auto make_jump_table()
+        {
+            using entry = bool (*)(std::span<uint8_t const>, std::remove_reference_t<Handler>&, Args&...);
+
+            std::array<entry, max_opcode() + 1> table{};
+            ((table[static_cast<uint32>(Messages::opcode)] = &invoke<Messages, std::remove_reference_t<Handler>, Args...>),
+             ...);
+            return table;
+        }
+    };
+}
@@ -0,0 +1,160 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#pragma once
+
+#include "../utility/hdr_histogram.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace keycap::root::network
+{
+    // A counter which can be incremented by many threads at once without them contending on a single cache line.
+    // Every thread adds to one of several slots, which are only summed up when the counter is read
+    class counter
+    {
+      public:
+        void add(uint64_t value = 1) noexcept
+        {
+            slots_[slot()].value.fetch_add(value, std::memory_order_relaxed);
+        }
+
+        // Returns the sum of all slots. Increments happening concurrently may or may not be included
+        uint64_t value() const noexcept;
+
+      private:
+        static constexpr size_t slot_count = 16;
+
+        struct alignas(64) padded_slot
+        {
+            std::atomic<uint64_t> value = 0;
+        };
+
+        // Returns the slot used by the calling thread
+        static size_t slot() noexcept;
+
+        std::array<padded_slot, slot_count> slots_;
+    };
+
+    // The metrics of a single connection. A connection is only driven by its own coroutines, so plain atomics suffice
+    struct connection_metrics
+    {
+        connection_metrics() noexcept;
+
+        // Process-wide unique, used to tell the connections of a service apart
+        uint64_t const id;
+
+        std::atomic<uint64_t> bytes_received = 0;
+        std::atomic<uint64_t> bytes_sent = 0;
+        std::atomic<uint64_t> reads = 0;
+        std::atomic<uint64_t> writes = 0;
+        std::atomic<uint64_t> errors = 0;
+
+        // Number of messages waiting in the send_queue
+        std::atomic<uint64_t> queued = 0;
+
+        // Total time spent routing received data to the message_handlers, in nanoseconds. Only measured while
+        // latencies are recorded, see service_metrics::record_latency
+        std::atomic<uint64_t> handler_time = 0;
+    };
+
+    // The metrics of all connections of a service, including those that are already closed
+    class service_metrics
+    {
+      public:
+        counter connections;
+        counter bytes_received;
+        counter bytes_sent;
+        counter reads;
+        counter writes;
+        counter errors;
+
+        // Latencies are tracked in nanoseconds up to a minute with a precision of 1%
+        static constexpr uint64_t latency_limit = 60'000'000'000;
+        static constexpr int latency_digits = 2;
+
+        // Time from sending a message until it has been written, in nanoseconds
+        utility::hdr_histogram send_latency{latency_limit, latency_digits};
+
+        // Time from a read completing until the message_handlers processed it, in nanoseconds
+        utility::hdr_histogram handler_time{latency_limit, latency_digits};
+
+        // Whether or not connections record latencies. Recording requires reading the clock twice per read and write;
+        // it's disabled entirely unless the library is built with KEYCAP_ROOT_LATENCY_METRICS
+        bool record_latency() const noexcept
+        {
+#ifdef KEYCAP_ROOT_LATENCY_METRICS
+            return record_latency_.load(std::memory_order_relaxed);
+#else
+            return false;
+#endif
+        }
+
+        void record_latency(bool enabled) noexcept
+        {
+            record_latency_.store(enabled, std::memory_order_relaxed);
+        }
+
+        // Keeps track of the given connection's metrics until it's destroyed
+        void track(std::shared_ptr<connection_metrics const> connection);
+
+        // Calls the given callback for every connection that's still alive
+        void for_each_connection(std::function<void(connection_metrics const& connection)> const& callback) const;
+
+      private:
+        std::atomic<bool> record_latency_ = true;
+
+        mutable std::mutex mutex_;
+        mutable std::vector<std::weak_ptr<connection_metrics const>> connections_;
+    };
+
+    // Renders service_metrics in the Prometheus text exposition format. Metrics of multiple services are grouped
+    // by metric and told apart by a service label
+    class prometheus_writer
+    {
+      public:
+        explicit prometheus_writer(std::string prefix = "keycap");
+
+        // Adds the metrics of the given service, including every of its connections that's still alive
+        void add(std::string_view service, service_metrics const& metrics);
+
+        std::string str() const;
+
+      private:
+        struct family
+        {
+            std::string name;
+            std::string type;
+            std::string help;
+            std::string samples;
+        };
+
+        family& get_family(std::string_view name, std::string_view type, std::string_view help);
+
+        void add_summary(family& target, std::string_view labels, utility::hdr_histogram const& values);
+
+        std::string prefix_;
+        std::vector<family> families_;
+    };
+}
@@ -0,0 +1,86 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#pragma once
+
+#include "../types.hpp"
+#include "service_type.hpp"
+
+#include <functional>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace keycap::root::network
+{
+    class data_router;
+
+    // Describes a single frame within a stream of inbound data
+    struct frame_header
+    {
+        // The message id of the frame
+        uint32 opcode = 0;
+        // Number of bytes the entire frame occupies, including its header. Must not be zero
+        size_t size = 0;
+    };
+
+    // Maps message ids to the single handler responsible for them, so every frame can be dispatched in O(1)
+    // regardless of the number of handlers. Tables are meant to be built once at startup and then shared between
+    // all data_routers using data_router::configure_dispatch
+    class opcode_table
+    {
+      public:
+        // Handles a single, complete frame. Returning false aborts the connection
+        using handler = std::function<bool(data_router const& router, service_type service, std::span<uint8_t> frame)>;
+
+        // Returns the header of the first frame within the given data or an empty optional if the frame hasn't been
+        // received completely yet
+        using frame_reader = std::function<std::optional<frame_header>(std::span<uint8_t const> data)>;
+
+        // Handlers for opcodes below dense_limit are stored in a flat array indexed by the opcode, all others in a hash
+        // table
+        explicit opcode_table(frame_reader reader, uint32 dense_limit = 4096);
+
+        // Registers the handler for the given opcode, replacing any previously registered handler
+        void add(uint32 opcode, handler callback);
+
+        // Returns the handler registered for the given opcode or nullptr if there is none
+        handler const* find(uint32 opcode) const
+        {
+            if (opcode < dense_.size())
+                return dense_[opcode] ? &dense_[opcode] : nullptr;
+
+            if (auto itr = sparse_.find(opcode); itr != sparse_.end())
+                return &itr->second;
+
+            return nullptr;
+        }
+
+        // Returns the header of the first frame within the given data, see frame_reader
+        std::optional<frame_header> read_frame(std::span<uint8_t const> data) const
+        {
+            return reader_(data);
+        }
+
+      private:
+        frame_reader reader_;
+        uint32 dense_limit_ = 0;
+
+        std::vector<handler> dense_;
+        std::unordered_map<uint32, handler> sparse_;
+    };
+}
@@ -16,17 +16,35 @@
 
 #pragma once
 
+#include "../compression/codec.hpp"
+#include "../compression/policy.hpp"
 #include "../types.hpp"
+#include "../utility/crc32.hpp"
 #include "../utility/enum.hpp"
 #include "memory_stream.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <span>
+#include <vector>
+
 namespace keycap::root::network
 {
-    keycap_enum(registered_command, uint16, Update = 0, Request = 1, );
+    keycap_enum(registered_command, uint16, Update = 0, Request = 1, Batch = 2, Compressed = 3, );
 
     // A message that allows RPC like messaging
     struct registered_message
     {
+        // Size of the length field preceding every message
+        static constexpr size_t length_size = sizeof(uint64);
+        // Size of the fields following the length field: crc, sender and command
+        static constexpr size_t header_size = sizeof(uint32) + sizeof(uint64) + sizeof(registered_command);
+        // Offset of the first byte covered by the checksum
+        static constexpr size_t checksum_offset = length_size + sizeof(uint32);
+
         // CRC32 of the sender, command and payload
         uint32 crc = 0;
         // Unique number of the sender. Used to route the answer back to the sender
@@ -36,10 +54,62 @@ namespace keycap::root::network
         // The command's payload
         memory_stream payload;
 
+        // Calculates the checksum of sender, command and payload using the given algorithm and stores it in crc
+        void sign(utility::checksum_algorithm algorithm = utility::checksum_algorithm::Crc32)
+        {
+            crc = utility::checksum(algorithm, sender, command, payload);
+        }
+
+        // Returns whether or not crc matches the checksum of sender, command and payload.
+        // Both ends of a connection must agree on the algorithm
+        bool validate(utility::checksum_algorithm algorithm = utility::checksum_algorithm::Crc32) const
+        {
+            return utility::validate_checksum(algorithm, crc, sender, command, payload);
+        }
+
+        // Replaces the payload by the original command followed by a frame of the payload compressed with the given
+        // codec and changes the command to registered_command::Compressed. Must be called before signing
+        void compress(compression::codec const& codec)
+        {
+            pack(compression::compress(codec, payload.to_span()));
+        }
+
+        // Compresses the payload like compress(codec) if the given policy considers it worth it for messages of the
+        // given type. Leaves the message untouched otherwise, which saves the overhead of an uncompressed frame
+        void compress(compression::compression_policy& policy, uint32 message_type)
+        {
+            auto frame = policy.compress(payload.to_span(), message_type);
+            if (compression::read_frame_header(frame)->codec != compression::codec_type::None)
+                pack(frame);
+        }
+
+        // Restores the command and payload of a message packed by compress, using a codec matching the one it has
+        // been compressed with. Returns whether or not the payload could be decompressed.
+        // Payloads that don't compress are stored uncompressed by every codec, including ones using a dictionary, so
+        // such frames are accepted by any codec; they can't be mistaken for data of another dictionary
+        bool decompress(compression::codec const& codec)
+        {
+            if (command.get() != registered_command::Compressed || payload.size() < sizeof(registered_command))
+                return false;
+
+            auto original = payload.get<registered_command>();
+            auto frame = payload.to_span();
+            auto data = compression::decompress(codec, frame);
+
+            // Failing to decompress yields nothing as well, which is only valid for empty payloads
+            auto header = compression::read_frame_header(frame);
+            if (!header || data.size() != header->uncompressed_size)
+                return false;
+
+            command = original;
+            payload = memory_stream(data);
+            return true;
+        }
+
         memory_stream encode()
         {
             memory_stream encoder;
-            encoder.put<uint64>(sizeof(uint32) + sizeof(uint64) + sizeof(registered_command) + payload.size());
+            encoder.put<uint64>(header_size + payload.size());
             encoder.put(crc);
             encoder.put(sender);
             encoder.put(command);
@@ -47,23 +117,220 @@ namespace keycap::root::network
             return encoder;
         }
 
-        static registered_message decode(memory_stream& decoder)
+        // Decodes the next message from the given stream. Must only be called if can_decode returned true.
+        // Releases the memory occupied by the message if shrink is set
+        static registered_message decode(memory_stream& decoder, bool shrink = true)
         {
             registered_message packet;
-            decoder.get<uint64>();
+            auto size = decoder.get<uint64>();
+            if (size < header_size)
+                throw exception{"Malformed registered_message!"};
+
             packet.crc = decoder.get<uint32>();
             packet.sender = decoder.get<uint64>();
             packet.command = decoder.get<registered_command>();
-            packet.payload = decoder.get_remaining();
 
-            decoder.shrink();
+            size_t payload_size = size - header_size;
+            auto data = decoder.to_span();
+            packet.payload = memory_stream(data.begin(), data.begin() + payload_size);
+            decoder.advance(static_cast<int>(payload_size));
+
+            if (shrink)
+                decoder.shrink();
 
             return packet;
         }
 
+        // Returns whether or not the given stream contains a complete message
         static bool can_decode(memory_stream const& decoder)
         {
-            return decoder.peek<uint64>() <= decoder.size();
+            return decoder.size() >= length_size && decoder.peek<uint64>() <= decoder.size() - length_size;
+        }
+
+      private:
+        // Replaces the payload by the original command followed by the given frame of the payload
+        void pack(std::span<uint8_t const> frame)
+        {
+            memory_stream compressed;
+            compressed.put(command);
+            compressed.put(frame);
+
+            command = registered_command::Compressed;
+            payload = std::move(compressed);
+        }
+    };
+
+    // Packs many small messages into a single registered_message of type registered_command::Batch so they share a
+    // single header and a single checksum. Every entry is stored as: size, sender, command, payload
+    class registered_batch
+    {
+      public:
+        // Appends the given message to the batch
+        void add(uint64 sender, registered_command command, memory_stream const& payload)
+        {
+            payload_.put(static_cast<uint32>(sizeof(uint64) + sizeof(registered_command) + payload.size()));
+            payload_.put(sender);
+            payload_.put(command);
+            payload_.put(payload);
+            ++count_;
+        }
+
+        // Returns the number of messages in the batch
+        size_t count() const
+        {
+            return count_;
+        }
+
+        // Returns the number of bytes the batch's payload currently occupies
+        size_t size() const
+        {
+            return payload_.size();
+        }
+
+        bool empty() const
+        {
+            return count_ == 0;
+        }
+
+        // Returns the batch as a single registered_message signed with the given algorithm
+        registered_message to_message(utility::checksum_algorithm algorithm = utility::checksum_algorithm::Crc32) const
+        {
+            registered_message msg;
+            msg.sender = 0;
+            msg.command = registered_command::Batch;
+            msg.payload = payload_;
+            msg.sign(algorithm);
+            return msg;
+        }
+
+        // Splits the payload of a registered_command::Batch message into its messages.
+        // Returns an empty optional if the payload is malformed
+        static std::optional<std::vector<registered_message>> unpack(memory_stream& payload)
+        {
+            constexpr size_t header_size = sizeof(uint64) + sizeof(registered_command);
+
+            std::vector<registered_message> messages;
+
+            while (payload.size() >= sizeof(uint32))
+            {
+                auto size = payload.get<uint32>();
+                if (size < header_size || size > payload.size())
+                    return {};
+
+                registered_message msg;
+                msg.sender = payload.get<uint64>();
+                msg.command = payload.get<registered_command>();
+
+                auto data = payload.to_span();
+                msg.payload = memory_stream(data.begin(), data.begin() + (size - header_size));
+                payload.advance(static_cast<int>(size - header_size));
+
+                messages.push_back(std::move(msg));
+            }
+
+            if (payload.has_data_remaining())
+                return {};
+
+            return messages;
+        }
+
+      private:
+        memory_stream payload_;
+        size_t count_ = 0;
+    };
+
+    // Reassembles registered_messages from a stream of bytes. Each message's checksum is calculated while its bytes
+    // arrive, so it is known as soon as the message is complete and the payload doesn't need to be read twice.
+    class registered_message_reader
+    {
+      public:
+        explicit registered_message_reader(
+            utility::checksum_algorithm algorithm = utility::checksum_algorithm::Crc32) noexcept
+          : crc_{algorithm}
+        {
+        }
+
+        // Appends the given data and advances the checksum of all messages it completes or continues
+        void put(std::span<uint8_t> data)
+        {
+            stream_.shrink();
+            stream_.put(data);
+            update_checksums();
+        }
+
+        // Returns whether or not a complete message (or a malformed one) is waiting to be read
+        bool can_read() const
+        {
+            return malformed_ || !checksums_.empty();
         }
+
+        // Reads the next complete message. Returns an empty optional if the message is malformed or its checksum
+        // doesn't match. The reader must not be used after a failed read
+        std::optional<registered_message> read()
+        {
+            if (checksums_.empty())
+                return {};
+
+            auto checksum = checksums_.front();
+            checksums_.pop_front();
+
+            auto msg = registered_message::decode(stream_, false);
+            frame_offset_ -= registered_message::length_size + registered_message::header_size + msg.payload.size();
+
+            if (msg.crc != checksum)
+                return {};
+
+            return msg;
+        }
+
+        // Discards all buffered data. Needs to be called when the underlying connection was reset
+        void reset()
+        {
+            stream_.clear();
+            checksums_.clear();
+            crc_.reset();
+            frame_offset_ = 0;
+            malformed_ = false;
+        }
+
+      private:
+        void update_checksums()
+        {
+            auto data = stream_.to_span();
+
+            while (!malformed_ && data.size() >= frame_offset_ + registered_message::length_size)
+            {
+                uint64 length = 0;
+                std::memcpy(&length, data.data() + frame_offset_, sizeof(length));
+                if (length < registered_message::header_size
+                    || length > std::numeric_limits<size_t>::max() - registered_message::length_size)
+                {
+                    malformed_ = true;
+                    return;
+                }
+
+                size_t frame_size = registered_message::length_size + length;
+                auto available = std::min(data.size() - frame_offset_, frame_size);
+                size_t hashed = registered_message::checksum_offset + crc_.size();
+
+                if (available > hashed)
+                    crc_.update(data.data() + frame_offset_ + hashed, available - hashed);
+
+                if (available < frame_size)
+                    return;
+
+                checksums_.push_back(crc_.value());
+                crc_.reset();
+                frame_offset_ += frame_size;
+            }
+        }
+
+        memory_stream stream_;
+        utility::crc_stream crc_;
+        // Checksums of all complete messages that haven't been read yet
+        std::deque<uint32> checksums_;
+        // Offset of the message currently being checksummed, relative to the stream's read position
+        size_t frame_offset_ = 0;
+        bool malformed_ = false;
     };
 }
\ No newline at end of file
@@ -0,0 +1,106 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#pragma once
+
+#include "../types.hpp"
+#include "shared_buffer.hpp"
+
+#include <array>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <span>
+
+namespace keycap::root::network
+{
+    // Defines the lane a message is queued in by a send_queue
+    enum class send_priority : uint8
+    {
+        // Always sent before any Normal or Low message, e.g. latency-critical control messages
+        High,
+        // Regular traffic
+        Normal,
+        // Bulk transfers, e.g. compressed data blobs
+        Low,
+    };
+
+    // The outgoing messages of a connection, split into one FIFO lane per send_priority.
+    // High messages are always sent first. Normal and Low messages share the remaining bandwidth by weight, so bulk
+    // transfers can't starve regular traffic and vice versa. Large payloads can be queued in chunks, which allows
+    // messages of higher priority to be sent in between two chunks.
+    class send_queue
+    {
+      public:
+        // Turns a chunk of a large payload into a message of its own. Since messages from other lanes may be sent in
+        // between two chunks, every chunk has to be framed so that the receiver can reassemble the payload
+        using framer = std::function<shared_buffer(std::span<uint8 const> chunk, bool last)>;
+
+        using time_point = std::chrono::steady_clock::time_point;
+
+        // Queues the given message. queued_at is handed back by pop, e.g. to measure how long the message was queued
+        void push(shared_buffer data, send_priority priority = send_priority::Normal, time_point queued_at = {});
+
+        // Queues the given payload as a series of chunks of at most chunk_size bytes, each of which is framed by the
+        // given framer right before it's sent
+        void push_chunked(
+            shared_buffer data, send_priority priority, size_t chunk_size, framer frame, time_point queued_at = {});
+
+        // Removes the next message to be sent from the queue and returns it. Returns nullptr if the queue is empty
+        shared_buffer pop();
+
+        // Same as pop(), additionally returns the time the message was pushed with. Chunks return the time of their
+        // payload
+        shared_buffer pop(time_point& queued_at);
+
+        // Returns whether or not there are messages left to send
+        bool empty() const;
+
+        // Returns the number of messages or chunked payloads queued with the given priority
+        size_t size(send_priority priority) const;
+
+        // Returns the number of messages or chunked payloads queued in all lanes
+        size_t size() const;
+
+        // Sets how many Normal messages are sent for every Low message if both lanes are busy. Defaults to 4
+        void set_weights(uint32 normal, uint32 low);
+
+      private:
+        struct entry
+        {
+            shared_buffer data;
+            time_point queued_at;
+
+            // Only used by chunked entries
+            size_t offset = 0;
+            size_t chunk_size = 0;
+            framer frame;
+        };
+
+        // Returns the lane the next message should be taken from
+        std::deque<entry>& next_lane();
+
+        mutable std::mutex mutex_;
+        std::array<std::deque<entry>, 3> lanes_;
+
+        uint32 normal_weight_ = 4;
+        uint32 low_weight_ = 1;
+        // Number of messages the weighted lanes have sent within the current round
+        uint32 normal_sent_ = 0;
+        uint32 low_sent_ = 0;
+    };
+}
@@ -17,6 +17,7 @@
 #pragma once
 
 #include "../utility/enum.hpp"
+#include "loopback_transport.hpp"
 #include "service_base.hpp"
 
 #include <boost/asio.hpp>
@@ -24,6 +25,7 @@
 #include <memory>
 #include <string>
 #include <thread>
+#include <type_traits>
 
 namespace keycap::root::network
 {
@@ -64,14 +66,26 @@ namespace keycap::root::network
             }
         }
 
-        // Starts listening for network communications on or connects to the given host and port
+        // Starts listening for network communications on or connects to the given host and port.
+        // Clients connect to servers running within the same process through a loopback_transport instead of TCP if
+        // both of them support it
         void start(std::string const& host, uint16_t port)
         {
-            endpoint_ = resolve(host, port);
+            start(service_endpoint::tcp(host, port));
+        }
+
+        // Starts listening for network communications on or connects to the given endpoint using the transport it
+        // specifies. Unix and SharedMemory endpoints require the Connection to support transports other than TCP,
+        // see make_local_handler. Services within the same process still connect through a loopback_transport
+        void start(service_endpoint const& endpoint)
+        {
+            address_ = endpoint;
+            if (address_.kind == transport_kind::Tcp)
+                endpoint_ = resolve(address_.host, address_.port);
 
             if (mode_ == service_mode::Server)
                 listen();
-            else if (mode_ == service_mode::Client)
+            else if (mode_ == service_mode::Client && !connect_local())
                 connect();
 
             running_ = true;
@@ -82,7 +96,7 @@ namespace keycap::root::network
         {
             if (mode_ == service_mode::Server)
                 listen();
-            else if (mode_ == service_mode::Client)
+            else if (mode_ == service_mode::Client && !connect_local())
                 connect();
 
             running_ = true;
@@ -92,6 +106,8 @@ namespace keycap::root::network
         // Stops listening for new connections. Any asynchronous accept operations will be cancelled immediately
         void stop()
         {
+            unlisten_local();
+
             running_ = false;
             acceptor_.close();
             io_context_.stop();
@@ -109,7 +125,35 @@ namespace keycap::root::network
       protected:
         virtual SharedHandler make_handler(boost::asio::ip::tcp::socket socket) = 0;
 
+        // Creates a connection using a transport other than TCP. Returns nullptr if the transport isn't supported,
+        // which is the default unless the Connection can be constructed from the transport and the service
+        virtual SharedHandler make_local_handler(std::unique_ptr<transport> transport)
+        {
+            if constexpr (std::is_constructible_v<Connection, std::unique_ptr<network::transport>, service_base&>)
+                return std::make_shared<Connection>(std::move(transport), *this);
+            else
+                return nullptr;
+        }
+
       private:
+        bool connect_local()
+        {
+            SharedHandler handler;
+
+            auto connected = with_local_server([&](service_base& server) {
+                auto [client, host] = make_loopback_pair(io_context_, server.io_context());
+
+                handler = make_local_handler(std::move(client));
+                return handler && server.handle_local_connection(std::move(host));
+            });
+
+            if (!connected)
+                return false;
+
+            boost::asio::post(io_context_, [this, handler] { accept(handler); });
+            return true;
+        }
+
         void run_thread_pool()
         {
             if (io_context_.stopped())
@@ -130,7 +174,25 @@ namespace keycap::root::network
 
         void handle_new_connection(boost::asio::ip::tcp::socket socket) override
         {
-            auto handler = make_handler(std::move(socket));
+            accept(make_handler(std::move(socket)));
+        }
+
+        bool handle_local_connection(std::unique_ptr<transport> transport) override
+        {
+            auto handler = make_local_handler(std::move(transport));
+            if (!handler)
+                return false;
+
+            // Local connections are initiated by the client's thread
+            boost::asio::post(io_context_, [this, handler] { accept(handler); });
+            return true;
+        }
+
+        void accept(SharedHandler handler)
+        {
+            metrics_.connections.add();
+            metrics_.track(handler->metrics());
+
             handler->get_router().configure_outbound(handler);
 
             if (!on_new_connection(handler))
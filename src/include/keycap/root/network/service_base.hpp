@@ -16,11 +16,17 @@
 
 #pragma once
 
+#include "metrics.hpp"
+#include "service_endpoint.hpp"
 #include "service_type.hpp"
+#include "transport.hpp"
 
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/ip/tcp.hpp>
 
+#include <functional>
+#include <memory>
+
 namespace keycap::root::network
 {
     class service_base
@@ -38,21 +44,48 @@ namespace keycap::root::network
             return running_;
         }
 
+        // Returns the metrics of all connections of the service
+        service_metrics& metrics()
+        {
+            return metrics_;
+        }
+
         virtual void handle_new_connection(boost::asio::ip::tcp::socket socket) = 0;
-        virtual ~service_base() = default;
+
+        // Handles a connection that doesn't use a TCP socket, e.g. one to a service within the same process or one
+        // over a unix domain socket. Returns false if the service doesn't support the transport, in which case it gets
+        // closed
+        virtual bool handle_local_connection(std::unique_ptr<transport> /*transport*/)
+        {
+            return false;
+        }
+
+        virtual ~service_base();
 
       protected:
         boost::asio::ip::tcp::endpoint resolve(std::string const& host, uint16_t port);
 
+        // Listens on or connects to address_ using the transport it specifies. For Tcp, endpoint_ is used instead
         void listen();
 
         void connect();
 
+        // Calls the given callback with the server listening on address_ within the same process, if there is one.
+        // The server can't be stopped while the callback is running. Returns false if there is no such server,
+        // otherwise whatever the callback returned
+        bool with_local_server(std::function<bool(service_base& server)> const& callback);
+
+        // Stops being available to with_local_server of services within the same process
+        void unlisten_local();
+
         boost::asio::io_context io_context_;
         boost::asio::ip::tcp::endpoint endpoint_;
+        service_endpoint address_;
 
         bool running_ = false;
 
+        service_metrics metrics_;
+
       private:
         service_type type_;
     };
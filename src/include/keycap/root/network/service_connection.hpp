@@ -20,6 +20,11 @@
 #include "connection.hpp"
 #include "registered_message.hpp"
 
+#include <iterator>
+#include <memory>
+#include <span>
+#include <vector>
+
 namespace keycap::root::network
 {
     class service_connection : public connection, public message_handler
@@ -32,16 +37,66 @@ namespace keycap::root::network
         {
         }
 
+        service_connection(std::unique_ptr<transport> transport, service_base& base_service)
+          : connection{std::move(transport), base_service}
+        {
+        }
+
         virtual bool on_data(data_router const& router, service_type service, uint64 sender, memory_stream& stream) = 0;
 
+        // Will get called with all messages that have been completed by the same chunk of received data, in the order
+        // they were sent. Calls on_data for every message by default; override to share locking and allocations
+        // between them. Returning false aborts the connection.
+        virtual bool on_batch(data_router const& router, service_type service, std::span<registered_message> messages)
+        {
+            for (auto& msg : messages)
+            {
+                if (!on_data(router, service, msg.sender, msg.payload))
+                    return false;
+            }
+
+            return true;
+        }
+
+        // Sets the algorithm used to sign and validate messages. Must match the one used by the other end
+        void set_checksum_algorithm(utility::checksum_algorithm algorithm)
+        {
+            checksum_ = algorithm;
+            reader_ = registered_message_reader{algorithm};
+        }
+
+        // Decompresses messages compressed by the service_locator with the given codec, which must match its codec,
+        // and compresses answers worth it according to a compression_policy using the given settings with it.
+        // Passing nullptr sends answers uncompressed again
+        void set_compression(std::shared_ptr<compression::codec const> codec, compression::policy_settings settings = {})
+        {
+            if (codec)
+                compression_ = std::make_shared<compression::compression_policy>(std::move(codec), settings);
+            else
+                compression_.reset();
+        }
+
+        // Returns the decisions the compression_policy made so far. Empty if compression is disabled
+        compression::policy_statistics compression_statistics() const
+        {
+            if (!compression_)
+                return {};
+
+            return compression_->statistics();
+        }
+
         void send_answer(uint64 receiver, memory_stream const& payload)
         {
             registered_message msg;
-            msg.crc = utility::crc32(receiver, registered_command::Request, payload);
             msg.sender = receiver;
             msg.command = registered_command::Request;
             msg.payload = payload;
 
+            if (compression_)
+                msg.compress(*compression_, static_cast<uint32>(msg.command.get()));
+
+            msg.sign(checksum_);
+
             auto stream = msg.encode();
             send(std::span(stream.data(), stream.size()));
         }
@@ -49,22 +104,46 @@ namespace keycap::root::network
       private:
         bool on_data(data_router const& router, service_type service, std::span<uint8_t> data) final
         {
-            input_stream_.put(data);
-
-            if (!registered_message::can_decode(input_stream_))
-                return true;
+            reader_.put(data);
 
-            auto msg = registered_message::decode(input_stream_);
+            // batch_ keeps its capacity between reads
+            batch_.clear();
 
-            if (!utility::validate_crc32(msg.crc, msg.sender, msg.command, msg.payload))
+            while (reader_.can_read())
             {
-                // TODO: implement error handling callback
-                return false;
+                auto msg = reader_.read();
+                if (!msg)
+                {
+                    // TODO: implement error handling callback
+                    return false;
+                }
+
+                if (msg->command.get() == registered_command::Compressed
+                    && (!compression_ || !msg->decompress(compression_->get_codec())))
+                    return false;
+
+                if (msg->command.get() != registered_command::Batch)
+                {
+                    batch_.push_back(std::move(*msg));
+                    continue;
+                }
+
+                auto messages = registered_batch::unpack(msg->payload);
+                if (!messages)
+                    return false;
+
+                std::move(messages->begin(), messages->end(), std::back_inserter(batch_));
             }
 
-            return on_data(router, service, msg.sender, msg.payload);
+            if (batch_.empty())
+                return true;
+
+            return on_batch(router, service, batch_);
         }
 
-        memory_stream input_stream_;
+        registered_message_reader reader_;
+        std::vector<registered_message> batch_;
+        utility::checksum_algorithm checksum_ = utility::checksum_algorithm::Crc32;
+        std::shared_ptr<compression::compression_policy> compression_;
     };
 }
\ No newline at end of file
@@ -0,0 +1,72 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#pragma once
+
+#include "transport.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace keycap::root::network
+{
+    // Describes where a service listens for or connects to other services and which transport it uses to do so
+    struct service_endpoint
+    {
+        // Number of bytes that can be in flight per direction of a SharedMemory connection by default
+        static constexpr size_t default_capacity = 256 * 1024;
+
+        // Tcp, Unix or SharedMemory
+        transport_kind kind = transport_kind::Tcp;
+
+        // Tcp only
+        std::string host;
+        uint16_t port = 0;
+
+        // Unix and SharedMemory only: the path of the unix domain socket. SharedMemory connections use it to exchange
+        // the name of the shared memory segment and to wake up the other end
+        std::string path;
+
+        // SharedMemory only: number of bytes that can be in flight per direction
+        size_t capacity = default_capacity;
+
+        static service_endpoint tcp(std::string host, uint16_t port)
+        {
+            service_endpoint endpoint;
+            endpoint.kind = transport_kind::Tcp;
+            endpoint.host = std::move(host);
+            endpoint.port = port;
+            return endpoint;
+        }
+
+        static service_endpoint unix_socket(std::string path)
+        {
+            service_endpoint endpoint;
+            endpoint.kind = transport_kind::Unix;
+            endpoint.path = std::move(path);
+            return endpoint;
+        }
+
+        static service_endpoint shared_memory(std::string path, size_t capacity = default_capacity)
+        {
+            service_endpoint endpoint;
+            endpoint.kind = transport_kind::SharedMemory;
+            endpoint.path = std::move(path);
+            endpoint.capacity = capacity;
+            return endpoint;
+        }
+    };
+}
@@ -20,8 +20,12 @@
 #include "../utility/schedule.hpp"
 #include "connection.hpp"
 #include "message_handler.hpp"
+#include "registered_message.hpp"
 #include "service.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
 #include <optional>
 #include <unordered_map>
 
@@ -43,12 +47,20 @@ namespace keycap::root::network
             located_callback callback;
         };
 
+        ~service_locator();
+
         // Creates a new service of the given type with the given host and port if none for this type exists.
         // Will call the given callback, when the service is located, if provided
         void locate(
             service_type type, std::string const& host, uint16_t port,
             std::optional<located_callback_container> callback = {});
 
+        // Creates a new service of the given type connecting to the given endpoint if none for this type exists.
+        // Allows locating services on the same host through a unix domain socket or shared memory
+        void locate(
+            service_type type, service_endpoint const& endpoint,
+            std::optional<located_callback_container> callback = {});
+
         // Removes the callback when locating the given service_type
         void remove_located_callback(service_type type);
 
@@ -56,6 +68,32 @@ namespace keycap::root::network
         // disconnected), the message will be placed in a queue and will be send once the service is located.
         void send_to(service_type type, memory_stream const& message);
 
+        // Sets the window in which messages passed to send_to are collected and then send as a single batch.
+        // A window of zero (the default) sends every message immediately
+        void set_flush_window(std::chrono::milliseconds window);
+
+        // Sends all messages that are currently waiting for their flush window to pass
+        void flush();
+
+        // Sets the algorithm used to sign and validate messages. Must match the one used by the located services
+        void set_checksum_algorithm(utility::checksum_algorithm algorithm);
+
+        // Compresses messages sent with the given codec, e.g. one using a dictionary trained from typical messages
+        // so small ones compress as well, and decompresses compressed answers with it. The located services must use
+        // a matching codec. A compression_policy using the given settings skips messages that aren't worth it,
+        // grouped by their registered_command; lower settings.min_size for dictionaries. Passing nullptr sends
+        // messages uncompressed again
+        void set_compression(std::shared_ptr<compression::codec const> codec, compression::policy_settings settings = {});
+
+        // Returns the decisions the compression_policy made so far. Empty if compression is disabled
+        compression::policy_statistics compression_statistics() const;
+
+        // Compresses the links to services located afterwards using deflate streams that live as long as the link, see
+        // connection::enable_compression, which the located services must enable as well. Unlike set_compression this
+        // exploits the redundancy between messages, so the two shouldn't be combined. Passing an empty optional leaves
+        // links located afterwards uncompressed again
+        void set_stream_compression(std::optional<int> level);
+
         using registered_callback = std::function<bool(service_type sender, memory_stream data)>;
 
         // bool (*)(service_type sender, memory_stream data);
@@ -76,12 +114,27 @@ namespace keycap::root::network
 
         void send_to_(service_type type, memory_stream& message);
 
+        // Compresses the given message if compression is enabled, signs it and sends it to the given service_type
+        void send_message(service_type type, registered_message& message);
+
+        // Sends the batch for the given service_type. Only sends it if it still is of the given generation if one is
+        // given, so the timer of a batch that has been flushed early doesn't flush the next one prematurely
+        void flush(service_type type, std::optional<uint64> generation = {});
+
+        // Handles a message received from the given service, unpacking it if it's a batch
+        bool on_message(service_type sender_type, registered_message& msg);
+
+        // Routes the given answer to the callback registered for its sender
+        bool on_answer(service_type sender_type, registered_message& msg);
+
         class connection : public keycap::root::network::connection
         {
             using base = keycap::root::network::connection;
 
           public:
             connection(boost::asio::ip::tcp::socket socket, service_base& service, service_locator* locator);
+
+            connection(std::unique_ptr<transport> transport, service_base& service, service_locator* locator);
         };
 
         class service : public keycap::root::network::service<connection>
@@ -93,6 +146,8 @@ namespace keycap::root::network
 
             virtual SharedHandler make_handler(boost::asio::ip::tcp::socket socket) override;
 
+            virtual SharedHandler make_local_handler(std::unique_ptr<transport> transport) override;
+
             std::weak_ptr<connection> connection_;
 
           private:
@@ -112,6 +167,25 @@ namespace keycap::root::network
 
         std::unordered_map<service_type_t, located_callback_container> located_callbacks_;
 
+        // Batches larger than this will be send without waiting for the flush window to pass
+        static constexpr size_t max_batch_size = 64 * 1024;
+        utility::checksum_algorithm checksum_ = utility::checksum_algorithm::Crc32;
+        std::atomic<std::shared_ptr<compression::compression_policy>> compression_;
+        std::atomic<std::optional<int>> stream_compression_;
+        std::unordered_map<service_type_t, registered_message_reader> readers_;
+        std::mutex readers_mutex_;
+
+        std::atomic<std::chrono::milliseconds> flush_window_{std::chrono::milliseconds{0}};
+
+        struct pending_batch
+        {
+            registered_batch batch;
+            // Incremented whenever the batch is sent
+            uint64 generation = 0;
+        };
+        std::unordered_map<service_type_t, pending_batch> batches_;
+        std::mutex batches_mutex_;
+
         utility::schedule schedule_;
     };
 }
\ No newline at end of file
@@ -0,0 +1,34 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace keycap::root::network
+{
+    // An immutable, reference counted buffer which can be sent to any number of connections without copying it
+    using shared_buffer = std::shared_ptr<std::vector<std::uint8_t> const>;
+
+    // Copies the given data into a new shared_buffer
+    inline shared_buffer make_shared_buffer(std::span<std::uint8_t const> data)
+    {
+        return std::make_shared<std::vector<std::uint8_t> const>(data.begin(), data.end());
+    }
+}
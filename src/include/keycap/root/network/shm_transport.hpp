@@ -0,0 +1,75 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#pragma once
+
+#include "transport.hpp"
+
+#include <boost/asio/local/stream_protocol.hpp>
+
+#include <memory>
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS) && !defined(_WIN32)
+#define KEYCAP_ROOT_HAS_SHM_TRANSPORT 1
+#endif
+
+namespace keycap::root::network
+{
+#if defined(KEYCAP_ROOT_HAS_SHM_TRANSPORT)
+    namespace impl
+    {
+        struct shm_state;
+    }
+
+    // Connects two processes on the same host through a pair of spsc_rings in a POSIX shared memory segment.
+    // A unix domain socket is used to exchange the name of the segment and afterwards only as a doorbell, which is rung
+    // if the other end is actually waiting for data or free space. Closing either end or the other process going away
+    // closes the connection.
+    // Every end must only be used by a single connection and a single thread at a time
+    class shm_transport final : public transport
+    {
+      public:
+        ~shm_transport() override;
+
+        boost::asio::awaitable<size_t> read_some(std::span<uint8_t> buffer) override;
+
+        boost::asio::awaitable<void> write(std::span<uint8_t const> data) override;
+
+        void close() override;
+
+        bool is_open() const override;
+
+        transport_kind kind() const override
+        {
+            return transport_kind::SharedMemory;
+        }
+
+        // Creates a shared memory segment holding capacity bytes per direction and hands it over to the server on the
+        // other end of the given, connected socket
+        static boost::asio::awaitable<std::unique_ptr<transport>> connect(
+            boost::asio::local::stream_protocol::socket doorbell, size_t capacity);
+
+        // Maps the shared memory segment the client on the other end of the given, accepted socket created
+        static boost::asio::awaitable<std::unique_ptr<transport>> accept(
+            boost::asio::local::stream_protocol::socket doorbell);
+
+      private:
+        explicit shm_transport(std::shared_ptr<impl::shm_state> state);
+
+        std::shared_ptr<impl::shm_state> state_;
+    };
+#endif
+}
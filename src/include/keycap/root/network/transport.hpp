@@ -0,0 +1,114 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#pragma once
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+
+#include <cstdint>
+#include <span>
+
+namespace keycap::root::network
+{
+    // Defines how the bytes of a connection are transported
+    enum class transport_kind
+    {
+        // A TCP socket
+        Tcp,
+        // Ring buffers shared with another service within the same process
+        Loopback,
+        // A unix domain stream socket
+        Unix,
+        // Ring buffers in memory shared with another process on the same host
+        SharedMemory,
+    };
+
+    // A bidirectional byte stream a connection sends and receives its data through
+    class transport
+    {
+      public:
+        virtual ~transport() = default;
+
+        // Reads at least one byte into the given buffer and returns the number of bytes read.
+        // Throws a boost::system::system_error once the stream has been closed
+        virtual boost::asio::awaitable<size_t> read_some(std::span<uint8_t> buffer) = 0;
+
+        // Writes all of the given data. Throws a boost::system::system_error if the stream has been closed
+        virtual boost::asio::awaitable<void> write(std::span<uint8_t const> data) = 0;
+
+        // Closes the stream, cancelling all pending operations of both ends
+        virtual void close() = 0;
+
+        // Returns whether or not close hasn't been called on this end. The other end closing is reported by read_some
+        // once all data it has written has been read
+        virtual bool is_open() const = 0;
+
+        virtual transport_kind kind() const = 0;
+    };
+
+    class tcp_transport final : public transport
+    {
+      public:
+        explicit tcp_transport(boost::asio::ip::tcp::socket socket);
+
+        boost::asio::awaitable<size_t> read_some(std::span<uint8_t> buffer) override;
+
+        boost::asio::awaitable<void> write(std::span<uint8_t const> data) override;
+
+        void close() override;
+
+        bool is_open() const override;
+
+        transport_kind kind() const override
+        {
+            return transport_kind::Tcp;
+        }
+
+        boost::asio::ip::tcp::socket& socket();
+
+      private:
+        boost::asio::ip::tcp::socket socket_;
+    };
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    class unix_transport final : public transport
+    {
+      public:
+        explicit unix_transport(boost::asio::local::stream_protocol::socket socket);
+
+        boost::asio::awaitable<size_t> read_some(std::span<uint8_t> buffer) override;
+
+        boost::asio::awaitable<void> write(std::span<uint8_t const> data) override;
+
+        void close() override;
+
+        bool is_open() const override;
+
+        transport_kind kind() const override
+        {
+            return transport_kind::Unix;
+        }
+
+        boost::asio::local::stream_protocol::socket& socket();
+
+      private:
+        boost::asio::local::stream_protocol::socket socket_;
+    };
+#endif
+}
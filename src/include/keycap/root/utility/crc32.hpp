@@ -18,7 +18,8 @@
 
 #include "../types.hpp"
 
-#include <boost/crc.hpp>
+#include <cstddef>
+#include <span>
 
 namespace keycap::root::network
 {
@@ -27,33 +28,166 @@ namespace keycap::root::network
 
 namespace keycap::root::utility
 {
+    // The checksum algorithms that are available for protecting data
+    enum class checksum_algorithm : uint8
+    {
+        // CRC-32 (IEEE 802.3), as used by zlib. Accelerated using PCLMULQDQ if available
+        Crc32,
+        // CRC-32C (Castagnoli). Accelerated using the SSE4.2 crc32 instruction if available
+        Crc32c,
+    };
+
+    // Continues the given CRC-32 with the given data. Pass 0 as crc to start a new checksum.
+    uint32 crc32_update(uint32 crc, void const* data, size_t size);
+
+    // Continues the given CRC-32C with the given data. Pass 0 as crc to start a new checksum.
+    uint32 crc32c_update(uint32 crc, void const* data, size_t size);
+
+    // Continues the given checksum with the given data using the given algorithm
+    inline uint32 checksum_update(checksum_algorithm algorithm, uint32 crc, void const* data, size_t size)
+    {
+        if (algorithm == checksum_algorithm::Crc32c)
+            return crc32c_update(crc, data, size);
+
+        return crc32_update(crc, data, size);
+    }
+
+    // Returns the CRC-32 of two concatenated segments given the CRC-32 of each segment and the size of the second
+    uint32 crc32_combine(uint32 crc1, uint32 crc2, uint64 size2);
+
+    // Returns the CRC-32C of two concatenated segments given the CRC-32C of each segment and the size of the second
+    uint32 crc32c_combine(uint32 crc1, uint32 crc2, uint64 size2);
+
+    inline uint32 checksum_combine(checksum_algorithm algorithm, uint32 crc1, uint32 crc2, uint64 size2)
+    {
+        if (algorithm == checksum_algorithm::Crc32c)
+            return crc32c_combine(crc1, crc2, size2);
+
+        return crc32_combine(crc1, crc2, size2);
+    }
+
     namespace impl
     {
+        struct checksum_state
+        {
+            checksum_algorithm algorithm = checksum_algorithm::Crc32;
+            uint32 value = 0;
+
+            void process_bytes(void const* data, size_t size)
+            {
+                value = checksum_update(algorithm, value, data, size);
+            }
+        };
+
         template <typename T>
-        void hash(boost::crc_32_type& crc, T const& value)
+        void hash(checksum_state& crc, T const& value)
         {
             crc.process_bytes(&value, sizeof(T));
         }
 
         template <>
-        void hash<network::memory_stream>(boost::crc_32_type& crc, network::memory_stream const& stream);
+        void hash<network::memory_stream>(checksum_state& crc, network::memory_stream const& stream);
 
         template <>
-        void hash<std::string>(boost::crc_32_type& crc, std::string const& str);
+        void hash<std::string>(checksum_state& crc, std::string const& str);
 
         template <>
-        void hash<std::array<uint8, 256>>(boost::crc_32_type& crc, std::array<uint8, 256> const& ar);
+        void hash<std::array<uint8, 256>>(checksum_state& crc, std::array<uint8, 256> const& ar);
     }
 
+    // Calculates a checksum over data that arrives piece by piece, so it is available as soon as the last piece
+    // arrived without another pass over the data
+    class crc_stream
+    {
+      public:
+        explicit crc_stream(checksum_algorithm algorithm = checksum_algorithm::Crc32) noexcept
+          : state_{algorithm}
+        {
+        }
+
+        // Continues the checksum with the given data
+        void update(void const* data, size_t size)
+        {
+            state_.process_bytes(data, size);
+            size_ += size;
+        }
+
+        void update(std::span<uint8 const> data)
+        {
+            update(data.data(), data.size());
+        }
+
+        // Continues the checksum with the given value
+        template <typename T>
+        void put(T const& value)
+        {
+            impl::hash(state_, value);
+            size_ += sizeof(T);
+        }
+
+        // Appends a segment of the given size whose checksum has been calculated separately
+        void combine(uint32 crc, uint64 size)
+        {
+            state_.value = checksum_combine(state_.algorithm, state_.value, crc, size);
+            size_ += size;
+        }
+
+        // Appends another stream's data
+        void combine(crc_stream const& other)
+        {
+            combine(other.value(), other.size());
+        }
+
+        // Returns the checksum of all data processed so far
+        uint32 value() const
+        {
+            return state_.value;
+        }
+
+        // Returns the number of bytes processed so far
+        uint64 size() const
+        {
+            return size_;
+        }
+
+        checksum_algorithm algorithm() const
+        {
+            return state_.algorithm;
+        }
+
+        // Starts a new checksum
+        void reset()
+        {
+            state_.value = 0;
+            size_ = 0;
+        }
+
+      private:
+        impl::checksum_state state_;
+        uint64 size_ = 0;
+    };
+
+    // Returns the checksum of all given arguments using the given algorithm
     template <typename... ARGS>
-    uint32 crc32(ARGS&&... args)
+    uint32 checksum(checksum_algorithm algorithm, ARGS&&... args)
     {
-        thread_local boost::crc_32_type crc;
-        crc.reset();
+        impl::checksum_state crc{algorithm};
 
         (impl::hash(crc, args), ...);
 
-        return crc.checksum();
+        return crc.value;
+    }
+
+    template <typename... ARGS>
+    bool validate_checksum(checksum_algorithm algorithm, uint32 crc, ARGS&&... args)
+    {
+        return crc == checksum(algorithm, args...);
+    }
+
+    template <typename... ARGS>
+    uint32 crc32(ARGS&&... args)
+    {
+        return checksum(checksum_algorithm::Crc32, args...);
     }
 
     template <typename... ARGS>
@@ -0,0 +1,164 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#pragma once
+
+#include "../types.hpp"
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+namespace keycap::root::utility
+{
+    // A high dynamic range histogram: records values between 1 and a configurable maximum while keeping the given
+    // number of significant decimal digits, using a fixed amount of memory.
+    // Values are counted in buckets covering a power of two each, which are split into linear sub-buckets. Recording
+    // a value is a single relaxed atomic increment, so any number of threads may record concurrently without locking.
+    // Histograms can be merged, e.g. to aggregate the histograms of multiple threads or services
+    class hdr_histogram
+    {
+      public:
+        // Tracks values up to highest_trackable with significant_digits (1 - 5) decimal digits of precision.
+        // Larger values are recorded as highest_trackable
+        explicit hdr_histogram(uint64 highest_trackable = 3'600'000'000'000, int significant_digits = 3);
+
+        hdr_histogram(hdr_histogram const&) = delete;
+        hdr_histogram& operator=(hdr_histogram const&) = delete;
+
+        void record(uint64 value) noexcept
+        {
+            record(value, 1);
+        }
+
+        // Records the given value count times
+        void record(uint64 value, uint64 count) noexcept
+        {
+            if (value > highest_trackable_)
+                value = highest_trackable_;
+
+            counts_[index_of(value)].fetch_add(count, std::memory_order_relaxed);
+            total_count_.fetch_add(count, std::memory_order_relaxed);
+            total_sum_.fetch_add(value * count, std::memory_order_relaxed);
+
+            update_max(value);
+            update_min(value);
+        }
+
+        // Adds all values recorded by the given histogram, which may have a different configuration
+        void merge(hdr_histogram const& other) noexcept;
+
+        // Removes all recorded values. Values recorded concurrently may or may not be removed
+        void reset() noexcept;
+
+        // Returns the number of recorded values
+        uint64 count() const noexcept
+        {
+            return total_count_.load(std::memory_order_relaxed);
+        }
+
+        // Returns the sum of all recorded values
+        uint64 sum() const noexcept
+        {
+            return total_sum_.load(std::memory_order_relaxed);
+        }
+
+        // Returns the smallest and largest recorded value respectively, or 0 if nothing has been recorded
+        uint64 min() const noexcept;
+
+        uint64 max() const noexcept;
+
+        double mean() const noexcept;
+
+        // Returns the value that percentile (0 - 100) percent of the recorded values are less than or equal to,
+        // within the histogram's precision. Returns 0 if nothing has been recorded
+        uint64 value_at_percentile(double percentile) const noexcept;
+
+        // Returns whether the two values are counted as the same value
+        bool equivalent(uint64 lhs, uint64 rhs) const noexcept;
+
+        // Calls the given callback for every distinct recorded value, in ascending order, with the highest value
+        // equivalent to it and the number of times it has been recorded
+        void for_each(std::function<void(uint64 value, uint64 count)> const& callback) const;
+
+        uint64 highest_trackable() const noexcept
+        {
+            return highest_trackable_;
+        }
+
+        int significant_digits() const noexcept
+        {
+            return significant_digits_;
+        }
+
+      private:
+        size_t index_of(uint64 value) const noexcept
+        {
+            auto bucket = bucket_index(value);
+            auto sub_bucket = value >> bucket;
+
+            return (static_cast<size_t>(bucket + 1) << sub_bucket_half_count_magnitude_)
+                   + (sub_bucket - sub_bucket_half_count_);
+        }
+
+        int bucket_index(uint64 value) const noexcept
+        {
+            // Values below the sub bucket count are covered by bucket 0 at full resolution
+            auto magnitude = static_cast<int>(std::bit_width(value | sub_bucket_mask_));
+            return magnitude - (sub_bucket_half_count_magnitude_ + 1);
+        }
+
+        // Returns the smallest value counted by the given index
+        uint64 value_at_index(size_t index) const noexcept;
+
+        uint64 lowest_equivalent(uint64 value) const noexcept;
+
+        uint64 highest_equivalent(uint64 value) const noexcept;
+
+        void update_max(uint64 value) noexcept
+        {
+            auto current = max_.load(std::memory_order_relaxed);
+            while (value > current && !max_.compare_exchange_weak(current, value, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        void update_min(uint64 value) noexcept
+        {
+            auto current = min_.load(std::memory_order_relaxed);
+            while (value < current && !min_.compare_exchange_weak(current, value, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        uint64 highest_trackable_;
+        int significant_digits_;
+
+        int sub_bucket_half_count_magnitude_ = 0;
+        size_t sub_bucket_count_ = 0;
+        size_t sub_bucket_half_count_ = 0;
+        uint64 sub_bucket_mask_ = 0;
+        size_t counts_length_ = 0;
+
+        std::unique_ptr<std::atomic<uint64>[]> counts_;
+        std::atomic<uint64> total_count_ = 0;
+        std::atomic<uint64> total_sum_ = 0;
+        std::atomic<uint64> min_ = UINT64_MAX;
+        std::atomic<uint64> max_ = 0;
+    };
+}
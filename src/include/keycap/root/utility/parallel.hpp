@@ -0,0 +1,79 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace keycap::root::utility
+{
+    // Returns the number of threads to use for the given thread count, where 0 selects one per hardware thread
+    inline size_t thread_count(size_t threads)
+    {
+        if (threads != 0)
+            return threads;
+
+        return std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+
+    // Calls f(i) for every i in [0, count) on up to the given number of threads, including the calling one, which
+    // take the next index whenever they are done with one. A thread count of 0 uses one thread per hardware thread.
+    // Stops handing out indices once f throws and rethrows the first exception after all threads have finished
+    template <typename F>
+    void parallel_for(size_t count, size_t threads, F&& f)
+    {
+        threads = std::min(thread_count(threads), count);
+
+        std::atomic_size_t next = 0;
+        std::exception_ptr error;
+        std::mutex error_mutex;
+
+        auto work = [&] {
+            try
+            {
+                for (auto i = next++; i < count; i = next++)
+                    f(i);
+            }
+            catch (...)
+            {
+                std::scoped_lock lock{error_mutex};
+                if (!error)
+                    error = std::current_exception();
+
+                next = count;
+            }
+        };
+
+        {
+            std::vector<std::jthread> workers;
+            workers.reserve(threads > 0 ? threads - 1 : 0);
+
+            for (size_t i = 1; i < threads; ++i)
+                workers.emplace_back(work);
+
+            work();
+        }
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+}
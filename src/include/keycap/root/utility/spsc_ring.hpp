@@ -0,0 +1,157 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <span>
+
+namespace keycap::root::utility
+{
+    // A lock-free byte ring buffer for exactly one producer and one consumer thread.
+    // The producer only ever modifies the write position and the consumer only the read position, so neither side
+    // has to wait for the other. Both positions grow monotonically and are masked on access, which requires the
+    // capacity to be a power of two.
+    // The ring may also live in memory shared between two processes, see spsc_ring::attach
+    class spsc_ring
+    {
+      public:
+        // The positions shared between producer and consumer. They live on separate cache lines so they don't
+        // invalidate each other
+        struct control
+        {
+            alignas(64) std::atomic<size_t> write = 0;
+            alignas(64) std::atomic<size_t> read = 0;
+        };
+
+        static_assert(std::atomic<size_t>::is_always_lock_free, "spsc_ring requires lock-free atomics");
+
+        // The capacity gets rounded up to the next power of two
+        explicit spsc_ring(size_t capacity)
+          : capacity_{std::bit_ceil(std::max<size_t>(capacity, 2))}
+          , owned_control_{std::make_unique<control>()}
+          , owned_buffer_{std::make_unique<uint8_t[]>(capacity_)}
+          , control_{owned_control_.get()}
+          , buffer_{owned_buffer_.get()}
+        {
+        }
+
+        // Returns the number of bytes of externally provided memory a ring of the given capacity requires
+        static constexpr size_t storage_size(size_t capacity)
+        {
+            return sizeof(control) + capacity;
+        }
+
+        // Creates a ring within the given memory, which must be aligned to 64 bytes and hold storage_size(capacity)
+        // bytes. The capacity must be a power of two. If initialize is true, the ring's positions are reset; this must
+        // be done by exactly one side before the other one attaches
+        static spsc_ring attach(void* memory, size_t capacity, bool initialize)
+        {
+            return spsc_ring{memory, capacity, initialize};
+        }
+
+        spsc_ring(spsc_ring&&) = default;
+        spsc_ring& operator=(spsc_ring&&) = default;
+
+        // Copies as much of the given data into the ring as fits and returns the number of bytes written.
+        // Must only be called by the producer
+        size_t write(std::span<uint8_t const> data)
+        {
+            auto write = control_->write.load(std::memory_order_relaxed);
+            if (capacity_ - (write - cached_read_) < data.size())
+                cached_read_ = control_->read.load(std::memory_order_acquire);
+
+            auto size = std::min(data.size(), capacity_ - (write - cached_read_));
+            if (size == 0)
+                return 0;
+
+            auto offset = write & (capacity_ - 1);
+            auto first = std::min(size, capacity_ - offset);
+            std::memcpy(buffer_ + offset, data.data(), first);
+            std::memcpy(buffer_, data.data() + first, size - first);
+
+            control_->write.store(write + size, std::memory_order_release);
+            return size;
+        }
+
+        // Copies as many bytes as are available, up to the size of the given buffer, out of the ring and returns the
+        // number of bytes read. Must only be called by the consumer
+        size_t read(std::span<uint8_t> buffer)
+        {
+            auto read = control_->read.load(std::memory_order_relaxed);
+            if (cached_write_ - read < buffer.size())
+                cached_write_ = control_->write.load(std::memory_order_acquire);
+
+            auto size = std::min(buffer.size(), cached_write_ - read);
+            if (size == 0)
+                return 0;
+
+            auto offset = read & (capacity_ - 1);
+            auto first = std::min(size, capacity_ - offset);
+            std::memcpy(buffer.data(), buffer_ + offset, first);
+            std::memcpy(buffer.data() + first, buffer_, size - first);
+
+            control_->read.store(read + size, std::memory_order_release);
+            return size;
+        }
+
+        // Returns the number of bytes that can currently be read. Exact only when called by the consumer
+        size_t size() const
+        {
+            return control_->write.load(std::memory_order_acquire) - control_->read.load(std::memory_order_acquire);
+        }
+
+        bool empty() const
+        {
+            return size() == 0;
+        }
+
+        size_t capacity() const
+        {
+            return capacity_;
+        }
+
+      private:
+        spsc_ring(void* memory, size_t capacity, bool initialize)
+          : capacity_{capacity}
+          , control_{initialize ? new (memory) control{} : std::launder(static_cast<control*>(memory))}
+          , buffer_{static_cast<uint8_t*>(memory) + sizeof(control)}
+        {
+            cached_read_ = control_->read.load(std::memory_order_acquire);
+            cached_write_ = control_->write.load(std::memory_order_acquire);
+        }
+
+        size_t capacity_ = 0;
+
+        // Only set if the ring owns its memory
+        std::unique_ptr<control> owned_control_;
+        std::unique_ptr<uint8_t[]> owned_buffer_;
+
+        control* control_ = nullptr;
+        uint8_t* buffer_ = nullptr;
+
+        // Local copies of the other side's position, only refreshed when they don't suffice. Written by different
+        // threads, so they get their own cache lines as well
+        alignas(64) size_t cached_read_ = 0;
+        alignas(64) size_t cached_write_ = 0;
+    };
+}
@@ -0,0 +1,668 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/compression/codec.hpp>
+#include <keycap/root/compression/zip.hpp>
+#include <keycap/root/exception.hpp>
+#include <keycap/root/utility/parallel.hpp>
+
+#ifdef KEYCAP_ROOT_HAS_LZ4
+#include <lz4.h>
+#include <lz4hc.h>
+#endif
+
+#ifdef KEYCAP_ROOT_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <limits>
+
+namespace keycap::root::compression
+{
+    namespace
+    {
+        class null_codec : public codec
+        {
+          public:
+            codec_type type() const noexcept override
+            {
+                return codec_type::None;
+            }
+
+            int level() const noexcept override
+            {
+                return 0;
+            }
+
+            size_t bound(size_t size) const override
+            {
+                return size;
+            }
+
+            std::optional<size_t> compress(std::span<uint8_t const> input, std::span<uint8_t> output) const override
+            {
+                if (input.size() > output.size())
+                    return {};
+
+                std::copy(input.begin(), input.end(), output.begin());
+                return input.size();
+            }
+
+            std::optional<size_t> decompress(std::span<uint8_t const> input, std::span<uint8_t> output) const override
+            {
+                return compress(input, output);
+            }
+        };
+
+        class zlib_codec : public codec
+        {
+          public:
+            explicit zlib_codec(int level, std::shared_ptr<dictionary const> dictionary = nullptr)
+              : level_{std::clamp(level, 0, 9)}
+              , dictionary_{std::move(dictionary)}
+            {
+            }
+
+            codec_type type() const noexcept override
+            {
+                return codec_type::Zlib;
+            }
+
+            int level() const noexcept override
+            {
+                return level_;
+            }
+
+            size_t bound(size_t size) const override
+            {
+                // The header identifies the dictionary using 4 additional bytes
+                return zip::compress_bound(size) + (dictionary_ ? 4 : 0);
+            }
+
+            std::optional<size_t> compress(std::span<uint8_t const> input, std::span<uint8_t> output) const override
+            {
+                return zip::compress_into(input, output, level_, content());
+            }
+
+            std::optional<size_t> decompress(std::span<uint8_t const> input, std::span<uint8_t> output) const override
+            {
+                return zip::decompress_into(input, output, content());
+            }
+
+          private:
+            std::span<uint8_t const> content() const noexcept
+            {
+                if (!dictionary_)
+                    return {};
+
+                return dictionary_->content();
+            }
+
+            int level_;
+            std::shared_ptr<dictionary const> dictionary_;
+        };
+
+#ifdef KEYCAP_ROOT_HAS_LZ4
+        // Levels up to 0 use the fast compressor with an acceleration of -level, higher ones the HC compressor
+        class lz4_codec : public codec
+        {
+          public:
+            explicit lz4_codec(int level)
+              : level_{std::clamp(level, -65537, LZ4HC_CLEVEL_MAX)}
+            {
+            }
+
+            codec_type type() const noexcept override
+            {
+                return codec_type::Lz4;
+            }
+
+            int level() const noexcept override
+            {
+                return level_;
+            }
+
+            size_t bound(size_t size) const override
+            {
+                if (size > LZ4_MAX_INPUT_SIZE)
+                    return size;
+
+                return static_cast<size_t>(LZ4_compressBound(static_cast<int>(size)));
+            }
+
+            std::optional<size_t> compress(std::span<uint8_t const> input, std::span<uint8_t> output) const override
+            {
+                if (input.size() > LZ4_MAX_INPUT_SIZE)
+                    return {};
+
+                auto source = reinterpret_cast<char const*>(input.data());
+                auto destination = reinterpret_cast<char*>(output.data());
+                auto source_size = static_cast<int>(input.size());
+                auto capacity = static_cast<int>(std::min<size_t>(output.size(), std::numeric_limits<int>::max()));
+
+                int size = 0;
+                if (level_ <= 0)
+                {
+                    size = LZ4_compress_fast(source, destination, source_size, capacity, -level_);
+                }
+                else
+                {
+                    // The HC compressor would allocate its state of about 256 KiB on every call otherwise
+                    thread_local std::unique_ptr<std::byte[]> state
+                        = std::make_unique_for_overwrite<std::byte[]>(static_cast<size_t>(LZ4_sizeofStateHC()));
+
+                    size = LZ4_compress_HC_extStateHC(state.get(), source, destination, source_size, capacity, level_);
+                }
+
+                if (size <= 0)
+                    return {};
+
+                return static_cast<size_t>(size);
+            }
+
+            std::optional<size_t> decompress(std::span<uint8_t const> input, std::span<uint8_t> output) const override
+            {
+                if (input.size() > static_cast<size_t>(std::numeric_limits<int>::max()))
+                    return {};
+
+                auto size = LZ4_decompress_safe(
+                    reinterpret_cast<char const*>(input.data()), reinterpret_cast<char*>(output.data()),
+                    static_cast<int>(input.size()),
+                    static_cast<int>(std::min<size_t>(output.size(), std::numeric_limits<int>::max())));
+
+                if (size < 0)
+                    return {};
+
+                return static_cast<size_t>(size);
+            }
+
+          private:
+            int level_;
+        };
+#endif
+
+#ifdef KEYCAP_ROOT_HAS_ZSTD
+        // Every thread reuses its contexts, so zstd doesn't allocate its state on every call
+        struct zstd_contexts
+        {
+            std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> compress{ZSTD_createCCtx(), &ZSTD_freeCCtx};
+            std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> decompress{ZSTD_createDCtx(), &ZSTD_freeDCtx};
+        };
+
+        zstd_contexts& thread_zstd()
+        {
+            thread_local zstd_contexts contexts;
+            return contexts;
+        }
+
+        class zstd_codec : public codec
+        {
+          public:
+            explicit zstd_codec(int level, std::shared_ptr<dictionary const> const& dictionary = nullptr)
+              : level_{std::clamp(level, ZSTD_minCLevel(), ZSTD_maxCLevel())}
+            {
+                if (!dictionary)
+                    return;
+
+                // The digested dictionaries copy the content and save loading it on every call
+                auto content = dictionary->content();
+                compress_dictionary_.reset(ZSTD_createCDict(content.data(), content.size(), level_));
+                decompress_dictionary_.reset(ZSTD_createDDict(content.data(), content.size()));
+
+                if (!compress_dictionary_ || !decompress_dictionary_)
+                    throw exception{"Failed to load the zstd dictionary!"};
+            }
+
+            codec_type type() const noexcept override
+            {
+                return codec_type::Zstd;
+            }
+
+            int level() const noexcept override
+            {
+                return level_;
+            }
+
+            size_t bound(size_t size) const override
+            {
+                return ZSTD_compressBound(size);
+            }
+
+            std::optional<size_t> compress(std::span<uint8_t const> input, std::span<uint8_t> output) const override
+            {
+                auto context = thread_zstd().compress.get();
+                auto size = compress_dictionary_
+                                ? ZSTD_compress_usingCDict(context, output.data(), output.size(), input.data(),
+                                                           input.size(), compress_dictionary_.get())
+                                : ZSTD_compressCCtx(context, output.data(), output.size(), input.data(), input.size(),
+                                                    level_);
+
+                if (ZSTD_isError(size))
+                    return {};
+
+                return size;
+            }
+
+            std::optional<size_t> decompress(std::span<uint8_t const> input, std::span<uint8_t> output) const override
+            {
+                auto context = thread_zstd().decompress.get();
+                auto size = decompress_dictionary_
+                                ? ZSTD_decompress_usingDDict(context, output.data(), output.size(), input.data(),
+                                                             input.size(), decompress_dictionary_.get())
+                                : ZSTD_decompressDCtx(context, output.data(), output.size(), input.data(), input.size());
+
+                if (ZSTD_isError(size))
+                    return {};
+
+                return size;
+            }
+
+          private:
+            int level_;
+            std::unique_ptr<ZSTD_CDict, decltype(&ZSTD_freeCDict)> compress_dictionary_{nullptr, &ZSTD_freeCDict};
+            std::unique_ptr<ZSTD_DDict, decltype(&ZSTD_freeDDict)> decompress_dictionary_{nullptr, &ZSTD_freeDDict};
+        };
+#endif
+
+        // Codecs with their default level, used to decompress frames
+        codec const* default_codec(codec_type type)
+        {
+            static auto const codecs = [] {
+                std::array<std::unique_ptr<codec>, 4> result;
+                for (auto supported : {codec_type::None, codec_type::Zlib, codec_type::Lz4, codec_type::Zstd})
+                    result[static_cast<size_t>(supported)] = make_codec(supported);
+
+                return result;
+            }();
+
+            auto index = static_cast<size_t>(type);
+            if (index >= codecs.size())
+                return nullptr;
+
+            return codecs[index].get();
+        }
+
+        // Sizes are written as LEB128 varints: 7 bits per byte, starting with the lowest, while the top bit is set
+        constexpr size_t max_varint_size = 10;
+
+        size_t write_varint(std::span<uint8_t> data, uint64_t value)
+        {
+            size_t size = 0;
+            do
+            {
+                auto byte = static_cast<uint8_t>(value & 0x7F);
+                value >>= 7;
+
+                data[size++] = value != 0 ? (byte | 0x80) : byte;
+            } while (value != 0);
+
+            return size;
+        }
+
+        // Returns the number of bytes the varint occupied or 0 if it is incomplete or too long
+        size_t read_varint(std::span<uint8_t const> data, uint64_t& value)
+        {
+            value = 0;
+            for (size_t i = 0; i < std::min(data.size(), max_varint_size); ++i)
+            {
+                value |= static_cast<uint64_t>(data[i] & 0x7F) << (7 * i);
+
+                if ((data[i] & 0x80) == 0)
+                    return i + 1;
+            }
+
+            return 0;
+        }
+
+        size_t write_frame_header(std::span<uint8_t> data, codec_type type, uint64_t uncompressed_size)
+        {
+            data[0] = static_cast<uint8_t>(type);
+            return 1 + write_varint(data.subspan(1), uncompressed_size);
+        }
+
+        // Returns the size a frame of the given input can take at most
+        size_t frame_bound(codec const& codec, size_t size)
+        {
+            return frame_header::max_size + std::max(codec.bound(size), size);
+        }
+
+        // Writes the frame of the input into output, which must be able to hold frame_bound bytes.
+        // Returns the size of the frame
+        size_t compress_frame(codec const& codec, std::span<uint8_t const> input, std::span<uint8_t> output)
+        {
+            auto header_size = write_frame_header(output, codec.type(), input.size());
+            auto size = codec.compress(input, output.subspan(header_size));
+
+            if (!size || *size >= input.size())
+            {
+                header_size = write_frame_header(output, codec_type::None, input.size());
+                std::copy(input.begin(), input.end(), output.begin() + static_cast<ptrdiff_t>(header_size));
+                size = input.size();
+            }
+
+            return header_size + *size;
+        }
+
+        // The largest factor a codec can expand its compressed data by: deflate encodes at most 258 bytes per match
+        // in a bit more than 2 bits, lz4 adds a byte per 255 bytes of a match and zstd stores up to 128 KiB runs of a
+        // single byte in a 4 byte block
+        uint64_t max_expansion(codec_type type) noexcept
+        {
+            switch (type)
+            {
+                case codec_type::None:
+                    return 1;
+                case codec_type::Zlib:
+                    return 1032;
+                case codec_type::Lz4:
+                    return 256;
+                case codec_type::Zstd:
+                    return 32 * 1024;
+                default:
+                    return 0;
+            }
+        }
+
+        // Returns whether or not the payload following the given header could hold its uncompressed size
+        bool plausible(frame_header const& header, size_t payload_size, size_t max_size) noexcept
+        {
+            if (header.uncompressed_size > max_size)
+                return false;
+
+            if (header.codec == codec_type::None)
+                return header.uncompressed_size == payload_size;
+
+            auto expansion = max_expansion(header.codec);
+            return payload_size <= std::numeric_limits<uint64_t>::max() / expansion
+                   && header.uncompressed_size <= payload_size * expansion;
+        }
+
+        // Decompresses the payload following the given header into output, which must be exactly as large as the
+        // uncompressed data. Uses the given codec unless it's nullptr or the frame is uncompressed
+        bool decompress_frame(codec const* codec, frame_header const& header, std::span<uint8_t const> payload,
+                              std::span<uint8_t> output)
+        {
+            if (!codec || header.codec == codec_type::None)
+                codec = default_codec(header.codec);
+            else if (header.codec != codec->type())
+                return false;
+
+            if (!codec)
+                return false;
+
+            auto size = codec->decompress(payload, output);
+            return size && *size == output.size();
+        }
+    }
+
+    bool is_supported(codec_type type) noexcept
+    {
+        switch (type)
+        {
+            case codec_type::None:
+                [[fallthrough]];
+            case codec_type::Zlib:
+                return true;
+#ifdef KEYCAP_ROOT_HAS_LZ4
+            case codec_type::Lz4:
+                return true;
+#endif
+#ifdef KEYCAP_ROOT_HAS_ZSTD
+            case codec_type::Zstd:
+                return true;
+#endif
+            default:
+                return false;
+        }
+    }
+
+    int default_level(codec_type type) noexcept
+    {
+        switch (type)
+        {
+            case codec_type::Zlib:
+                // Matches zip::compress
+                return 8;
+            case codec_type::Zstd:
+                return 3;
+            default:
+                return 0;
+        }
+    }
+
+    std::unique_ptr<codec> make_codec(codec_type type, std::optional<int> level)
+    {
+        auto selected = level.value_or(default_level(type));
+
+        switch (type)
+        {
+            case codec_type::None:
+                return std::make_unique<null_codec>();
+            case codec_type::Zlib:
+                return std::make_unique<zlib_codec>(selected);
+#ifdef KEYCAP_ROOT_HAS_LZ4
+            case codec_type::Lz4:
+                return std::make_unique<lz4_codec>(selected);
+#endif
+#ifdef KEYCAP_ROOT_HAS_ZSTD
+            case codec_type::Zstd:
+                return std::make_unique<zstd_codec>(selected);
+#endif
+            default:
+                return nullptr;
+        }
+    }
+
+    std::unique_ptr<codec> make_codec(codec_type type, std::shared_ptr<dictionary const> dictionary,
+                                      std::optional<int> level)
+    {
+        auto selected = level.value_or(default_level(type));
+
+        switch (type)
+        {
+            case codec_type::None:
+                return std::make_unique<null_codec>();
+            case codec_type::Zlib:
+                return std::make_unique<zlib_codec>(selected, std::move(dictionary));
+#ifdef KEYCAP_ROOT_HAS_ZSTD
+            case codec_type::Zstd:
+                return std::make_unique<zstd_codec>(selected, dictionary);
+#endif
+            default:
+                return nullptr;
+        }
+    }
+
+    std::optional<frame_header> read_frame_header(std::span<uint8_t const> data)
+    {
+        if (data.empty())
+            return {};
+
+        frame_header header;
+        header.codec = static_cast<codec_type>(data[0]);
+
+        auto size = read_varint(data.subspan(1), header.uncompressed_size);
+        if (size == 0)
+            return {};
+
+        header.size = 1 + size;
+        return header;
+    }
+
+    std::vector<uint8_t> compress(codec const& codec, std::span<uint8_t const> input)
+    {
+        std::vector<uint8_t> frame(frame_bound(codec, input.size()));
+        frame.resize(compress_frame(codec, input, frame));
+
+        return frame;
+    }
+
+    std::vector<uint8_t> decompress(std::span<uint8_t const> frame, size_t max_size)
+    {
+        auto header = read_frame_header(frame);
+        if (!header)
+            return {};
+
+        auto codec = default_codec(header->codec);
+        if (!codec)
+            return {};
+
+        return decompress(*codec, frame, max_size);
+    }
+
+    std::vector<uint8_t> decompress(codec const& codec, std::span<uint8_t const> frame, size_t max_size)
+    {
+        auto header = read_frame_header(frame);
+        if (!header)
+            return {};
+
+        auto payload = frame.subspan(header->size);
+        if (!plausible(*header, payload.size(), max_size))
+            return {};
+
+        // Data that doesn't compress is stored uncompressed by every codec
+        if (header->codec == codec_type::None)
+            return {payload.begin(), payload.end()};
+
+        if (header->codec != codec.type())
+            return {};
+
+        std::vector<uint8_t> output(header->uncompressed_size);
+        auto size = codec.decompress(payload, output);
+        if (!size || *size != output.size())
+            return {};
+
+        return output;
+    }
+
+    std::vector<uint8_t> compress_blocks(codec const& codec, std::span<uint8_t const> input, size_t threads,
+                                         size_t block_size)
+    {
+        block_size = std::max<size_t>(block_size, 1);
+
+        auto block_count = (input.size() + block_size - 1) / block_size;
+        auto slot_size = frame_bound(codec, block_size);
+
+        std::vector<uint8_t> frames(block_count * slot_size);
+        std::vector<size_t> sizes(block_count);
+
+        utility::parallel_for(block_count, threads, [&](size_t index) {
+            auto offset = index * block_size;
+            auto block = input.subspan(offset, std::min(block_size, input.size() - offset));
+
+            sizes[index] = compress_frame(codec, block, std::span(frames).subspan(index * slot_size, slot_size));
+        });
+
+        std::vector<uint8_t> output((1 + block_count) * max_varint_size);
+        auto size = write_varint(output, block_count);
+        for (auto frame_size : sizes)
+            size += write_varint(std::span(output).subspan(size), frame_size);
+
+        output.resize(size);
+        for (size_t index = 0; index < block_count; ++index)
+        {
+            auto slot = frames.begin() + static_cast<ptrdiff_t>(index * slot_size);
+            output.insert(output.end(), slot, slot + static_cast<ptrdiff_t>(sizes[index]));
+        }
+
+        return output;
+    }
+
+    namespace
+    {
+        std::vector<uint8_t> decompress_blocks(codec const* codec, std::span<uint8_t const> data, size_t threads,
+                                               size_t max_size)
+        {
+            uint64_t block_count = 0;
+            auto position = read_varint(data, block_count);
+
+            // Every block takes at least one byte for its size, which bounds the count before anything is allocated
+            if (position == 0 || block_count > data.size() - position)
+                return {};
+
+            struct block
+            {
+                frame_header header;
+                std::span<uint8_t const> payload;
+                size_t offset = 0;
+            };
+
+            std::vector<block> blocks(block_count);
+            std::vector<uint64_t> frame_sizes(block_count);
+            for (auto& frame_size : frame_sizes)
+            {
+                auto size = read_varint(data.subspan(position), frame_size);
+                if (size == 0)
+                    return {};
+
+                position += size;
+            }
+
+            uint64_t uncompressed_size = 0;
+            for (size_t index = 0; index < blocks.size(); ++index)
+            {
+                if (frame_sizes[index] > data.size() - position)
+                    return {};
+
+                auto frame = data.subspan(position, frame_sizes[index]);
+                position += frame.size();
+
+                // Checking every block against the remaining size keeps the total from overflowing as well
+                auto header = read_frame_header(frame);
+                if (!header || !is_supported(header->codec)
+                    || !plausible(*header, frame.size() - header->size, max_size - uncompressed_size))
+                    return {};
+
+                blocks[index] = {*header, frame.subspan(header->size), uncompressed_size};
+                uncompressed_size += header->uncompressed_size;
+            }
+
+            if (position != data.size())
+                return {};
+
+            std::vector<uint8_t> output(uncompressed_size);
+            std::atomic_bool failed = false;
+
+            // Every block knows where its data goes, so they are all decompressed straight into the output
+            utility::parallel_for(blocks.size(), threads, [&](size_t index) {
+                auto& block = blocks[index];
+                auto destination = std::span(output).subspan(block.offset, block.header.uncompressed_size);
+
+                if (!decompress_frame(codec, block.header, block.payload, destination))
+                    failed = true;
+            });
+
+            if (failed)
+                return {};
+
+            return output;
+        }
+    }
+
+    std::vector<uint8_t> decompress_blocks(std::span<uint8_t const> data, size_t threads, size_t max_size)
+    {
+        return decompress_blocks(nullptr, data, threads, max_size);
+    }
+
+    std::vector<uint8_t> decompress_blocks(codec const& codec, std::span<uint8_t const> data, size_t threads,
+                                           size_t max_size)
+    {
+        return decompress_blocks(&codec, data, threads, max_size);
+    }
+}
@@ -0,0 +1,110 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/compression/dictionary.hpp>
+#include <keycap/root/network/memory_stream.hpp>
+
+#include <zlib.h>
+
+#ifdef KEYCAP_ROOT_HAS_ZSTD
+#include <zdict.h>
+#endif
+
+#include <algorithm>
+#include <map>
+
+namespace keycap::root::compression
+{
+    namespace
+    {
+        // deflate prefers matches close to the data, so the samples seen most often go last
+        dictionary concatenate_samples(std::span<std::span<uint8_t const> const> samples, size_t max_size)
+        {
+            std::map<std::vector<uint8_t>, size_t> counts;
+            for (auto sample : samples)
+                ++counts[std::vector<uint8_t>(sample.begin(), sample.end())];
+
+            std::vector<std::pair<size_t, std::vector<uint8_t> const*>> by_count;
+            by_count.reserve(counts.size());
+            for (auto& [sample, count] : counts)
+                by_count.emplace_back(count, &sample);
+
+            std::stable_sort(by_count.begin(), by_count.end(),
+                             [](auto const& lhs, auto const& rhs) { return lhs.first > rhs.first; });
+
+            // Adds the samples to the front, starting with the most frequent one, until the dictionary is full
+            std::vector<uint8_t> content(max_size);
+            auto begin = content.size();
+            for (auto [count, sample] : by_count)
+            {
+                auto size = std::min(sample->size(), begin);
+                std::copy(sample->end() - static_cast<ptrdiff_t>(size), sample->end(),
+                          content.begin() + static_cast<ptrdiff_t>(begin - size));
+                begin -= size;
+
+                if (begin == 0)
+                    break;
+            }
+
+            content.erase(content.begin(), content.begin() + static_cast<ptrdiff_t>(begin));
+            return dictionary{std::move(content)};
+        }
+    }
+
+    dictionary::dictionary(std::vector<uint8_t> content)
+      : content_{std::move(content)}
+      , id_{static_cast<uint32_t>(adler32_z(adler32(0, nullptr, 0), content_.data(), content_.size()))}
+    {
+    }
+
+    dictionary train_dictionary(std::span<std::span<uint8_t const> const> samples, size_t max_size)
+    {
+#ifdef KEYCAP_ROOT_HAS_ZSTD
+        std::vector<uint8_t> buffer;
+        std::vector<size_t> sizes;
+        sizes.reserve(samples.size());
+        for (auto sample : samples)
+        {
+            buffer.insert(buffer.end(), sample.begin(), sample.end());
+            sizes.push_back(sample.size());
+        }
+
+        std::vector<uint8_t> content(max_size);
+        auto size = ZDICT_trainFromBuffer(content.data(), content.size(), buffer.data(), sizes.data(),
+                                          static_cast<unsigned>(sizes.size()));
+
+        if (!ZDICT_isError(size))
+        {
+            content.resize(size);
+            return dictionary{std::move(content)};
+        }
+#endif
+
+        return concatenate_samples(samples, max_size);
+    }
+
+    dictionary train_dictionary(std::span<network::memory_stream const> samples, size_t max_size)
+    {
+        std::vector<std::span<uint8_t const>> spans;
+        spans.reserve(samples.size());
+
+        // Only the data that hasn't been read yet is part of the sample
+        for (auto& sample : samples)
+            spans.emplace_back(sample.data() + (sample.buffer().size() - sample.size()), sample.size());
+
+        return train_dictionary(spans, max_size);
+    }
+}
@@ -0,0 +1,193 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/compression/policy.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+
+namespace keycap::root::compression
+{
+    namespace
+    {
+        // The weight of the latest message when updating the average ratio of its type
+        constexpr double ratio_weight = 0.2;
+
+        // Returns the entropy estimate_entropy yields on average for the given number of uniformly distributed bytes.
+        // Samples much smaller than 256 bytes can't contain every byte value, so even random data stays well below
+        // 8 bits per byte for them
+        double expected_random_entropy(size_t size) noexcept
+        {
+            if (size == 0)
+                return 0.0;
+
+            auto n = static_cast<double>(size);
+
+            // The bias of the estimate vanishes for large samples, where the binomial below would underflow
+            if (size > 16 * 1024)
+                return 8.0 - 255.0 / (2.0 * n * std::log(2.0));
+
+            // Every byte value occurs a binomially distributed number of times c, contributing -(c/n) * log2(c/n)
+            constexpr double p = 1.0 / 256.0;
+            auto probability = std::pow(1.0 - p, n);
+
+            double entropy = 0.0;
+            for (size_t count = 1; count <= size; ++count)
+            {
+                auto c = static_cast<double>(count);
+                probability *= (n - c + 1.0) / c * p / (1.0 - p);
+                entropy -= probability * (c / n) * std::log2(c / n);
+
+                // Past the mean the remaining counts are negligible
+                if (c > n * p && probability < 1e-12)
+                    break;
+            }
+
+            return 256.0 * entropy;
+        }
+    }
+
+    double estimate_entropy(std::span<uint8_t const> data) noexcept
+    {
+        if (data.empty())
+            return 0.0;
+
+        std::array<uint32_t, 256> histogram{};
+        for (auto byte : data)
+            ++histogram[byte];
+
+        double entropy = 0.0;
+        auto size = static_cast<double>(data.size());
+        for (auto count : histogram)
+        {
+            if (count == 0)
+                continue;
+
+            auto probability = count / size;
+            entropy -= probability * std::log2(probability);
+        }
+
+        return entropy;
+    }
+
+    compression_policy::compression_policy(std::shared_ptr<codec const> codec, policy_settings settings)
+      : codec_{std::move(codec)}
+      , uncompressed_{make_codec(codec_type::None)}
+      , settings_{settings}
+    {
+    }
+
+    std::vector<uint8_t> compression_policy::compress(std::span<uint8_t const> input, uint32_t message_type)
+    {
+        switch (inspect(input))
+        {
+            case decision::TooSmall:
+                skipped_small_.fetch_add(1, std::memory_order_relaxed);
+                return compression::compress(*uncompressed_, input);
+            case decision::Incompressible:
+                skipped_entropy_.fetch_add(1, std::memory_order_relaxed);
+                return compression::compress(*uncompressed_, input);
+            default:
+                break;
+        }
+
+        {
+            std::scoped_lock lock{types_mutex_};
+            auto& state = types_[message_type];
+
+            // Probing every now and then lets types start paying off again once their data changes
+            if (!state.pays_off && ++state.skipped < settings_.probe_interval)
+            {
+                skipped_learned_.fetch_add(1, std::memory_order_relaxed);
+                return compression::compress(*uncompressed_, input);
+            }
+
+            state.skipped = 0;
+        }
+
+        auto started = std::chrono::steady_clock::now();
+        auto frame = compression::compress(*codec_, input);
+        auto elapsed = std::chrono::nanoseconds{std::chrono::steady_clock::now() - started};
+
+        learn(message_type, input.size(), frame.size());
+
+        compressed_.fetch_add(1, std::memory_order_relaxed);
+        input_bytes_.fetch_add(input.size(), std::memory_order_relaxed);
+        output_bytes_.fetch_add(frame.size(), std::memory_order_relaxed);
+        compress_time_.fetch_add(static_cast<uint64_t>(elapsed.count()), std::memory_order_relaxed);
+
+        return frame;
+    }
+
+    bool compression_policy::should_compress(std::span<uint8_t const> input, uint32_t message_type) const
+    {
+        if (inspect(input) != decision::Compress)
+            return false;
+
+        std::scoped_lock lock{types_mutex_};
+        auto itr = types_.find(message_type);
+        if (itr == types_.end())
+            return true;
+
+        return itr->second.pays_off || itr->second.skipped + 1 >= settings_.probe_interval;
+    }
+
+    policy_statistics compression_policy::statistics() const noexcept
+    {
+        policy_statistics result;
+        result.compressed = compressed_.load(std::memory_order_relaxed);
+        result.skipped_small = skipped_small_.load(std::memory_order_relaxed);
+        result.skipped_entropy = skipped_entropy_.load(std::memory_order_relaxed);
+        result.skipped_learned = skipped_learned_.load(std::memory_order_relaxed);
+        result.input_bytes = input_bytes_.load(std::memory_order_relaxed);
+        result.output_bytes = output_bytes_.load(std::memory_order_relaxed);
+        result.compress_time = compress_time_.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    compression_policy::decision compression_policy::inspect(std::span<uint8_t const> input) const noexcept
+    {
+        if (input.empty() || input.size() < settings_.min_size)
+            return decision::TooSmall;
+
+        // Nothing exceeds 8 bits per byte, which disables the check
+        if (settings_.max_entropy >= 8.0)
+            return decision::Compress;
+
+        // The threshold is relative to what random data of the sample's size yields, so small messages can be
+        // classified as well
+        auto sample = input.first(std::min(input.size(), settings_.sample_size));
+        auto threshold = settings_.max_entropy / 8.0 * expected_random_entropy(sample.size());
+        if (estimate_entropy(sample) > threshold)
+            return decision::Incompressible;
+
+        return decision::Compress;
+    }
+
+    void compression_policy::learn(uint32_t message_type, size_t input_size, size_t output_size)
+    {
+        auto ratio = static_cast<double>(output_size) / static_cast<double>(input_size);
+
+        std::scoped_lock lock{types_mutex_};
+        auto& state = types_[message_type];
+
+        state.ratio = state.measured ? state.ratio + ratio_weight * (ratio - state.ratio) : ratio;
+        state.measured = true;
+        state.pays_off = state.ratio <= 1.0 - settings_.min_savings;
+    }
+}
@@ -15,88 +15,796 @@
 */
 
 #include <keycap/root/compression/zip.hpp>
+#include <keycap/root/exception.hpp>
+#include <keycap/root/network/memory_stream.hpp>
+#include <keycap/root/utility/parallel.hpp>
 
 #include <zlib.h>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define KEYCAP_ROOT_HAS_MMAP 1
+#endif
+
+#include <algorithm>
 #include <array>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
 
 namespace keycap::root::compression::zip
 {
-    namespace impl
+    namespace
     {
-        std::vector<uint8_t> compress(uint8_t* begin, unsigned long size)
+        // Size by which buffers grow while the size of the output is unknown
+        constexpr size_t chunk_size = 16 * 1024;
+
+        // Runs process until either the input has been consumed or the output is full. Spans exceeding the 32 bit
+        // sizes of z_stream are passed in multiple steps
+        template <typename Process>
+        int run(z_stream& stream, Process process, int flush, std::span<uint8_t const> input,
+                std::span<uint8_t> output, stream_result& result)
         {
-            std::vector<uint8_t> buffer;
-            buffer.resize(compressBound(size));
+            constexpr size_t max_step = std::numeric_limits<uInt>::max();
 
-            unsigned long buffer_size = static_cast<unsigned long>(buffer.size());
+            int ret = Z_OK;
+            do
+            {
+                auto in = std::min(input.size() - result.consumed, max_step);
+                auto out = std::min(output.size() - result.produced, max_step);
 
-            if (::compress2(buffer.data(), &buffer_size, begin, size, 8) != Z_OK)
-                return {};
+                stream.next_in = const_cast<Bytef*>(input.data() + result.consumed);
+                stream.avail_in = static_cast<uInt>(in);
+                stream.next_out = output.data() + result.produced;
+                stream.avail_out = static_cast<uInt>(out);
 
-            buffer.resize(buffer_size);
+                // Flushing is only allowed along with the last part of the input
+                ret = process(&stream, in == input.size() - result.consumed ? flush : Z_NO_FLUSH);
 
-            return buffer;
+                result.consumed += in - stream.avail_in;
+                result.produced += out - stream.avail_out;
+            } while (ret == Z_OK && result.produced < output.size()
+                     && (result.consumed < input.size() || stream.avail_out == 0));
+
+            return ret;
         }
 
-        void inflate(std::vector<uint8_t>& data, uint8_t* ptr, unsigned long size)
+        // Calls step with chunks of space appended to output until it leaves a chunk partially unused
+        template <typename Step>
+        size_t append(std::vector<uint8_t>& output, Step step)
         {
-            constexpr int buffer_size = 1024;
-            std::array<uint8_t, buffer_size> in{};
-            std::array<uint8_t, buffer_size> out{};
-            int ret = Z_OK;
+            size_t produced = 0;
+            while (true)
+            {
+                auto position = output.size();
+                output.resize(position + chunk_size);
 
-            z_stream stream{};
-            if (inflateInit(&stream) != Z_OK)
-                return;
+                auto size = step(std::span<uint8_t>(output.data() + position, chunk_size));
+                output.resize(position + size);
+                produced += size;
 
-            do
+                if (size < chunk_size)
+                    return produced;
+            }
+        }
+
+        template <typename Step>
+        size_t append(network::memory_stream& output, Step step)
+        {
+            size_t produced = 0;
+            while (true)
             {
-                if (size - stream.total_in < buffer_size)
-                    stream.avail_in = size - stream.total_in;
-                else
-                    stream.avail_in = buffer_size;
+                auto size = step(output.prepare(chunk_size));
+                output.commit(size);
+                produced += size;
 
-                stream.next_in = ptr + stream.total_in;
+                if (size < chunk_size)
+                    return produced;
+            }
+        }
+
+        // Serves the memory zlib allocates for a stream from blocks that live as long as the arena. zlib allocates
+        // its state when a stream is initialized and frees it when the stream ends, so freeing is a no-op
+        class arena
+        {
+          public:
+            explicit arena(size_t block_size)
+              : block_size_{block_size}
+            {
+            }
+
+            static voidpf allocate(voidpf opaque, uInt items, uInt size)
+            {
+                return static_cast<arena*>(opaque)->take(static_cast<size_t>(items) * size);
+            }
+
+            static void deallocate(voidpf, voidpf)
+            {
+            }
 
-                do
+          private:
+            void* take(size_t size)
+            {
+                constexpr size_t alignment = alignof(std::max_align_t);
+                size = (size + alignment - 1) & ~(alignment - 1);
+
+                if (blocks_.empty() || used_ + size > capacity_)
                 {
-                    stream.avail_out = buffer_size;
-                    stream.next_out = out.data();
+                    capacity_ = std::max(size, block_size_);
+                    blocks_.push_back(std::make_unique_for_overwrite<std::byte[]>(capacity_));
+                    used_ = 0;
+                }
+
+                auto address = blocks_.back().get() + used_;
+                used_ += size;
+                return address;
+            }
+
+            size_t block_size_;
+            size_t capacity_ = 0;
+            size_t used_ = 0;
+            std::vector<std::unique_ptr<std::byte[]>> blocks_;
+        };
 
-                    ret = inflate(&stream, Z_NO_FLUSH);
+        // Slack for the stream states on top of the buffers zlib documents in zconf.h
+        constexpr size_t state_size = 8 * 1024;
 
-                    data.insert(data.end(), out.begin(), out.end());
+        // A z_stream that is reset instead of ended after use, so it only allocates once per thread
+        class deflate_context
+        {
+          public:
+            // Negative window bits produce raw deflate data without the zlib header and trailer
+            explicit deflate_context(int level, int window_bits = MAX_WBITS)
+              : level_{level}
+            {
+                stream_.zalloc = &arena::allocate;
+                stream_.zfree = &arena::deallocate;
+                stream_.opaque = &memory_;
 
-                    switch (ret)
-                    {
-                        case Z_STREAM_ERROR:
-                            [[fallthrough]];
-                        case Z_NEED_DICT:
-                            [[fallthrough]];
-                        case Z_DATA_ERROR:
-                            [[fallthrough]];
-                        case Z_MEM_ERROR:
-                            inflateEnd(&stream);
-                    }
-                } while (stream.avail_out == 0);
+                if (deflateInit2(&stream_, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+                    throw exception{"Failed to initialize the deflate stream!"};
+            }
 
-            } while (ret != Z_STREAM_END);
+            ~deflate_context()
+            {
+                deflateEnd(&stream_);
+            }
 
-            data.resize(stream.total_out);
+            deflate_context(deflate_context const&) = delete;
+            deflate_context& operator=(deflate_context const&) = delete;
 
-            inflateEnd(&stream);
+            // Returns the stream, ready to compress new data with the given level
+            z_stream& get(int level)
+            {
+                deflateReset(&stream_);
+
+                if (level != level_ && deflateParams(&stream_, level, Z_DEFAULT_STRATEGY) == Z_OK)
+                    level_ = level;
+
+                return stream_;
+            }
+
+          private:
+            // deflate needs 2^(windowBits + 2) + 2^(memLevel + 9) bytes for the default settings
+            arena memory_{(1 << 17) + (1 << 17) + state_size};
+            z_stream stream_{};
+            int level_;
+        };
+
+        class inflate_context
+        {
+          public:
+            inflate_context()
+            {
+                stream_.zalloc = &arena::allocate;
+                stream_.zfree = &arena::deallocate;
+                stream_.opaque = &memory_;
+
+                if (inflateInit(&stream_) != Z_OK)
+                    throw exception{"Failed to initialize the inflate stream!"};
+            }
+
+            ~inflate_context()
+            {
+                inflateEnd(&stream_);
+            }
+
+            inflate_context(inflate_context const&) = delete;
+            inflate_context& operator=(inflate_context const&) = delete;
+
+            // Returns the stream, ready to decompress new data
+            z_stream& get()
+            {
+                inflateReset(&stream_);
+                return stream_;
+            }
+
+          private:
+            // inflate needs 2^windowBits bytes for its window
+            arena memory_{(1 << 15) + state_size};
+            z_stream stream_{};
+        };
+
+        // Compressing and decompressing many small packets would otherwise spend much of its time allocating and
+        // initializing the state of zlib, which takes about 256 KiB for deflate
+        z_stream& thread_deflate(int level)
+        {
+            thread_local deflate_context context{level};
+            return context.get(level);
+        }
+
+        z_stream& thread_inflate()
+        {
+            thread_local inflate_context context;
+            return context.get();
+        }
+
+        // zlib only uses the end of a dictionary as large as its window, so the start of dictionaries exceeding its
+        // 32 bit sizes can be cut off
+        std::span<uint8_t const> dictionary_tail(std::span<uint8_t const> dictionary)
+        {
+            return dictionary.last(std::min<size_t>(dictionary.size(), std::numeric_limits<uInt>::max()));
+        }
+
+        // Compresses the blocks of compress_parallel, which are assembled into a zlib stream afterwards
+        z_stream& thread_raw_deflate(int level)
+        {
+            thread_local deflate_context context{level, -MAX_WBITS};
+            return context.get(level);
         }
 
-        std::vector<uint8_t> decompress(uint8_t* begin, unsigned long size)
+        // The size of the window deflate refers back to, which primes every block with the data preceding it
+        constexpr size_t window_size = size_t{1} << MAX_WBITS;
+
+        // Returns the two byte zlib header deflate writes for the given level
+        std::array<uint8_t, 2> zlib_header(int level)
+        {
+            unsigned level_flags = 3;
+            if (level >= 0 && level < 2)
+                level_flags = 0;
+            else if (level >= 2 && level < 6)
+                level_flags = 1;
+            else if (level == 6)
+                level_flags = 2;
+
+            unsigned header = ((Z_DEFLATED + ((MAX_WBITS - 8) << 4)) << 8) | (level_flags << 6);
+            header += 31 - header % 31;
+
+            return {static_cast<uint8_t>(header >> 8), static_cast<uint8_t>(header)};
+        }
+
+        // The size of the chunks files are read and written in, unless they're mapped into memory
+        constexpr size_t file_chunk_size = 1024 * 1024;
+
+        // Calls consume with the contents of the given file. Mapped files are passed at once and left to the page
+        // cache, others in chunks of file_chunk_size bytes
+        template <typename Consume>
+        void read_file(std::filesystem::path const& path, Consume consume)
+        {
+#if defined(KEYCAP_ROOT_HAS_MMAP)
+            auto descriptor = ::open(path.c_str(), O_RDONLY);
+            if (descriptor == -1)
+                throw exception{"Failed to open " + path.string() + "!"};
+
+            struct stat status{};
+            if (::fstat(descriptor, &status) == -1)
+            {
+                ::close(descriptor);
+                throw exception{"Failed to read the size of " + path.string() + "!"};
+            }
+
+            auto size = static_cast<size_t>(status.st_size);
+            if (size == 0)
+            {
+                ::close(descriptor);
+                return;
+            }
+
+            auto address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            ::close(descriptor);
+
+            if (address == MAP_FAILED)
+                throw exception{"Failed to map " + path.string() + "!"};
+
+            // The file is read front to back exactly once, which lets the kernel read ahead and drop pages early
+            ::madvise(address, size, MADV_SEQUENTIAL);
+
+            auto unmap = [size](void* pointer) { ::munmap(pointer, size); };
+            std::unique_ptr<void, decltype(unmap)> mapping{address, unmap};
+
+            consume(std::span<uint8_t const>(static_cast<uint8_t const*>(address), size));
+#else
+            std::ifstream file{path, std::ios::binary};
+            if (!file)
+                throw exception{"Failed to open " + path.string() + "!"};
+
+            std::vector<uint8_t> buffer(file_chunk_size);
+            while (file)
+            {
+                file.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+
+                auto size = static_cast<size_t>(file.gcount());
+                if (size != 0)
+                    consume(std::span<uint8_t const>(buffer.data(), size));
+            }
+
+            if (!file.eof())
+                throw exception{"Failed to read " + path.string() + "!"};
+#endif
+        }
+
+        // Writes the output of a stream to a file chunk by chunk
+        class file_writer
+        {
+          public:
+            explicit file_writer(std::filesystem::path const& path)
+              : path_{path}
+              , file_{path, std::ios::binary | std::ios::trunc}
+              , buffer_(file_chunk_size)
+            {
+                if (!file_)
+                    throw exception{"Failed to open " + path.string() + "!"};
+            }
+
+            std::span<uint8_t> buffer() noexcept
+            {
+                return buffer_;
+            }
+
+            // Writes the first size bytes of the buffer to the file
+            void write(size_t size)
+            {
+                file_.write(reinterpret_cast<char const*>(buffer_.data()), static_cast<std::streamsize>(size));
+                if (!file_)
+                    throw exception{"Failed to write " + path_.string() + "!"};
+
+                written_ += size;
+            }
+
+            uint64_t written() const noexcept
+            {
+                return written_;
+            }
+
+          private:
+            std::filesystem::path path_;
+            std::ofstream file_;
+            std::vector<uint8_t> buffer_;
+            uint64_t written_ = 0;
+        };
+    }
+
+    namespace impl
+    {
+        std::vector<uint8_t> compress(uint8_t const* begin, size_t size)
+        {
+            std::vector<uint8_t> buffer;
+            buffer.resize(compress_bound(size));
+
+            // Produces the same output as compress2, which compresses with the same settings
+            stream_result result;
+            if (run(thread_deflate(8), &::deflate, Z_FINISH, {begin, size}, buffer, result) != Z_STREAM_END)
+                return {};
+
+            buffer.resize(result.produced);
+
+            return buffer;
+        }
+
+        // Inflates directly into data, starting with expected_size bytes if known or a guess otherwise and growing
+        // geometrically if the guess is too small
+        bool inflate(std::vector<uint8_t>& data, uint8_t const* ptr, size_t size, size_t expected_size)
+        {
+            auto& stream = thread_inflate();
+
+            data.resize(expected_size != 0 ? expected_size : std::max(size * 4, chunk_size));
+
+            std::span<uint8_t const> input{ptr, size};
+            stream_result result;
+
+            int ret = Z_OK;
+            while (true)
+            {
+                ret = run(stream, &::inflate, Z_FINISH, input, data, result);
+                if (ret != Z_OK && ret != Z_BUF_ERROR)
+                    break;
+
+                // The input ended before the end of the stream
+                if (result.produced < data.size())
+                    break;
+
+                data.resize(data.size() * 2);
+            }
+
+            data.resize(result.produced);
+            return ret == Z_STREAM_END;
+        }
+
+        std::vector<uint8_t> decompress(uint8_t const* begin, size_t size, size_t uncompressed_size)
         {
             std::vector<uint8_t> buffer;
-            if(size == 0)
+            if (size == 0)
                 return buffer;
 
-            inflate(buffer, begin, size);
+            if (!inflate(buffer, begin, size, uncompressed_size))
+                return {};
 
             return buffer;
         }
     }
-}
\ No newline at end of file
+
+    size_t compress_bound(size_t size)
+    {
+        if (size <= std::numeric_limits<uLong>::max())
+            return compressBound(static_cast<uLong>(size));
+
+        // compressBound takes a uLong, which only has 32 bits on some platforms. Passing the input to deflate in steps
+        // doesn't change its output, so the bound zlib computes for the default settings still holds
+        return size + (size >> 12) + (size >> 14) + (size >> 25) + 13;
+    }
+
+    std::optional<size_t> compress_into(std::span<uint8_t const> input, std::span<uint8_t> output, int level,
+                                        std::span<uint8_t const> dictionary)
+    {
+        auto& stream = thread_deflate(level);
+
+        dictionary = dictionary_tail(dictionary);
+        if (!dictionary.empty()
+            && deflateSetDictionary(&stream, dictionary.data(), static_cast<uInt>(dictionary.size())) != Z_OK)
+            return {};
+
+        stream_result result;
+        if (run(stream, &::deflate, Z_FINISH, input, output, result) != Z_STREAM_END)
+            return {};
+
+        return result.produced;
+    }
+
+    std::optional<size_t> decompress_into(std::span<uint8_t const> input, std::span<uint8_t> output,
+                                          std::span<uint8_t const> dictionary)
+    {
+        auto& stream = thread_inflate();
+
+        stream_result result;
+        auto ret = run(stream, &::inflate, Z_FINISH, input, output, result);
+
+        // inflate asks for the dictionary once it has read the header
+        dictionary = dictionary_tail(dictionary);
+        if (ret == Z_NEED_DICT && !dictionary.empty()
+            && inflateSetDictionary(&stream, dictionary.data(), static_cast<uInt>(dictionary.size())) == Z_OK)
+            ret = run(stream, &::inflate, Z_FINISH, input, output, result);
+
+        if (ret != Z_STREAM_END)
+            return {};
+
+        return result.produced;
+    }
+
+    std::vector<uint8_t> compress_parallel(std::span<uint8_t const> input, int level, size_t threads,
+                                           size_t block_size)
+    {
+        if (input.empty())
+            return {};
+
+        // deflate limits its input to 32 bits and slots of the output mustn't overflow either
+        block_size = std::clamp<size_t>(block_size, 1, std::numeric_limits<uInt>::max() / 2);
+
+        auto block_count = (input.size() + block_size - 1) / block_size;
+
+        // Every block but the last ends with a sync flush, which takes at most 5 bytes on top of the bound
+        auto slot_size = compressBound(static_cast<uLong>(block_size)) + 5;
+
+        struct block
+        {
+            size_t produced = 0;
+            uLong checksum = 0;
+        };
+
+        std::vector<block> blocks(block_count);
+        std::vector<uint8_t> buffer(2 + block_count * slot_size + 4);
+
+        utility::parallel_for(block_count, threads, [&](size_t index) {
+            auto offset = index * block_size;
+            auto data = input.subspan(offset, std::min(block_size, input.size() - offset));
+            auto last = index + 1 == block_count;
+
+            auto& stream = thread_raw_deflate(level);
+            if (offset != 0)
+            {
+                auto dictionary = input.subspan(offset - std::min(offset, window_size), std::min(offset, window_size));
+                deflateSetDictionary(&stream, dictionary.data(), static_cast<uInt>(dictionary.size()));
+            }
+
+            stream_result result;
+            auto ret = run(stream, &::deflate, last ? Z_FINISH : Z_SYNC_FLUSH, data,
+                           std::span(buffer).subspan(2 + index * slot_size, slot_size), result);
+
+            if (ret != (last ? Z_STREAM_END : Z_OK) || result.consumed != data.size())
+                throw exception{"Failed to compress the block!"};
+
+            blocks[index].produced = result.produced;
+            blocks[index].checksum = adler32_z(1, data.data(), data.size());
+        });
+
+        auto header = zlib_header(level);
+        std::copy(header.begin(), header.end(), buffer.begin());
+
+        // The blocks are already in order, so closing the gaps between them yields the stream
+        size_t size = 2;
+        auto checksum = adler32(0, nullptr, 0);
+        for (size_t index = 0; index < block_count; ++index)
+        {
+            auto slot = buffer.data() + 2 + index * slot_size;
+            std::memmove(buffer.data() + size, slot, blocks[index].produced);
+            size += blocks[index].produced;
+
+            auto length = std::min(block_size, input.size() - index * block_size);
+            checksum = adler32_combine(checksum, blocks[index].checksum, static_cast<z_off_t>(length));
+        }
+
+        for (int shift = 24; shift >= 0; shift -= 8)
+            buffer[size++] = static_cast<uint8_t>(checksum >> shift);
+
+        buffer.resize(size);
+        return buffer;
+    }
+
+    struct deflate_stream::state
+    {
+        // zlib keeps a pointer to the z_stream, which therefore mustn't move
+        z_stream stream{};
+        bool finished = false;
+    };
+
+    deflate_stream::deflate_stream(int level)
+      : state_{std::make_unique<state>()}
+    {
+        if (deflateInit(&state_->stream, level) != Z_OK)
+            throw exception{"Failed to initialize the deflate stream!"};
+    }
+
+    deflate_stream::~deflate_stream()
+    {
+        if (state_)
+            deflateEnd(&state_->stream);
+    }
+
+    deflate_stream::deflate_stream(deflate_stream&& rhs) noexcept = default;
+
+    deflate_stream& deflate_stream::operator=(deflate_stream&& rhs) noexcept
+    {
+        if (state_)
+            deflateEnd(&state_->stream);
+
+        state_ = std::move(rhs.state_);
+        return *this;
+    }
+
+    stream_result deflate_stream::write(std::span<uint8_t const> input, std::span<uint8_t> output)
+    {
+        if (state_->finished)
+            throw exception{"Tried to write to a finished deflate stream!"};
+
+        stream_result result;
+        run(state_->stream, &::deflate, Z_NO_FLUSH, input, output, result);
+        return result;
+    }
+
+    stream_result deflate_stream::write(std::span<uint8_t const> input, std::vector<uint8_t>& output)
+    {
+        stream_result result;
+        result.produced = append(output, [&](std::span<uint8_t> chunk) {
+            auto step = write(input.subspan(result.consumed), chunk);
+            result.consumed += step.consumed;
+            return step.produced;
+        });
+
+        return result;
+    }
+
+    stream_result deflate_stream::write(std::span<uint8_t const> input, network::memory_stream& output)
+    {
+        stream_result result;
+        result.produced = append(output, [&](std::span<uint8_t> chunk) {
+            auto step = write(input.subspan(result.consumed), chunk);
+            result.consumed += step.consumed;
+            return step.produced;
+        });
+
+        return result;
+    }
+
+    size_t deflate_stream::flush(std::span<uint8_t> output)
+    {
+        if (state_->finished)
+            throw exception{"Tried to flush a finished deflate stream!"};
+
+        stream_result result;
+        run(state_->stream, &::deflate, Z_SYNC_FLUSH, {}, output, result);
+        return result.produced;
+    }
+
+    size_t deflate_stream::flush(std::vector<uint8_t>& output)
+    {
+        return append(output, [&](std::span<uint8_t> chunk) { return flush(chunk); });
+    }
+
+    size_t deflate_stream::flush(network::memory_stream& output)
+    {
+        return append(output, [&](std::span<uint8_t> chunk) { return flush(chunk); });
+    }
+
+    size_t deflate_stream::finish(std::span<uint8_t> output)
+    {
+        if (state_->finished)
+            return 0;
+
+        stream_result result;
+        if (run(state_->stream, &::deflate, Z_FINISH, {}, output, result) == Z_STREAM_END)
+            state_->finished = true;
+
+        return result.produced;
+    }
+
+    size_t deflate_stream::finish(std::vector<uint8_t>& output)
+    {
+        return append(output, [&](std::span<uint8_t> chunk) { return finish(chunk); });
+    }
+
+    size_t deflate_stream::finish(network::memory_stream& output)
+    {
+        return append(output, [&](std::span<uint8_t> chunk) { return finish(chunk); });
+    }
+
+    bool deflate_stream::finished() const noexcept
+    {
+        return state_->finished;
+    }
+
+    void deflate_stream::reset()
+    {
+        deflateReset(&state_->stream);
+        state_->finished = false;
+    }
+
+    struct inflate_stream::state
+    {
+        z_stream stream{};
+        bool finished = false;
+    };
+
+    inflate_stream::inflate_stream()
+      : state_{std::make_unique<state>()}
+    {
+        if (inflateInit(&state_->stream) != Z_OK)
+            throw exception{"Failed to initialize the inflate stream!"};
+    }
+
+    inflate_stream::~inflate_stream()
+    {
+        if (state_)
+            inflateEnd(&state_->stream);
+    }
+
+    inflate_stream::inflate_stream(inflate_stream&& rhs) noexcept = default;
+
+    inflate_stream& inflate_stream::operator=(inflate_stream&& rhs) noexcept
+    {
+        if (state_)
+            inflateEnd(&state_->stream);
+
+        state_ = std::move(rhs.state_);
+        return *this;
+    }
+
+    stream_result inflate_stream::write(std::span<uint8_t const> input, std::span<uint8_t> output)
+    {
+        stream_result result;
+        if (state_->finished)
+            return result;
+
+        switch (run(state_->stream, &::inflate, Z_NO_FLUSH, input, output, result))
+        {
+            case Z_STREAM_END:
+                state_->finished = true;
+                break;
+            case Z_NEED_DICT:
+                [[fallthrough]];
+            case Z_DATA_ERROR:
+                [[fallthrough]];
+            case Z_STREAM_ERROR:
+                [[fallthrough]];
+            case Z_MEM_ERROR:
+                throw exception{"Malformed zlib stream!"};
+        }
+
+        return result;
+    }
+
+    stream_result inflate_stream::write(std::span<uint8_t const> input, std::vector<uint8_t>& output)
+    {
+        stream_result result;
+        result.produced = append(output, [&](std::span<uint8_t> chunk) {
+            auto step = write(input.subspan(result.consumed), chunk);
+            result.consumed += step.consumed;
+            return step.produced;
+        });
+
+        return result;
+    }
+
+    stream_result inflate_stream::write(std::span<uint8_t const> input, network::memory_stream& output)
+    {
+        stream_result result;
+        result.produced = append(output, [&](std::span<uint8_t> chunk) {
+            auto step = write(input.subspan(result.consumed), chunk);
+            result.consumed += step.consumed;
+            return step.produced;
+        });
+
+        return result;
+    }
+
+    bool inflate_stream::finished() const noexcept
+    {
+        return state_->finished;
+    }
+
+    void inflate_stream::reset()
+    {
+        inflateReset(&state_->stream);
+        state_->finished = false;
+    }
+
+    uint64_t compress_file(std::filesystem::path const& input, std::filesystem::path const& output, int level)
+    {
+        deflate_stream stream{level};
+        file_writer writer{output};
+
+        read_file(input, [&](std::span<uint8_t const> chunk) {
+            // deflate may hold back output once the chunk has been consumed, which the next chunk or finish writes
+            while (true)
+            {
+                auto result = stream.write(chunk, writer.buffer());
+                writer.write(result.produced);
+                chunk = chunk.subspan(result.consumed);
+
+                if (chunk.empty() && result.produced < writer.buffer().size())
+                    break;
+            }
+        });
+
+        while (!stream.finished())
+            writer.write(stream.finish(writer.buffer()));
+
+        return writer.written();
+    }
+
+    uint64_t decompress_file(std::filesystem::path const& input, std::filesystem::path const& output)
+    {
+        inflate_stream stream;
+        file_writer writer{output};
+
+        read_file(input, [&](std::span<uint8_t const> chunk) {
+            while (!stream.finished())
+            {
+                auto result = stream.write(chunk, writer.buffer());
+                writer.write(result.produced);
+                chunk = chunk.subspan(result.consumed);
+
+                if (chunk.empty() && result.produced < writer.buffer().size())
+                    break;
+            }
+        });
+
+        if (!stream.finished())
+            throw exception{"Truncated zlib stream in " + input.string() + "!"};
+
+        return writer.written();
+    }
+}
@@ -0,0 +1,134 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/network/broadcaster.hpp>
+
+#include <boost/asio/post.hpp>
+
+#include <algorithm>
+#include <mutex>
+
+namespace keycap::root::network
+{
+    void broadcaster::subscribe(channel_id channel, std::shared_ptr<connection_base> connection)
+    {
+        std::unique_lock lock{mutex_};
+
+        auto& groups = channels_[channel];
+        auto* context = &connection->io_context();
+
+        auto itr = std::find_if(groups.begin(), groups.end(), [&](group const& g) { return g.context == context; });
+        if (itr == groups.end())
+        {
+            groups.push_back(group{context, std::make_shared<connection_list const>(1, std::move(connection))});
+            return;
+        }
+
+        if (std::find(itr->connections->begin(), itr->connections->end(), connection) != itr->connections->end())
+            return;
+
+        auto connections = std::make_shared<connection_list>(*itr->connections);
+        connections->push_back(std::move(connection));
+        itr->connections = std::move(connections);
+    }
+
+    void broadcaster::unsubscribe(channel_id channel, connection_base const* connection)
+    {
+        std::unique_lock lock{mutex_};
+
+        auto channelItr = channels_.find(channel);
+        if (channelItr == channels_.end())
+            return;
+
+        auto& groups = channelItr->second;
+        for (auto& g : groups)
+        {
+            auto itr = std::find_if(g.connections->begin(), g.connections->end(),
+                                    [&](auto const& subscriber) { return subscriber.get() == connection; });
+            if (itr == g.connections->end())
+                continue;
+
+            auto connections = std::make_shared<connection_list>(*g.connections);
+            connections->erase(connections->begin() + (itr - g.connections->begin()));
+            g.connections = std::move(connections);
+            break;
+        }
+
+        std::erase_if(groups, [](group const& g) { return g.connections->empty(); });
+        if (groups.empty())
+            channels_.erase(channelItr);
+    }
+
+    void broadcaster::unsubscribe(connection_base const* connection)
+    {
+        std::vector<channel_id> channels;
+
+        {
+            std::shared_lock lock{mutex_};
+            for (auto&& [channel, groups] : channels_)
+                channels.push_back(channel);
+        }
+
+        for (auto channel : channels)
+            unsubscribe(channel, connection);
+    }
+
+    size_t broadcaster::subscribers(channel_id channel) const
+    {
+        std::shared_lock lock{mutex_};
+
+        auto itr = channels_.find(channel);
+        if (itr == channels_.end())
+            return 0;
+
+        size_t count = 0;
+        for (auto&& g : itr->second)
+            count += g.connections->size();
+
+        return count;
+    }
+
+    void broadcaster::broadcast(channel_id channel, shared_buffer data) const
+    {
+        std::shared_lock lock{mutex_};
+
+        auto itr = channels_.find(channel);
+        if (itr == channels_.end())
+            return;
+
+        // One task per io_context, the connections themselves are only touched from their own thread
+        for (auto&& g : itr->second)
+        {
+            boost::asio::post(*g.context, [connections = g.connections, data] {
+                for (auto&& connection : *connections)
+                    connection->send(data);
+            });
+        }
+    }
+
+    void broadcaster::broadcast(channel_id channel, std::span<uint8 const> data) const
+    {
+        if (subscribers(channel) == 0)
+            return;
+
+        broadcast(channel, make_shared_buffer(data));
+    }
+
+    void broadcaster::broadcast(channel_id channel, memory_stream&& stream) const
+    {
+        broadcast(channel, std::span<uint8 const>{stream.to_span()});
+    }
+}
@@ -14,12 +14,14 @@
     limitations under the License.
 */
 
+#include <keycap/root/exception.hpp>
 #include <keycap/root/network/connection.hpp>
 #include <keycap/root/network/memory_stream.hpp>
 #include <keycap/root/network/service_base.hpp>
 
 #include <boost/asio/co_spawn.hpp>
 #include <boost/asio/detached.hpp>
+#include <boost/asio/post.hpp>
 #include <boost/asio/redirect_error.hpp>
 #include <boost/asio/use_awaitable.hpp>
 #include <boost/asio/write.hpp>
@@ -40,9 +42,18 @@ namespace keycap::root::network
     {
     }
 
+    connection::connection(std::unique_ptr<transport> transport, service_base& service)
+      : connection_base{std::move(transport), service.io_context()}
+      , service_{service}
+    {
+    }
+
     boost::asio::ip::tcp::socket& connection::socket()
     {
-        return socket_;
+        if (transport_->kind() != transport_kind::Tcp)
+            throw exception{"The connection isn't using a tcp_transport!"};
+
+        return static_cast<tcp_transport&>(*transport_).socket();
     }
 
     void connection::listen()
@@ -71,8 +82,7 @@ namespace keycap::root::network
 
     void connection::send(std::span<uint8_t> data)
     {
-        send_packet_queue_.emplace_back(data.begin(), data.end());
-        send_timer_.cancel_one();
+        send(make_shared_buffer(data));
     }
 
     void connection::send(std::span<char> data)
@@ -80,30 +90,101 @@ namespace keycap::root::network
         send(std::span(reinterpret_cast<uint8_t*>(data.data()), data.size()));
     }
 
+    void connection::send(shared_buffer data)
+    {
+        send(std::move(data), send_priority::Normal);
+    }
+
+    void connection::send(shared_buffer data, send_priority priority)
+    {
+        send_packet_queue_.push(std::move(data), priority, latency_start());
+        metrics_->queued.store(send_packet_queue_.size(), std::memory_order_relaxed);
+        wake_writer();
+    }
+
+    void connection::send_chunked(shared_buffer data, send_priority priority, size_t chunk_size,
+                                  send_queue::framer framer)
+    {
+        send_packet_queue_.push_chunked(std::move(data), priority, chunk_size, std::move(framer), latency_start());
+        metrics_->queued.store(send_packet_queue_.size(), std::memory_order_relaxed);
+        wake_writer();
+    }
+
+    void connection::wake_writer()
+    {
+        if (io_service_.get_executor().running_in_this_thread())
+        {
+            send_timer_.cancel_one();
+            return;
+        }
+
+        // The connection may be gone by the time the io_context gets to it
+        boost::asio::post(io_service_, [weak = weak_from_this()] {
+            if (auto self = weak.lock())
+                static_cast<connection&>(*self).send_timer_.cancel_one();
+        });
+    }
+
     data_router& connection::get_router()
     {
         return router_;
     }
 
+    void connection::enable_compression(int level)
+    {
+        deflate_.emplace(level);
+        inflate_.emplace();
+    }
+
+    bool connection::compressed() const noexcept
+    {
+        return deflate_.has_value();
+    }
+
     awaitable<void> connection::do_read()
     {
         try
         {
             std::vector<uint8_t> buffer(1024, 0);
 
-            while (socket_.is_open())
+            while (transport_->is_open())
             {
-                std::size_t n = co_await socket_.async_read_some(boost::asio::buffer(buffer), use_awaitable);
-                if (!router_.route_inbound(service_, std::span(buffer.data(), n)))
+                std::size_t n = co_await transport_->read_some(buffer);
+
+                auto started = latency_start();
+
+                // Throws if the data is malformed, which aborts the connection
+                auto received = std::span(buffer.data(), n);
+                if (inflate_)
+                {
+                    inflated_.clear();
+                    inflate_->write(received, inflated_);
+                    received = inflated_;
+                }
+
+                auto routed = router_.route_inbound(service_, received);
+                on_read(n, started);
+
+                if (!routed)
                 {
+                    on_error();
                     router_.route_updated_link_status(service_, link_status::Down);
                     stop();
                     break;
                 }
             }
         }
+        catch (boost::system::system_error& ex)
+        {
+            if (ex.code() != boost::asio::error::eof && ex.code() != boost::asio::error::operation_aborted)
+                on_error();
+
+            router_.route_updated_link_status(service_, link_status::Down);
+            stop();
+        }
         catch (std::exception&)
         {
+            on_error();
             router_.route_updated_link_status(service_, link_status::Down);
             stop();
         }
@@ -113,7 +194,7 @@ namespace keycap::root::network
     {
         try
         {
-            while (socket_.is_open())
+            while (transport_->is_open())
             {
                 if (send_packet_queue_.empty())
                 {
@@ -122,20 +203,88 @@ namespace keycap::root::network
                 }
                 else
                 {
-                    co_await boost::asio::async_write(
-                        socket_, boost::asio::buffer(send_packet_queue_.front()), use_awaitable);
-                    send_packet_queue_.pop_front();
+                    // Chunks are framed on demand, so the buffer has to be kept alive until it has been written
+                    std::chrono::steady_clock::time_point queued_at;
+                    auto data = send_packet_queue_.pop(queued_at);
+                    metrics_->queued.store(send_packet_queue_.size(), std::memory_order_relaxed);
+
+                    // Messages are compressed in the order they are written, which the other end inflates them in
+                    std::span<uint8_t const> written = *data;
+                    if (deflate_)
+                    {
+                        deflated_.clear();
+                        deflate_->write(written, deflated_);
+                        deflate_->flush(deflated_);
+                        written = deflated_;
+                    }
+
+                    co_await transport_->write(written);
+                    on_written(written.size(), queued_at);
                 }
             }
         }
         catch (std::exception&)
         {
+            // Pending writes fail once the connection has been stopped
+            if (transport_->is_open())
+                on_error();
+
             stop();
         }
     }
 
+    std::chrono::steady_clock::time_point connection::latency_start() const
+    {
+        if (!service_.metrics().record_latency())
+            return {};
+
+        return std::chrono::steady_clock::now();
+    }
+
+    void connection::on_read(size_t size, std::chrono::steady_clock::time_point started)
+    {
+        metrics_->bytes_received.fetch_add(size, std::memory_order_relaxed);
+        metrics_->reads.fetch_add(1, std::memory_order_relaxed);
+
+        auto& metrics = service_.metrics();
+        metrics.bytes_received.add(size);
+        metrics.reads.add();
+
+        if (started != std::chrono::steady_clock::time_point{})
+        {
+            auto elapsed = std::chrono::nanoseconds{std::chrono::steady_clock::now() - started};
+            auto nanoseconds = static_cast<uint64_t>(elapsed.count());
+
+            metrics_->handler_time.fetch_add(nanoseconds, std::memory_order_relaxed);
+            metrics.handler_time.record(nanoseconds);
+        }
+    }
+
+    void connection::on_written(size_t size, std::chrono::steady_clock::time_point queued_at)
+    {
+        metrics_->bytes_sent.fetch_add(size, std::memory_order_relaxed);
+        metrics_->writes.fetch_add(1, std::memory_order_relaxed);
+
+        auto& metrics = service_.metrics();
+        metrics.bytes_sent.add(size);
+        metrics.writes.add();
+
+        // Messages queued while latencies weren't recorded don't have a timestamp
+        if (queued_at != std::chrono::steady_clock::time_point{})
+        {
+            auto latency = std::chrono::nanoseconds{std::chrono::steady_clock::now() - queued_at};
+            metrics.send_latency.record(static_cast<uint64_t>(latency.count()));
+        }
+    }
+
+    void connection::on_error()
+    {
+        metrics_->errors.fetch_add(1, std::memory_order_relaxed);
+        service_.metrics().errors.add();
+    }
+
     void connection::stop()
     {
-        socket_.close();
+        transport_->close();
     }
 }
\ No newline at end of file
@@ -20,39 +20,106 @@
 namespace keycap::root::network
 {
     data_router::data_router()
+      : inbound_handlers_{std::make_shared<inbound_list const>()}
+      , outbound_handlers_{std::make_shared<outbound_list const>()}
     {
     }
 
     void data_router::configure_inbound(message_handler* handler)
     {
-        inbound_handlers_.push_back(handler);
+        std::lock_guard lock{update_mutex_};
+
+        auto handlers = std::make_shared<inbound_list>(*inbound_handlers_.load());
+        handlers->push_back(handler);
+        inbound_handlers_.store(std::move(handlers));
     }
 
     void data_router::configure_outbound(std::weak_ptr<connection_base> handler)
     {
-        outbound_handlers.push_back(handler);
+        if (handler.expired())
+            return;
+
+        std::lock_guard lock{update_mutex_};
+
+        // Drop connections that went away in the meantime
+        auto handlers = std::make_shared<outbound_list>(*outbound_handlers_.load());
+        std::erase_if(*handlers, [](auto const& connection) { return connection.expired(); });
+        handlers->push_back(std::move(handler));
+        outbound_handlers_.store(std::move(handlers));
     }
 
     void data_router::remove_handler(message_handler* handler)
     {
-        inbound_handlers_.erase(
+        std::lock_guard lock{update_mutex_};
+
+        auto handlers = std::make_shared<inbound_list>(*inbound_handlers_.load());
+        handlers->erase(
             std::remove_if(
-                inbound_handlers_.begin(), inbound_handlers_.end(),
+                handlers->begin(), handlers->end(),
                 [&](message_handler* messageHandler) { return messageHandler->operator==(*handler); }), // explicit call because MSVC thinks this is some WindowsSDK type...
-            inbound_handlers_.end());
+            handlers->end());
+        inbound_handlers_.store(std::move(handlers));
+    }
+
+    void data_router::remove_outbound(connection_base const* handler)
+    {
+        std::lock_guard lock{update_mutex_};
+
+        auto handlers = std::make_shared<outbound_list>(*outbound_handlers_.load());
+        std::erase_if(*handlers, [&](auto const& connection) {
+            auto locked = connection.lock();
+            return !locked || locked.get() == handler;
+        });
+        outbound_handlers_.store(std::move(handlers));
     }
 
-    void data_router::route_updated_link_status(service_base& service, link_status status) const
+    void data_router::configure_dispatch(std::shared_ptr<opcode_table const> table)
     {
-        for (auto handler : inbound_handlers_)
+        opcode_table_.store(std::move(table));
+        partial_frame_.clear();
+    }
+
+    void data_router::route_updated_link_status(service_base& service, link_status status)
+    {
+        // Keep the snapshot alive while iterating it
+        auto handlers = inbound_handlers_.load();
+        for (auto handler : *handlers)
             handler->on_link(*this, service.type(), status);
     }
 
-    bool data_router::route_inbound(service_base& service, std::span<uint8_t> data) const
+    bool data_router::route_inbound(service_base& service, std::span<uint8_t> data)
     {
+        if (auto table = opcode_table_.load())
+        {
+            // Only copy the data if a frame spans multiple reads
+            if (partial_frame_.has_data_remaining())
+            {
+                partial_frame_.put(data);
+                data = partial_frame_.to_span();
+            }
+
+            auto consumed = dispatch(*table, service.type(), data);
+            if (!consumed)
+            {
+                partial_frame_.clear();
+                return false;
+            }
+
+            if (partial_frame_.has_data_remaining())
+            {
+                partial_frame_.advance(static_cast<int>(*consumed));
+                partial_frame_.shrink();
+            }
+            else
+                partial_frame_.put(data.subspan(*consumed));
+
+            return true;
+        }
+
         bool succeeded = true;
 
-        for (auto handler : inbound_handlers_)
+        auto handlers = inbound_handlers_.load();
+        for (auto handler : *handlers)
             succeeded = succeeded && handler->on_data(*this, service.type(), data);
 
         return succeeded;
@@ -60,12 +127,42 @@ namespace keycap::root::network
 
     void data_router::route_outbound(std::span<uint8_t> data) const
     {
-        for (auto&& handlerPtr : outbound_handlers)
+        auto handlers = outbound_handlers_.load();
+        if (handlers->empty())
+            return;
+
+        // Copy the data once and share it between all connections
+        auto buffer = make_shared_buffer(data);
+        for (auto&& handler : *handlers)
         {
-            if (auto handler = handlerPtr.lock())
-            {
-                handler->send(data);
-            }
+            if (auto connection = handler.lock())
+                connection->send(buffer);
+        }
+    }
+
+    std::optional<size_t> data_router::dispatch(opcode_table const& table, service_type service,
+                                                std::span<uint8_t> data) const
+    {
+        size_t consumed = 0;
+
+        while (consumed < data.size())
+        {
+            auto remaining = data.subspan(consumed);
+
+            auto header = table.read_frame(remaining);
+            if (!header || header->size > remaining.size())
+                break;
+
+            if (header->size == 0)
+                return {};
+
+            auto handler = table.find(header->opcode);
+            if (!handler || !(*handler)(*this, service, remaining.first(header->size)))
+                return {};
+
+            consumed += header->size;
         }
+
+        return consumed;
     }
 }
\ No newline at end of file
@@ -0,0 +1,218 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/network/loopback_transport.hpp>
+#include <keycap/root/utility/spsc_ring.hpp>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/use_awaitable.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+using boost::asio::awaitable;
+using boost::asio::redirect_error;
+using boost::asio::use_awaitable;
+
+namespace keycap::root::network::impl
+{
+    // A timer that never expires on its own; waking up a waiting coroutine makes it expire immediately
+    struct loopback_signal
+    {
+        explicit loopback_signal(boost::asio::io_context& context)
+          : timer{context}
+        {
+        }
+
+        boost::asio::steady_timer timer;
+    };
+
+    // The side of a channel that may be waiting for the other one
+    struct loopback_waiter
+    {
+        std::atomic<bool> waiting = false;
+
+        // Guards against the owning end going away while it's being notified
+        std::mutex mutex;
+        std::weak_ptr<loopback_signal> signal;
+    };
+
+    // A single direction of a loopback connection
+    struct loopback_channel
+    {
+        explicit loopback_channel(size_t capacity)
+          : ring{capacity}
+        {
+        }
+
+        utility::spsc_ring ring;
+        std::atomic<bool> closed = false;
+
+        loopback_waiter reader;
+        loopback_waiter writer;
+    };
+
+    namespace
+    {
+        // Marks the waiter as waiting. Must be followed by another attempt to read or write before actually waiting,
+        // as the other end might have made progress in the meantime
+        void prepare_wait(loopback_waiter& waiter, boost::asio::steady_timer& timer)
+        {
+            timer.expires_at(std::chrono::steady_clock::time_point::max());
+            waiter.waiting.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+
+        // Wakes the given waiter up if it's waiting
+        void wake(loopback_waiter& waiter)
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!waiter.waiting.load(std::memory_order_relaxed) || !waiter.waiting.exchange(false))
+                return;
+
+            std::lock_guard lock{waiter.mutex};
+            if (auto signal = waiter.signal.lock())
+            {
+                boost::asio::post(signal->timer.get_executor(), [weak = waiter.signal] {
+                    if (auto target = weak.lock())
+                        target->timer.expires_at(std::chrono::steady_clock::time_point::min());
+                });
+            }
+        }
+
+        void detach(loopback_waiter& waiter)
+        {
+            std::lock_guard lock{waiter.mutex};
+            waiter.signal.reset();
+        }
+    }
+}
+
+namespace keycap::root::network
+{
+    loopback_transport::loopback_transport(
+        std::shared_ptr<impl::loopback_channel> in, std::shared_ptr<impl::loopback_channel> out,
+        boost::asio::io_context& context)
+      : in_{std::move(in)}
+      , out_{std::move(out)}
+      , read_signal_{std::make_shared<impl::loopback_signal>(context)}
+      , write_signal_{std::make_shared<impl::loopback_signal>(context)}
+    {
+        in_->reader.signal = read_signal_;
+        out_->writer.signal = write_signal_;
+    }
+
+    loopback_transport::~loopback_transport()
+    {
+        close();
+
+        impl::detach(in_->reader);
+        impl::detach(out_->writer);
+    }
+
+    awaitable<size_t> loopback_transport::read_some(std::span<uint8_t> buffer)
+    {
+        while (true)
+        {
+            if (auto size = in_->ring.read(buffer); size != 0)
+            {
+                impl::wake(in_->writer);
+                co_return size;
+            }
+
+            impl::prepare_wait(in_->reader, read_signal_->timer);
+
+            if (auto size = in_->ring.read(buffer); size != 0)
+            {
+                in_->reader.waiting.store(false, std::memory_order_relaxed);
+                impl::wake(in_->writer);
+                co_return size;
+            }
+
+            // Data written before closing must still be received
+            if (in_->closed)
+                throw boost::system::system_error{boost::asio::error::eof};
+
+            boost::system::error_code error;
+            co_await read_signal_->timer.async_wait(redirect_error(use_awaitable, error));
+        }
+    }
+
+    awaitable<void> loopback_transport::write(std::span<uint8_t const> data)
+    {
+        while (!data.empty())
+        {
+            if (out_->closed)
+                throw boost::system::system_error{boost::asio::error::broken_pipe};
+
+            if (auto size = out_->ring.write(data); size != 0)
+            {
+                data = data.subspan(size);
+                impl::wake(out_->reader);
+                continue;
+            }
+
+            impl::prepare_wait(out_->writer, write_signal_->timer);
+
+            if (auto size = out_->ring.write(data); size != 0)
+            {
+                out_->writer.waiting.store(false, std::memory_order_relaxed);
+                data = data.subspan(size);
+                impl::wake(out_->reader);
+                continue;
+            }
+
+            if (out_->closed)
+                throw boost::system::system_error{boost::asio::error::broken_pipe};
+
+            boost::system::error_code error;
+            co_await write_signal_->timer.async_wait(redirect_error(use_awaitable, error));
+        }
+    }
+
+    void loopback_transport::close()
+    {
+        closed_ = true;
+        in_->closed = true;
+        out_->closed = true;
+
+        impl::wake(in_->reader);
+        impl::wake(in_->writer);
+        impl::wake(out_->reader);
+        impl::wake(out_->writer);
+    }
+
+    bool loopback_transport::is_open() const
+    {
+        // The other end closing only ends the stream, which read_some reports once it has been drained
+        return !closed_;
+    }
+
+    std::pair<std::unique_ptr<transport>, std::unique_ptr<transport>> make_loopback_pair(
+        boost::asio::io_context& context1, boost::asio::io_context& context2, size_t capacity)
+    {
+        auto forward = std::make_shared<impl::loopback_channel>(capacity);
+        auto backward = std::make_shared<impl::loopback_channel>(capacity);
+
+        std::unique_ptr<transport> first{new loopback_transport{backward, forward, context1}};
+        std::unique_ptr<transport> second{new loopback_transport{forward, backward, context2}};
+
+        return {std::move(first), std::move(second)};
+    }
+}
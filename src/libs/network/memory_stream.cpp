@@ -36,6 +36,35 @@ namespace keycap::root::network
         return buffer.size();
     }
 
+    size_t memory_stream::decompress(size_t compressed_length, size_t uncompressed_length)
+    {
+        if (compressed_length > size())
+            throw exception{"Attempted to read past buffer end!"};
+
+        if (compressed_length == 0 || uncompressed_length == 0)
+            return 0;
+
+        // Make room for the decompressed data in front of the compressed data, so it can be inflated in place and
+        // only the (smaller) compressed data and whatever follows it is moved
+        auto position = buffer_.begin() + static_cast<ptrdiff_t>(read_position_);
+        buffer_.insert(position, uncompressed_length, 0);
+
+        std::span<uint8_t const> input{buffer_.data() + read_position_ + uncompressed_length, compressed_length};
+        std::span<uint8_t> output{buffer_.data() + read_position_, uncompressed_length};
+
+        auto decompressed = compression::zip::decompress_into(input, output);
+
+        // Remove the compressed data and whatever hasn't been used of the decompressed data's room. Restores the
+        // original buffer if decompressing failed
+        auto used = decompressed ? *decompressed : 0;
+        auto begin = buffer_.begin() + static_cast<ptrdiff_t>(read_position_ + used);
+        auto end = buffer_.begin() + static_cast<ptrdiff_t>(
+                                         read_position_ + uncompressed_length + (decompressed ? compressed_length : 0));
+        buffer_.erase(begin, end);
+
+        return used;
+    }
+
     bool memory_stream::has_data_remaining() const
     {
         return size() != 0;
@@ -17,18 +17,28 @@
 #include <keycap/root/network/data_router.hpp>
 #include <keycap/root/network/message_handler.hpp>
 
-#include <boost/uuid/random_generator.hpp>
+#include <atomic>
 
 namespace keycap::root::network
 {
+    namespace
+    {
+        std::uint64_t next_handler_id() noexcept
+        {
+            // Only uniqueness matters, there's nothing to synchronize with
+            static std::atomic<std::uint64_t> next_id{1};
+            return next_id.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
     message_handler::message_handler() noexcept
-      : uuid_{boost::uuids::random_generator{}()}
+      : id_{next_handler_id()}
     {
     }
 
     message_handler::message_handler(message_handler const&) noexcept
+      : id_{next_handler_id()}
     {
-        uuid_ = boost::uuids::random_generator{}();
     }
 
     message_handler::~message_handler()
@@ -37,6 +47,6 @@ namespace keycap::root::network
 
     bool message_handler::operator==(message_handler const& rhs) noexcept
     {
-        return uuid_ == rhs.uuid_;
+        return id_ == rhs.id_;
     }
 }
\ No newline at end of file
@@ -0,0 +1,206 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/network/metrics.hpp>
+
+#include <algorithm>
+#include <format>
+
+namespace keycap::root::network
+{
+    namespace
+    {
+        // Label values must escape backslashes, double quotes and line feeds in the exposition format
+        std::string escape_label_value(std::string_view value)
+        {
+            std::string escaped;
+            escaped.reserve(value.size());
+
+            for (auto c : value)
+            {
+                switch (c)
+                {
+                    case '\\':
+                        escaped += "\\\\";
+                        break;
+                    case '"':
+                        escaped += "\\\"";
+                        break;
+                    case '\n':
+                        escaped += "\\n";
+                        break;
+                    default:
+                        escaped += c;
+                }
+            }
+
+            return escaped;
+        }
+    }
+
+    uint64_t counter::value() const noexcept
+    {
+        uint64_t value = 0;
+        for (auto const& slot : slots_)
+            value += slot.value.load(std::memory_order_relaxed);
+
+        return value;
+    }
+
+    size_t counter::slot() noexcept
+    {
+        static std::atomic<size_t> next = 0;
+        thread_local size_t const slot = next.fetch_add(1, std::memory_order_relaxed) % slot_count;
+        return slot;
+    }
+
+    connection_metrics::connection_metrics() noexcept
+      : id{[] {
+          static std::atomic<uint64_t> next = 0;
+          return next.fetch_add(1, std::memory_order_relaxed);
+      }()}
+    {
+    }
+
+    void service_metrics::track(std::shared_ptr<connection_metrics const> connection)
+    {
+        std::lock_guard lock{mutex_};
+        std::erase_if(connections_, [](auto const& weak) { return weak.expired(); });
+        connections_.push_back(std::move(connection));
+    }
+
+    void service_metrics::for_each_connection(
+        std::function<void(connection_metrics const& connection)> const& callback) const
+    {
+        std::vector<std::shared_ptr<connection_metrics const>> alive;
+        {
+            std::lock_guard lock{mutex_};
+            std::erase_if(connections_, [&](auto const& weak) {
+                auto connection = weak.lock();
+                if (!connection)
+                    return true;
+
+                alive.push_back(std::move(connection));
+                return false;
+            });
+        }
+
+        for (auto const& connection : alive)
+            callback(*connection);
+    }
+
+    prometheus_writer::prometheus_writer(std::string prefix)
+      : prefix_{std::move(prefix)}
+    {
+    }
+
+    void prometheus_writer::add(std::string_view service, service_metrics const& metrics)
+    {
+        auto labels = std::format("service=\"{}\"", escape_label_value(service));
+
+        auto add_counter = [&](std::string_view name, std::string_view help, counter const& value) {
+            auto& target = get_family(name, "counter", help);
+            target.samples += std::format("{}{{{}}} {}\n", target.name, labels, value.value());
+        };
+
+        add_counter("connections_total", "Number of connections established", metrics.connections);
+        add_counter("received_bytes_total", "Number of bytes received", metrics.bytes_received);
+        add_counter("sent_bytes_total", "Number of bytes sent", metrics.bytes_sent);
+        add_counter("reads_total", "Number of completed reads", metrics.reads);
+        add_counter("writes_total", "Number of completed writes", metrics.writes);
+        add_counter("errors_total", "Number of connections closed due to an error", metrics.errors);
+
+        add_summary(
+            get_family("send_latency_seconds", "summary", "Time from sending a message until it has been written"),
+            labels, metrics.send_latency);
+        add_summary(
+            get_family(
+                "handler_seconds", "summary", "Time from a read completing until the message handlers processed it"),
+            labels, metrics.handler_time);
+
+        metrics.for_each_connection([&](connection_metrics const& connection) {
+            auto connection_labels = std::format("{},connection=\"{}\"", labels, connection.id);
+
+            auto add_sample = [&](std::string_view name, std::string_view type, std::string_view help, auto value) {
+                auto& target = get_family(name, type, help);
+                target.samples += std::format("{}{{{}}} {}\n", target.name, connection_labels, value);
+            };
+
+            add_sample(
+                "connection_received_bytes_total", "counter", "Number of bytes received by a connection",
+                connection.bytes_received.load(std::memory_order_relaxed));
+            add_sample(
+                "connection_sent_bytes_total", "counter", "Number of bytes sent by a connection",
+                connection.bytes_sent.load(std::memory_order_relaxed));
+            add_sample(
+                "connection_reads_total", "counter", "Number of completed reads of a connection",
+                connection.reads.load(std::memory_order_relaxed));
+            add_sample(
+                "connection_writes_total", "counter", "Number of completed writes of a connection",
+                connection.writes.load(std::memory_order_relaxed));
+            add_sample(
+                "connection_errors_total", "counter", "Number of errors of a connection",
+                connection.errors.load(std::memory_order_relaxed));
+            add_sample(
+                "connection_queued_messages", "gauge", "Number of messages waiting to be sent by a connection",
+                connection.queued.load(std::memory_order_relaxed));
+            add_sample(
+                "connection_handler_seconds_total", "counter",
+                "Time spent routing data received by a connection to the message handlers",
+                static_cast<double>(connection.handler_time.load(std::memory_order_relaxed)) / 1e9);
+        });
+    }
+
+    std::string prometheus_writer::str() const
+    {
+        std::string text;
+        for (auto const& metric : families_)
+        {
+            text += std::format("# HELP {} {}\n# TYPE {} {}\n", metric.name, metric.help, metric.name, metric.type);
+            text += metric.samples;
+        }
+
+        return text;
+    }
+
+    prometheus_writer::family& prometheus_writer::get_family(
+        std::string_view name, std::string_view type, std::string_view help)
+    {
+        auto full_name = std::format("{}_{}", prefix_, name);
+
+        auto itr = std::find_if(
+            families_.begin(), families_.end(), [&](family const& existing) { return existing.name == full_name; });
+        if (itr != families_.end())
+            return *itr;
+
+        return families_.emplace_back(family{std::move(full_name), std::string{type}, std::string{help}, {}});
+    }
+
+    void prometheus_writer::add_summary(
+        family& target, std::string_view labels, utility::hdr_histogram const& values)
+    {
+        for (auto quantile : {0.5, 0.99, 0.999})
+        {
+            target.samples += std::format(
+                "{}{{{},quantile=\"{}\"}} {}\n", target.name, labels, quantile,
+                static_cast<double>(values.value_at_percentile(quantile * 100)) / 1e9);
+        }
+
+        target.samples += std::format(
+            "{}_sum{{{}}} {}\n", target.name, labels, static_cast<double>(values.sum()) / 1e9);
+        target.samples += std::format("{}_count{{{}}} {}\n", target.name, labels, values.count());
+    }
+}
@@ -0,0 +1,40 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/network/opcode_table.hpp>
+
+namespace keycap::root::network
+{
+    opcode_table::opcode_table(frame_reader reader, uint32 dense_limit)
+      : reader_{std::move(reader)}
+      , dense_limit_{dense_limit}
+    {
+    }
+
+    void opcode_table::add(uint32 opcode, handler callback)
+    {
+        if (opcode >= dense_limit_)
+        {
+            sparse_.insert_or_assign(opcode, std::move(callback));
+            return;
+        }
+
+        if (opcode >= dense_.size())
+            dense_.resize(opcode + 1);
+
+        dense_[opcode] = std::move(callback);
+    }
+}
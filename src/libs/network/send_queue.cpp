@@ -0,0 +1,141 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/network/send_queue.hpp>
+
+#include <algorithm>
+
+namespace keycap::root::network
+{
+    void send_queue::push(shared_buffer data, send_priority priority, time_point queued_at)
+    {
+        std::lock_guard lock{mutex_};
+        lanes_[static_cast<size_t>(priority)].push_back(entry{std::move(data), queued_at, 0, 0, {}});
+    }
+
+    void send_queue::push_chunked(
+        shared_buffer data, send_priority priority, size_t chunk_size, framer frame, time_point queued_at)
+    {
+        if (chunk_size == 0 || !frame)
+        {
+            push(std::move(data), priority, queued_at);
+            return;
+        }
+
+        std::lock_guard lock{mutex_};
+        lanes_[static_cast<size_t>(priority)].push_back(
+            entry{std::move(data), queued_at, 0, chunk_size, std::move(frame)});
+    }
+
+    shared_buffer send_queue::pop()
+    {
+        time_point queued_at;
+        return pop(queued_at);
+    }
+
+    shared_buffer send_queue::pop(time_point& queued_at)
+    {
+        std::lock_guard lock{mutex_};
+
+        auto& lane = next_lane();
+        if (lane.empty())
+            return nullptr;
+
+        auto& front = lane.front();
+        queued_at = front.queued_at;
+        if (!front.frame)
+        {
+            auto data = std::move(front.data);
+            lane.pop_front();
+            return data;
+        }
+
+        auto size = std::min(front.chunk_size, front.data->size() - front.offset);
+        auto last = front.offset + size == front.data->size();
+        auto chunk = front.frame(std::span<uint8 const>{front.data->data() + front.offset, size}, last);
+
+        front.offset += size;
+        if (last)
+            lane.pop_front();
+
+        return chunk;
+    }
+
+    bool send_queue::empty() const
+    {
+        std::lock_guard lock{mutex_};
+        return std::all_of(lanes_.begin(), lanes_.end(), [](auto const& lane) { return lane.empty(); });
+    }
+
+    size_t send_queue::size(send_priority priority) const
+    {
+        std::lock_guard lock{mutex_};
+        return lanes_[static_cast<size_t>(priority)].size();
+    }
+
+    size_t send_queue::size() const
+    {
+        std::lock_guard lock{mutex_};
+
+        size_t size = 0;
+        for (auto const& lane : lanes_)
+            size += lane.size();
+
+        return size;
+    }
+
+    void send_queue::set_weights(uint32 normal, uint32 low)
+    {
+        std::lock_guard lock{mutex_};
+        normal_weight_ = std::max(normal, 1u);
+        low_weight_ = std::max(low, 1u);
+        normal_sent_ = 0;
+        low_sent_ = 0;
+    }
+
+    std::deque<send_queue::entry>& send_queue::next_lane()
+    {
+        auto& high = lanes_[static_cast<size_t>(send_priority::High)];
+        auto& normal = lanes_[static_cast<size_t>(send_priority::Normal)];
+        auto& low = lanes_[static_cast<size_t>(send_priority::Low)];
+
+        if (!high.empty())
+            return high;
+
+        if (normal.empty() || low.empty())
+        {
+            // Weights only matter while both lanes compete
+            normal_sent_ = 0;
+            low_sent_ = 0;
+            return normal.empty() ? low : normal;
+        }
+
+        if (normal_sent_ == normal_weight_ && low_sent_ == low_weight_)
+        {
+            normal_sent_ = 0;
+            low_sent_ = 0;
+        }
+
+        if (normal_sent_ < normal_weight_)
+        {
+            ++normal_sent_;
+            return normal;
+        }
+
+        ++low_sent_;
+        return low;
+    }
+}
@@ -14,25 +14,68 @@
     limitations under the License.
 */
 
+#include <keycap/root/exception.hpp>
 #include <keycap/root/network/service_base.hpp>
+#include <keycap/root/network/shm_transport.hpp>
 
 #include <boost/asio/awaitable.hpp>
 #include <boost/asio/co_spawn.hpp>
 #include <boost/asio/detached.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <vector>
 
 using boost::asio::awaitable;
 using boost::asio::co_spawn;
 using boost::asio::detached;
 using boost::asio::use_awaitable;
 using boost::asio::ip::tcp;
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+using boost::asio::local::stream_protocol;
+#endif
 
 namespace keycap::root::network
 {
+    namespace
+    {
+        // All services within this process that are listening for connections
+        struct local_servers
+        {
+            // Recursive as servers may start listening while accepting a local connection
+            std::recursive_mutex mutex;
+            std::vector<service_base*> servers;
+        };
+
+        local_servers& get_local_servers()
+        {
+            static local_servers servers;
+            return servers;
+        }
+
+        // Servers listening on any address accept local clients connecting to the loopback address
+        bool matches(tcp::endpoint const& server, tcp::endpoint const& client)
+        {
+            if (server.port() != client.port())
+                return false;
+
+            return server.address() == client.address()
+                   || (server.address().is_unspecified() && client.address().is_loopback());
+        }
+    }
+
     service_base::service_base(service_type type)
       : type_{type}
     {
     }
 
+    service_base::~service_base()
+    {
+        unlisten_local();
+    }
+
     service_type service_base::type()
     {
         return type_;
@@ -62,10 +105,99 @@ namespace keycap::root::network
         }
     }
 
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    // Hands the given transport over to the service, closing it if the service doesn't support it
+    void handle_new_transport(service_base* self, std::unique_ptr<transport> transport)
+    {
+        if (!self->handle_local_connection(std::move(transport)))
+            std::printf("error: The service doesn't support unix domain socket and shared memory transports\n");
+    }
+
+    // Sets up a shared memory connection using the given socket
+    awaitable<void> do_accept_shm(service_base* self, stream_protocol::socket socket)
+    {
+#ifdef KEYCAP_ROOT_HAS_SHM_TRANSPORT
+        try
+        {
+            handle_new_transport(self, co_await shm_transport::accept(std::move(socket)));
+        }
+        catch (std::exception& ex)
+        {
+            std::printf("error: %s\n", ex.what());
+        }
+#else
+        std::printf("error: Shared memory transports aren't supported on this platform\n");
+        co_return;
+#endif
+    }
+
+    awaitable<void> do_listen_local(service_base* self, stream_protocol::acceptor acceptor, transport_kind kind)
+    {
+        while (self->running())
+        {
+            auto socket = co_await acceptor.async_accept(use_awaitable);
+
+            // Shared memory connections have to exchange the segment first, which mustn't hold up other clients
+            if (kind == transport_kind::SharedMemory)
+                co_spawn(acceptor.get_executor(), do_accept_shm(self, std::move(socket)), detached);
+            else
+                handle_new_transport(self, std::make_unique<unix_transport>(std::move(socket)));
+        }
+    }
+
+    awaitable<void> do_connect_local(service_base* self, service_endpoint address)
+    {
+        try
+        {
+            stream_protocol::socket socket(self->io_context());
+            co_await socket.async_connect(stream_protocol::endpoint{address.path}, use_awaitable);
+
+            if (address.kind == transport_kind::Unix)
+                handle_new_transport(self, std::make_unique<unix_transport>(std::move(socket)));
+#ifdef KEYCAP_ROOT_HAS_SHM_TRANSPORT
+            else
+                handle_new_transport(self, co_await shm_transport::connect(std::move(socket), address.capacity));
+#else
+            else
+                throw exception{"Shared memory transports aren't supported on this platform!"};
+#endif
+        }
+        catch (std::exception& ex)
+        {
+            std::printf("error: %s\n", ex.what());
+        }
+    }
+#endif
+
     void service_base::listen()
     {
         running_ = true;
 
+        {
+            auto& local = get_local_servers();
+            std::lock_guard lock{local.mutex};
+            if (std::find(local.servers.begin(), local.servers.end(), this) == local.servers.end())
+                local.servers.push_back(this);
+        }
+
+        if (address_.kind != transport_kind::Tcp)
+        {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+            // The socket file of a previous run would make binding fail
+            std::remove(address_.path.c_str());
+
+            co_spawn(
+                io_context_,
+                do_listen_local(
+                    this, stream_protocol::acceptor(io_context_, stream_protocol::endpoint{address_.path}),
+                    address_.kind),
+                detached);
+            return;
+#else
+            throw exception{"Unix domain sockets aren't supported on this platform!"};
+#endif
+        }
+
         co_spawn(
             io_context_,
             [this] {
@@ -77,6 +209,16 @@ namespace keycap::root::network
 
     void service_base::connect()
     {
+        if (address_.kind != transport_kind::Tcp)
+        {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+            co_spawn(io_context_, do_connect_local(this, address_), detached);
+            return;
+#else
+            throw exception{"Unix domain sockets aren't supported on this platform!"};
+#endif
+        }
+
         auto handler = [](service_base* self, auto endpoint) -> awaitable<void> {
             try
             {
@@ -98,4 +240,32 @@ namespace keycap::root::network
             },
             detached);
     }
-}
\ No newline at end of file
+
+    bool service_base::with_local_server(std::function<bool(service_base& server)> const& callback)
+    {
+        auto& local = get_local_servers();
+        std::lock_guard lock{local.mutex};
+
+        auto itr = std::find_if(local.servers.begin(), local.servers.end(), [&](service_base* server) {
+            if (server == this || server->address_.kind != address_.kind)
+                return false;
+
+            if (address_.kind == transport_kind::Tcp)
+                return matches(server->endpoint_, endpoint_);
+
+            return server->address_.path == address_.path;
+        });
+
+        if (itr == local.servers.end())
+            return false;
+
+        return callback(**itr);
+    }
+
+    void service_base::unlisten_local()
+    {
+        auto& local = get_local_servers();
+        std::lock_guard lock{local.mutex};
+        std::erase(local.servers, this);
+    }
+}
@@ -23,8 +23,20 @@
 
 namespace keycap::root::network
 {
+    service_locator::~service_locator()
+    {
+        // Links going down schedule a reconnect, so the services must be stopped while schedule_ is still alive
+        services_.clear();
+    }
+
     void service_locator::locate(
         service_type type, std::string const& host, uint16_t port, std::optional<located_callback_container> callback)
+    {
+        locate(type, service_endpoint::tcp(host, port), std::move(callback));
+    }
+
+    void service_locator::locate(
+        service_type type, service_endpoint const& endpoint, std::optional<located_callback_container> callback)
     {
         if (auto itr = services_.find(type.get()); itr != services_.end())
             return;
@@ -33,7 +45,7 @@ namespace keycap::root::network
             located_callbacks_.try_emplace(type.get(), *callback);
 
         auto& service = services_.try_emplace(services_.end(), type.get(), type, this)->second;
-        service.start(host, port);
+        service.start(endpoint);
     }
 
     void service_locator::remove_located_callback(service_type type)
@@ -43,14 +55,112 @@ namespace keycap::root::network
 
     void service_locator::send_to(service_type type, memory_stream const& message)
     {
+        if (auto window = flush_window_.load(); window.count() != 0)
+        {
+            std::unique_lock<std::mutex> lock{batches_mutex_};
+            auto& pending = batches_[type.get()];
+            auto& batch = pending.batch;
+
+            if (batch.empty())
+            {
+                schedule_.add(window, [this, type, generation = pending.generation](boost::system::error_code error) {
+                    if (error != boost::asio::error::operation_aborted)
+                        flush(type, generation);
+                });
+            }
+
+            batch.add(0, registered_command::Update, message);
+
+            if (batch.size() >= max_batch_size)
+            {
+                lock.unlock();
+                flush(type);
+            }
+
+            return;
+        }
+
         registered_message msg;
-        msg.crc = utility::crc32(uint64{0}, registered_command::Update, message);
         msg.sender = 0;
         msg.command = registered_command::Update;
         msg.payload = message;
 
-        auto stream = msg.encode();
-        send_to_(type, stream);
+        send_message(type, msg);
+    }
+
+    void service_locator::set_flush_window(std::chrono::milliseconds window)
+    {
+        flush_window_ = window;
+    }
+
+    void service_locator::set_checksum_algorithm(utility::checksum_algorithm algorithm)
+    {
+        checksum_ = algorithm;
+
+        std::lock_guard<std::mutex> lock{readers_mutex_};
+        readers_.clear();
+    }
+
+    void service_locator::set_compression(
+        std::shared_ptr<compression::codec const> codec, compression::policy_settings settings)
+    {
+        if (codec)
+            compression_.store(std::make_shared<compression::compression_policy>(std::move(codec), settings));
+        else
+            compression_.store(nullptr);
+    }
+
+    compression::policy_statistics service_locator::compression_statistics() const
+    {
+        auto compression = compression_.load();
+        if (!compression)
+            return {};
+
+        return compression->statistics();
+    }
+
+    void service_locator::set_stream_compression(std::optional<int> level)
+    {
+        stream_compression_ = level;
+    }
+
+    void service_locator::flush()
+    {
+        std::vector<service_type_t> types;
+        {
+            std::lock_guard<std::mutex> lock{batches_mutex_};
+            for (auto& [type, pending] : batches_)
+            {
+                if (!pending.batch.empty())
+                    types.push_back(type);
+            }
+        }
+
+        for (auto type : types)
+            flush(service_type{type});
+    }
+
+    void service_locator::flush(service_type type, std::optional<uint64> generation)
+    {
+        registered_batch batch;
+        {
+            std::lock_guard<std::mutex> lock{batches_mutex_};
+            auto itr = batches_.find(type.get());
+            if (itr == batches_.end() || itr->second.batch.empty())
+                return;
+
+            auto& pending = itr->second;
+            if (generation && *generation != pending.generation)
+                return;
+
+            batch = std::move(pending.batch);
+            pending.batch = registered_batch{};
+            ++pending.generation;
+        }
+
+        // Batches compress better than their messages on their own
+        auto msg = batch.to_message(checksum_);
+        send_message(type, msg);
     }
 
     void service_locator::send_registered(
@@ -62,13 +172,11 @@ namespace keycap::root::network
         registered_callbacks_.try_emplace(counter, registered_callback_container{type.get(), io_service, callback});
 
         registered_message msg;
-        msg.crc = utility::crc32(counter, registered_command::Request, message);
         msg.sender = counter;
         msg.command = registered_command::Request;
         msg.payload = message;
 
-        auto stream = msg.encode();
-        send_to_(type, stream);
+        send_message(type, msg);
     }
 
     size_t service_locator::service_count() const
@@ -78,19 +186,61 @@ namespace keycap::root::network
 
     bool service_locator::on_data(data_router const& router, service_type service, std::span<uint8_t> data)
     {
-        memory_stream stream(data.begin(), data.end());
+        std::vector<registered_message> messages;
+        {
+            std::lock_guard<std::mutex> lock{readers_mutex_};
+            auto& reader = readers_.try_emplace(service.get(), checksum_).first->second;
+            reader.put(data);
 
-        if (!registered_message::can_decode(stream))
-            return true;
+            while (reader.can_read())
+            {
+                auto msg = reader.read();
+                if (!msg)
+                {
+                    // TODO: implement error handling callback
+                    return false;
+                }
+
+                messages.push_back(std::move(*msg));
+            }
+        }
 
-        auto msg = registered_message::decode(stream);
+        for (auto& msg : messages)
+        {
+            if (!on_message(service, msg))
+                return false;
+        }
+
+        return true;
+    }
 
-        if (!utility::validate_crc32(msg.crc, msg.sender, msg.command, msg.payload))
+    bool service_locator::on_message(service_type sender_type, registered_message& msg)
+    {
+        if (msg.command.get() == registered_command::Compressed)
         {
-            // TODO: implement error handling callback
+            auto compression = compression_.load();
+            if (!compression || !msg.decompress(compression->get_codec()))
+                return false;
+        }
+
+        if (msg.command.get() != registered_command::Batch)
+            return on_answer(sender_type, msg);
+
+        auto messages = registered_batch::unpack(msg.payload);
+        if (!messages)
             return false;
+
+        for (auto& message : *messages)
+        {
+            if (!on_answer(sender_type, message))
+                return false;
         }
 
+        return true;
+    }
+
+    bool service_locator::on_answer(service_type /*sender_type*/, registered_message& msg)
+    {
         auto itr = registered_callbacks_.find(msg.sender);
         if (itr == registered_callbacks_.end())
         {
@@ -111,6 +261,12 @@ namespace keycap::root::network
 
     bool service_locator::on_link(data_router const& router, service_type service, link_status status)
     {
+        {
+            // Every link starts with a fresh stream of messages
+            std::lock_guard<std::mutex> lock{readers_mutex_};
+            readers_.erase(service.get());
+        }
+
         if (status == link_status::Up)
         {
             if (auto itr = located_callbacks_.find(service.get()); itr != located_callbacks_.end())
@@ -137,6 +293,17 @@ namespace keycap::root::network
         return true;
     }
 
+    void service_locator::send_message(service_type type, registered_message& message)
+    {
+        if (auto compression = compression_.load())
+            message.compress(*compression, static_cast<uint32>(message.command.get()));
+
+        message.sign(checksum_);
+
+        auto stream = message.encode();
+        send_to_(type, stream);
+    }
+
     void service_locator::send_to_(service_type type, memory_stream& message)
     {
         auto itr = services_.find(type.get());
@@ -161,6 +328,19 @@ namespace keycap::root::network
       : base{std::move(socket), service}
     {
         router_.configure_inbound(locator);
+
+        if (auto level = locator->stream_compression_.load())
+            enable_compression(*level);
+    }
+
+    service_locator::connection::connection(
+        std::unique_ptr<transport> transport, service_base& service, service_locator* locator)
+      : base{std::move(transport), service}
+    {
+        router_.configure_inbound(locator);
+
+        if (auto level = locator->stream_compression_.load())
+            enable_compression(*level);
     }
 
     service_locator::service::service(service_type type, service_locator* locator)
@@ -175,4 +355,12 @@ namespace keycap::root::network
         connection_ = conn;
         return conn;
     }
+
+    service_locator::service::SharedHandler service_locator::service::make_local_handler(
+        std::unique_ptr<transport> transport)
+    {
+        auto conn = std::make_shared<connection>(std::move(transport), *this, locator_);
+        connection_ = conn;
+        return conn;
+    }
 }
\ No newline at end of file
@@ -0,0 +1,417 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/network/shm_transport.hpp>
+
+#if defined(KEYCAP_ROOT_HAS_SHM_TRANSPORT)
+
+#include <keycap/root/exception.hpp>
+#include <keycap/root/utility/spsc_ring.hpp>
+
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/asio/write.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <string>
+#include <utility>
+
+using boost::asio::awaitable;
+using boost::asio::redirect_error;
+using boost::asio::use_awaitable;
+
+namespace keycap::root::network::impl
+{
+    namespace
+    {
+        constexpr uint64_t shm_magic = 0x6b65796361707368;
+        constexpr size_t shm_min_capacity = 4096;
+        constexpr char const shm_prefix[] = "/keycap-root-";
+
+        static_assert(std::atomic<uint32_t>::is_always_lock_free, "shm_transport requires lock-free atomics");
+
+        // Whether the consumer and the producer of a ring are waiting for the doorbell
+        struct shm_waiters
+        {
+            alignas(64) std::atomic<uint32_t> reader = 0;
+            alignas(64) std::atomic<uint32_t> writer = 0;
+        };
+
+        // The beginning of a segment. It's followed by the ring from the client to the server and the one from the
+        // server to the client
+        struct alignas(64) shm_header
+        {
+            uint64_t magic = 0;
+            uint64_t capacity = 0;
+            std::atomic<uint32_t> closed = 0;
+            shm_waiters waiters[2];
+        };
+
+        size_t segment_size(size_t capacity)
+        {
+            return sizeof(shm_header) + 2 * utility::spsc_ring::storage_size(capacity);
+        }
+
+        void* ring_memory(void* segment, size_t capacity, size_t index)
+        {
+            return static_cast<uint8_t*>(segment) + sizeof(shm_header)
+                   + index * utility::spsc_ring::storage_size(capacity);
+        }
+
+        [[noreturn]] void throw_errno(char const* what)
+        {
+            throw boost::system::system_error{errno, boost::system::system_category(), what};
+        }
+
+        // Maps the whole shared memory object behind the given descriptor and closes it
+        std::pair<void*, size_t> map(int descriptor, size_t size)
+        {
+            auto address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+            auto error = errno;
+            ::close(descriptor);
+
+            if (address == MAP_FAILED)
+            {
+                errno = error;
+                throw_errno("mmap");
+            }
+
+            return {address, size};
+        }
+    }
+
+    // A mapped shared memory segment
+    struct shm_mapping
+    {
+        shm_mapping(std::pair<void*, size_t> mapping)
+          : address{mapping.first}
+          , size{mapping.second}
+        {
+        }
+
+        shm_mapping(shm_mapping&& rhs) noexcept
+          : address{std::exchange(rhs.address, nullptr)}
+          , size{rhs.size}
+        {
+        }
+
+        ~shm_mapping()
+        {
+            if (address)
+                ::munmap(address, size);
+        }
+
+        void* address = nullptr;
+        size_t size = 0;
+    };
+
+    struct shm_state
+    {
+        shm_state(boost::asio::local::stream_protocol::socket socket, shm_mapping segment, bool client)
+          : doorbell{std::move(socket)}
+          , mapping{std::move(segment)}
+          , header{std::launder(static_cast<shm_header*>(mapping.address))}
+          , in{utility::spsc_ring::attach(
+                ring_memory(mapping.address, header->capacity, client ? 1 : 0), header->capacity, client)}
+          , out{utility::spsc_ring::attach(
+                ring_memory(mapping.address, header->capacity, client ? 0 : 1), header->capacity, client)}
+          , in_waiters{header->waiters[client ? 1 : 0]}
+          , out_waiters{header->waiters[client ? 0 : 1]}
+          , read_timer{doorbell.get_executor()}
+          , write_timer{doorbell.get_executor()}
+        {
+        }
+
+        boost::asio::local::stream_protocol::socket doorbell;
+        shm_mapping mapping;
+        shm_header* header;
+
+        utility::spsc_ring in;
+        utility::spsc_ring out;
+        shm_waiters& in_waiters;
+        shm_waiters& out_waiters;
+
+        // Never expire on their own; the doorbell makes them expire immediately
+        boost::asio::steady_timer read_timer;
+        boost::asio::steady_timer write_timer;
+
+        // Set once the doorbell broke, i.e. the other end went away
+        std::atomic<bool> closed = false;
+
+        // Set once this end has been closed
+        std::atomic<bool> closed_locally = false;
+    };
+
+    namespace
+    {
+        void ring(shm_state& state)
+        {
+            // If the socket buffer is full, the other end is going to wake up anyway
+            uint8_t bell = 0;
+            ::send(state.doorbell.native_handle(), &bell, 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+        }
+
+        // Marks the waiter as waiting. Must be followed by another attempt to read or write before actually waiting,
+        // as the other end might have made progress in the meantime
+        void prepare_wait(std::atomic<uint32_t>& waiting, boost::asio::steady_timer& timer)
+        {
+            timer.expires_at(std::chrono::steady_clock::time_point::max());
+            waiting.store(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+
+        // Returns whether either end has been closed or the other end went away, after which only the data that is
+        // still in the rings can be read
+        bool ended(shm_state const& state)
+        {
+            return state.closed || state.header->closed.load() != 0;
+        }
+
+        // Rings the doorbell if the given waiter on the other end is waiting
+        void wake(shm_state& state, std::atomic<uint32_t>& waiting)
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!waiting.load(std::memory_order_relaxed) || !waiting.exchange(0))
+                return;
+
+            ring(state);
+        }
+
+        awaitable<void> pump(std::shared_ptr<shm_state> state)
+        {
+            std::array<uint8_t, 64> buffer;
+            boost::system::error_code error;
+
+            while (!error)
+            {
+                co_await state->doorbell.async_read_some(
+                    boost::asio::buffer(buffer), redirect_error(use_awaitable, error));
+
+                if (error)
+                    state->closed = true;
+
+                state->read_timer.expires_at(std::chrono::steady_clock::time_point::min());
+                state->write_timer.expires_at(std::chrono::steady_clock::time_point::min());
+            }
+        }
+    }
+}
+
+namespace keycap::root::network
+{
+    shm_transport::shm_transport(std::shared_ptr<impl::shm_state> state)
+      : state_{std::move(state)}
+    {
+        boost::asio::co_spawn(state_->doorbell.get_executor(), impl::pump(state_), boost::asio::detached);
+    }
+
+    shm_transport::~shm_transport()
+    {
+        close();
+    }
+
+    awaitable<size_t> shm_transport::read_some(std::span<uint8_t> buffer)
+    {
+        auto& state = *state_;
+
+        while (true)
+        {
+            if (auto size = state.in.read(buffer); size != 0)
+            {
+                impl::wake(state, state.in_waiters.writer);
+                co_return size;
+            }
+
+            impl::prepare_wait(state.in_waiters.reader, state.read_timer);
+
+            if (auto size = state.in.read(buffer); size != 0)
+            {
+                state.in_waiters.reader.store(0, std::memory_order_relaxed);
+                impl::wake(state, state.in_waiters.writer);
+                co_return size;
+            }
+
+            // Data written before closing must still be received
+            if (impl::ended(state))
+                throw boost::system::system_error{boost::asio::error::eof};
+
+            boost::system::error_code error;
+            co_await state.read_timer.async_wait(redirect_error(use_awaitable, error));
+        }
+    }
+
+    awaitable<void> shm_transport::write(std::span<uint8_t const> data)
+    {
+        auto& state = *state_;
+
+        while (!data.empty())
+        {
+            if (impl::ended(state))
+                throw boost::system::system_error{boost::asio::error::broken_pipe};
+
+            if (auto size = state.out.write(data); size != 0)
+            {
+                data = data.subspan(size);
+                impl::wake(state, state.out_waiters.reader);
+                continue;
+            }
+
+            impl::prepare_wait(state.out_waiters.writer, state.write_timer);
+
+            if (auto size = state.out.write(data); size != 0)
+            {
+                state.out_waiters.writer.store(0, std::memory_order_relaxed);
+                data = data.subspan(size);
+                impl::wake(state, state.out_waiters.reader);
+                continue;
+            }
+
+            if (impl::ended(state))
+                throw boost::system::system_error{boost::asio::error::broken_pipe};
+
+            boost::system::error_code error;
+            co_await state.write_timer.async_wait(redirect_error(use_awaitable, error));
+        }
+    }
+
+    void shm_transport::close()
+    {
+        state_->closed_locally = true;
+
+        if (state_->header->closed.exchange(1) == 0)
+            impl::ring(*state_);
+
+        // Wakes up our own pump, which wakes up our own reader and writer
+        boost::system::error_code error;
+        state_->doorbell.shutdown(boost::asio::socket_base::shutdown_both, error);
+    }
+
+    bool shm_transport::is_open() const
+    {
+        // The other end closing or going away only ends the stream, which read_some reports once it has been drained
+        return !state_->closed_locally;
+    }
+
+    awaitable<std::unique_ptr<transport>> shm_transport::connect(
+        boost::asio::local::stream_protocol::socket doorbell, size_t capacity)
+    {
+        static std::atomic<uint32_t> counter = 0;
+
+        capacity = std::bit_ceil(std::max(capacity, impl::shm_min_capacity));
+        auto name = impl::shm_prefix + std::to_string(::getpid()) + "-" + std::to_string(counter++);
+
+        auto descriptor = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (descriptor == -1)
+            impl::throw_errno("shm_open");
+
+        // The name is only needed until the server mapped the segment as well
+        struct unlink_guard
+        {
+            ~unlink_guard()
+            {
+                ::shm_unlink(name.c_str());
+            }
+
+            std::string const& name;
+        } guard{name};
+
+        auto size = impl::segment_size(capacity);
+        if (::ftruncate(descriptor, static_cast<off_t>(size)) == -1)
+        {
+            ::close(descriptor);
+            impl::throw_errno("ftruncate");
+        }
+
+        impl::shm_mapping mapping{impl::map(descriptor, size)};
+        auto header = new (mapping.address) impl::shm_header{};
+        header->magic = impl::shm_magic;
+        header->capacity = capacity;
+
+        auto state = std::make_shared<impl::shm_state>(std::move(doorbell), std::move(mapping), true);
+
+        // The name is sent prefixed with its length, the server acknowledges it with a single byte
+        auto length = static_cast<uint8_t>(name.size());
+        co_await boost::asio::async_write(state->doorbell, boost::asio::buffer(&length, 1), use_awaitable);
+        co_await boost::asio::async_write(state->doorbell, boost::asio::buffer(name), use_awaitable);
+
+        uint8_t ack = 0;
+        co_await boost::asio::async_read(state->doorbell, boost::asio::buffer(&ack, 1), use_awaitable);
+
+        co_return std::unique_ptr<transport>{new shm_transport{std::move(state)}};
+    }
+
+    awaitable<std::unique_ptr<transport>> shm_transport::accept(boost::asio::local::stream_protocol::socket doorbell)
+    {
+        uint8_t length = 0;
+        co_await boost::asio::async_read(doorbell, boost::asio::buffer(&length, 1), use_awaitable);
+
+        std::string name(length, '\0');
+        co_await boost::asio::async_read(doorbell, boost::asio::buffer(name), use_awaitable);
+
+        if (!name.starts_with(impl::shm_prefix))
+            throw exception{"The client sent an invalid shared memory segment name!"};
+
+        auto descriptor = ::shm_open(name.c_str(), O_RDWR, 0);
+        if (descriptor == -1)
+            impl::throw_errno("shm_open");
+
+        struct stat status = {};
+        if (::fstat(descriptor, &status) == -1)
+        {
+            ::close(descriptor);
+            impl::throw_errno("fstat");
+        }
+
+        auto size = static_cast<size_t>(status.st_size);
+        if (size < sizeof(impl::shm_header))
+        {
+            ::close(descriptor);
+            throw exception{"The shared memory segment is too small!"};
+        }
+
+        impl::shm_mapping mapping{impl::map(descriptor, size)};
+
+        auto header = std::launder(static_cast<impl::shm_header*>(mapping.address));
+        if (header->magic != impl::shm_magic || !std::has_single_bit(header->capacity)
+            || header->capacity < impl::shm_min_capacity || impl::segment_size(header->capacity) != size)
+        {
+            throw exception{"The shared memory segment is invalid!"};
+        }
+
+        auto state = std::make_shared<impl::shm_state>(std::move(doorbell), std::move(mapping), false);
+
+        uint8_t ack = 1;
+        co_await boost::asio::async_write(state->doorbell, boost::asio::buffer(&ack, 1), use_awaitable);
+
+        co_return std::unique_ptr<transport>{new shm_transport{std::move(state)}};
+    }
+}
+
+#endif
@@ -0,0 +1,90 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/network/transport.hpp>
+
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/asio/write.hpp>
+
+using boost::asio::awaitable;
+using boost::asio::use_awaitable;
+
+namespace keycap::root::network
+{
+    tcp_transport::tcp_transport(boost::asio::ip::tcp::socket socket)
+      : socket_{std::move(socket)}
+    {
+    }
+
+    awaitable<size_t> tcp_transport::read_some(std::span<uint8_t> buffer)
+    {
+        co_return co_await socket_.async_read_some(boost::asio::buffer(buffer.data(), buffer.size()), use_awaitable);
+    }
+
+    awaitable<void> tcp_transport::write(std::span<uint8_t const> data)
+    {
+        co_await boost::asio::async_write(socket_, boost::asio::buffer(data.data(), data.size()), use_awaitable);
+    }
+
+    void tcp_transport::close()
+    {
+        boost::system::error_code error;
+        socket_.close(error);
+    }
+
+    bool tcp_transport::is_open() const
+    {
+        return socket_.is_open();
+    }
+
+    boost::asio::ip::tcp::socket& tcp_transport::socket()
+    {
+        return socket_;
+    }
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    unix_transport::unix_transport(boost::asio::local::stream_protocol::socket socket)
+      : socket_{std::move(socket)}
+    {
+    }
+
+    awaitable<size_t> unix_transport::read_some(std::span<uint8_t> buffer)
+    {
+        co_return co_await socket_.async_read_some(boost::asio::buffer(buffer.data(), buffer.size()), use_awaitable);
+    }
+
+    awaitable<void> unix_transport::write(std::span<uint8_t const> data)
+    {
+        co_await boost::asio::async_write(socket_, boost::asio::buffer(data.data(), data.size()), use_awaitable);
+    }
+
+    void unix_transport::close()
+    {
+        boost::system::error_code error;
+        socket_.close(error);
+    }
+
+    bool unix_transport::is_open() const
+    {
+        return socket_.is_open();
+    }
+
+    boost::asio::local::stream_protocol::socket& unix_transport::socket()
+    {
+        return socket_;
+    }
+#endif
+}
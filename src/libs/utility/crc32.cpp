@@ -17,26 +17,346 @@
 #include <keycap/root/network/memory_stream.hpp>
 #include <keycap/root/utility/crc32.hpp>
 
+#include <zlib.h>
+
+#include <array>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define KEYCAP_ROOT_CRC32_X86_64
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define KEYCAP_ROOT_TARGET(features)
+#else
+#define KEYCAP_ROOT_TARGET(features) __attribute__((target(features)))
+#endif
+#endif
+
 namespace keycap::root::utility
 {
     namespace impl
     {
         template <>
-        void hash<network::memory_stream>(boost::crc_32_type& crc, network::memory_stream const& stream)
+        void hash<network::memory_stream>(checksum_state& crc, network::memory_stream const& stream)
         {
             crc.process_bytes(stream.data(), stream.size());
         }
 
         template <>
-        void hash<std::string>(boost::crc_32_type& crc, std::string const& str)
+        void hash<std::string>(checksum_state& crc, std::string const& str)
         {
             crc.process_bytes(str.data(), str.size());
         }
 
         template <>
-        void hash<std::array<uint8, 256>>(boost::crc_32_type& crc, std::array<uint8, 256> const& ar)
+        void hash<std::array<uint8, 256>>(checksum_state& crc, std::array<uint8, 256> const& ar)
         {
             crc.process_bytes(ar.data(), 256);
         }
     }
+
+    namespace
+    {
+        using crc_function = uint32 (*)(uint32 crc, uint8 const* data, size_t size);
+
+        // zlib's crc32_z takes at most uInt bytes at once on some platforms
+        uint32 crc32_software(uint32 crc, uint8 const* data, size_t size)
+        {
+            constexpr size_t max_chunk = std::numeric_limits<uInt>::max();
+
+            while (size > 0)
+            {
+                auto chunk = std::min(size, max_chunk);
+                crc = static_cast<uint32>(::crc32_z(crc, data, chunk));
+                data += chunk;
+                size -= chunk;
+            }
+
+            return crc;
+        }
+
+        // Slicing-by-8 tables for the reflected Castagnoli polynomial
+        constexpr auto make_crc32c_tables()
+        {
+            constexpr uint32 polynomial = 0x82F63B78;
+            std::array<std::array<uint32, 256>, 8> tables{};
+
+            for (uint32 i = 0; i < 256; ++i)
+            {
+                uint32 crc = i;
+                for (int bit = 0; bit < 8; ++bit)
+                    crc = (crc >> 1) ^ ((crc & 1) ? polynomial : 0);
+
+                tables[0][i] = crc;
+            }
+
+            for (uint32 i = 0; i < 256; ++i)
+            {
+                for (size_t t = 1; t < tables.size(); ++t)
+                    tables[t][i] = (tables[t - 1][i] >> 8) ^ tables[0][tables[t - 1][i] & 0xFF];
+            }
+
+            return tables;
+        }
+
+        constexpr auto crc32c_tables = make_crc32c_tables();
+
+        uint32 crc32c_software(uint32 crc, uint8 const* data, size_t size)
+        {
+            crc = ~crc;
+
+            while (size >= 8)
+            {
+                uint32 low;
+                uint32 high;
+                std::memcpy(&low, data, sizeof(low));
+                std::memcpy(&high, data + 4, sizeof(high));
+                low ^= crc;
+
+                crc = crc32c_tables[7][low & 0xFF] ^ crc32c_tables[6][(low >> 8) & 0xFF]
+                    ^ crc32c_tables[5][(low >> 16) & 0xFF] ^ crc32c_tables[4][low >> 24]
+                    ^ crc32c_tables[3][high & 0xFF] ^ crc32c_tables[2][(high >> 8) & 0xFF]
+                    ^ crc32c_tables[1][(high >> 16) & 0xFF] ^ crc32c_tables[0][high >> 24];
+
+                data += 8;
+                size -= 8;
+            }
+
+            while (size-- > 0)
+                crc = (crc >> 8) ^ crc32c_tables[0][(crc ^ *data++) & 0xFF];
+
+            return ~crc;
+        }
+
+#ifdef KEYCAP_ROOT_CRC32_X86_64
+        struct cpu_features
+        {
+            bool sse42 = false;
+            bool pclmul = false;
+        };
+
+        cpu_features detect_cpu_features()
+        {
+            cpu_features features;
+#ifdef _MSC_VER
+            int info[4]{};
+            __cpuid(info, 1);
+            features.sse42 = (info[2] & (1 << 20)) != 0;
+            features.pclmul = (info[2] & (1 << 1)) != 0;
+#else
+            __builtin_cpu_init();
+            features.sse42 = __builtin_cpu_supports("sse4.2");
+            features.pclmul = __builtin_cpu_supports("pclmul");
+#endif
+            return features;
+        }
+
+        KEYCAP_ROOT_TARGET("sse4.2")
+        uint32 crc32c_sse42(uint32 crc, uint8 const* data, size_t size)
+        {
+            uint64 value = ~crc;
+
+            while (size >= 8)
+            {
+                uint64 chunk;
+                std::memcpy(&chunk, data, sizeof(chunk));
+                value = _mm_crc32_u64(value, chunk);
+                data += 8;
+                size -= 8;
+            }
+
+            auto value32 = static_cast<uint32>(value);
+            while (size-- > 0)
+                value32 = _mm_crc32_u8(value32, *data++);
+
+            return ~value32;
+        }
+
+        __m128i load(uint8 const* ptr)
+        {
+            return _mm_loadu_si128(reinterpret_cast<__m128i const*>(ptr));
+        }
+
+        // Multiplies both halves of value with the given constants and adds next
+        KEYCAP_ROOT_TARGET("pclmul")
+        __m128i fold(__m128i value, __m128i constants, __m128i next)
+        {
+            auto low = _mm_clmulepi64_si128(value, constants, 0x00);
+            auto high = _mm_clmulepi64_si128(value, constants, 0x11);
+            return _mm_xor_si128(_mm_xor_si128(high, low), next);
+        }
+
+        // Folds the given data into the (non-inverted) CRC-32 register using carry-less multiplication as described
+        // in Intel's "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction".
+        // size must be at least 64 and a multiple of 16
+        KEYCAP_ROOT_TARGET("sse4.1,pclmul")
+        uint32 crc32_fold_pclmul(uint32 crc, uint8 const* data, size_t size)
+        {
+            alignas(16) static constexpr uint64 k1k2[] = {0x0154442bd4, 0x01c6e41596};
+            alignas(16) static constexpr uint64 k3k4[] = {0x01751997d0, 0x00ccaa009e};
+            alignas(16) static constexpr uint64 k5k0[] = {0x0163cd6124, 0x0000000000};
+            alignas(16) static constexpr uint64 poly[] = {0x01db710641, 0x01f7011641};
+
+            auto x1 = _mm_xor_si128(load(data), _mm_cvtsi32_si128(static_cast<int>(crc)));
+            auto x2 = load(data + 0x10);
+            auto x3 = load(data + 0x20);
+            auto x4 = load(data + 0x30);
+            data += 64;
+            size -= 64;
+
+            // Fold four 128 bit lanes in parallel
+            auto k = _mm_load_si128(reinterpret_cast<__m128i const*>(k1k2));
+            while (size >= 64)
+            {
+                x1 = fold(x1, k, load(data));
+                x2 = fold(x2, k, load(data + 0x10));
+                x3 = fold(x3, k, load(data + 0x20));
+                x4 = fold(x4, k, load(data + 0x30));
+                data += 64;
+                size -= 64;
+            }
+
+            // Fold the lanes into a single one
+            k = _mm_load_si128(reinterpret_cast<__m128i const*>(k3k4));
+            x1 = fold(x1, k, x2);
+            x1 = fold(x1, k, x3);
+            x1 = fold(x1, k, x4);
+
+            while (size >= 16)
+            {
+                x1 = fold(x1, k, load(data));
+                data += 16;
+                size -= 16;
+            }
+
+            // Reduce 128 bits to 64 bits
+            auto mask = _mm_setr_epi32(~0, 0, ~0, 0);
+            x2 = _mm_clmulepi64_si128(x1, k, 0x10);
+            x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+            k = _mm_loadl_epi64(reinterpret_cast<__m128i const*>(k5k0));
+            x2 = _mm_srli_si128(x1, 4);
+            x1 = _mm_and_si128(x1, mask);
+            x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k, 0x00), x2);
+
+            // Barrett reduction to 32 bits
+            k = _mm_load_si128(reinterpret_cast<__m128i const*>(poly));
+            x2 = _mm_and_si128(x1, mask);
+            x2 = _mm_clmulepi64_si128(x2, k, 0x10);
+            x2 = _mm_and_si128(x2, mask);
+            x2 = _mm_clmulepi64_si128(x2, k, 0x00);
+            x1 = _mm_xor_si128(x1, x2);
+
+            return static_cast<uint32>(_mm_extract_epi32(x1, 1));
+        }
+
+        uint32 crc32_pclmul(uint32 crc, uint8 const* data, size_t size)
+        {
+            constexpr size_t minimum_size = 64;
+
+            if (size >= minimum_size)
+            {
+                auto folded = size & ~size_t{15};
+                crc = ~crc32_fold_pclmul(~crc, data, folded);
+                data += folded;
+                size -= folded;
+            }
+
+            return crc32_software(crc, data, size);
+        }
+#endif
+
+        // Returns a * b modulo the given reflected polynomial
+        constexpr uint32 multiply_modulo(uint32 a, uint32 b, uint32 polynomial)
+        {
+            uint32 mask = uint32{1} << 31;
+            uint32 product = 0;
+
+            while (mask != 0)
+            {
+                if (a & mask)
+                    product ^= b;
+
+                mask >>= 1;
+                b = (b & 1) ? (b >> 1) ^ polynomial : b >> 1;
+            }
+
+            return product;
+        }
+
+        // x^(2^n) modulo the given reflected polynomial for n = 0..31
+        constexpr auto make_power_table(uint32 polynomial)
+        {
+            std::array<uint32, 32> table{};
+            uint32 power = uint32{1} << 30; // x^1
+
+            for (auto& entry : table)
+            {
+                entry = power;
+                power = multiply_modulo(power, power, polynomial);
+            }
+
+            return table;
+        }
+
+        constexpr auto crc32_powers = make_power_table(0xEDB88320);
+        constexpr auto crc32c_powers = make_power_table(0x82F63B78);
+
+        // Shifts crc1 by size2 zero bytes and adds crc2, see zlib's crc32_combine
+        uint32 combine(uint32 crc1, uint32 crc2, uint64 size2, uint32 polynomial, std::array<uint32, 32> const& powers)
+        {
+            uint32 shift = uint32{1} << 31; // x^0
+            size_t power = 3;               // a byte is x^8 = x^(2^3)
+
+            for (; size2 != 0; size2 >>= 1, ++power)
+            {
+                if (size2 & 1)
+                    shift = multiply_modulo(powers[power & 31], shift, polynomial);
+            }
+
+            return multiply_modulo(shift, crc1, polynomial) ^ crc2;
+        }
+
+        crc_function select_crc32()
+        {
+#ifdef KEYCAP_ROOT_CRC32_X86_64
+            if (auto features = detect_cpu_features(); features.pclmul && features.sse42)
+                return &crc32_pclmul;
+#endif
+            return &crc32_software;
+        }
+
+        crc_function select_crc32c()
+        {
+#ifdef KEYCAP_ROOT_CRC32_X86_64
+            if (detect_cpu_features().sse42)
+                return &crc32c_sse42;
+#endif
+            return &crc32c_software;
+        }
+    }
+
+    uint32 crc32_update(uint32 crc, void const* data, size_t size)
+    {
+        static crc_function const implementation = select_crc32();
+        return implementation(crc, static_cast<uint8 const*>(data), size);
+    }
+
+    uint32 crc32c_update(uint32 crc, void const* data, size_t size)
+    {
+        static crc_function const implementation = select_crc32c();
+        return implementation(crc, static_cast<uint8 const*>(data), size);
+    }
+
+    uint32 crc32_combine(uint32 crc1, uint32 crc2, uint64 size2)
+    {
+        return combine(crc1, crc2, size2, 0xEDB88320, crc32_powers);
+    }
+
+    uint32 crc32c_combine(uint32 crc1, uint32 crc2, uint64 size2)
+    {
+        return combine(crc1, crc2, size2, 0x82F63B78, crc32c_powers);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,171 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/utility/hdr_histogram.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace keycap::root::utility
+{
+    hdr_histogram::hdr_histogram(uint64 highest_trackable, int significant_digits)
+      : highest_trackable_{std::max<uint64>(highest_trackable, 2)}
+      , significant_digits_{significant_digits}
+    {
+        if (significant_digits < 1 || significant_digits > 5)
+            throw std::invalid_argument{"hdr_histogram supports 1 to 5 significant digits"};
+
+        // Every value below this one must be counted in a sub bucket of its own
+        uint64 largest_with_single_unit_resolution = 2;
+        for (int i = 0; i < significant_digits; ++i)
+            largest_with_single_unit_resolution *= 10;
+
+        auto sub_bucket_count_magnitude = static_cast<int>(std::bit_width(largest_with_single_unit_resolution - 1));
+        sub_bucket_half_count_magnitude_ = std::max(sub_bucket_count_magnitude, 1) - 1;
+        sub_bucket_count_ = size_t{1} << (sub_bucket_half_count_magnitude_ + 1);
+        sub_bucket_half_count_ = sub_bucket_count_ / 2;
+        sub_bucket_mask_ = sub_bucket_count_ - 1;
+
+        size_t bucket_count = 1;
+        for (uint64 smallest_untrackable = sub_bucket_count_; smallest_untrackable <= highest_trackable_;
+             smallest_untrackable <<= 1)
+        {
+            ++bucket_count;
+            if (smallest_untrackable > UINT64_MAX / 2)
+                break;
+        }
+
+        counts_length_ = (bucket_count + 1) * sub_bucket_half_count_;
+        counts_ = std::make_unique<std::atomic<uint64>[]>(counts_length_);
+    }
+
+    void hdr_histogram::merge(hdr_histogram const& other) noexcept
+    {
+        uint64 merged = 0;
+        for (size_t i = 0; i < other.counts_length_; ++i)
+        {
+            auto count = other.counts_[i].load(std::memory_order_relaxed);
+            if (count == 0)
+                continue;
+
+            auto value = std::min(other.value_at_index(i), highest_trackable_);
+            counts_[index_of(value)].fetch_add(count, std::memory_order_relaxed);
+            merged += count;
+        }
+
+        if (merged == 0)
+            return;
+
+        total_count_.fetch_add(merged, std::memory_order_relaxed);
+        total_sum_.fetch_add(other.sum(), std::memory_order_relaxed);
+        update_min(std::min(other.min(), highest_trackable_));
+        update_max(std::min(other.max(), highest_trackable_));
+    }
+
+    void hdr_histogram::reset() noexcept
+    {
+        for (size_t i = 0; i < counts_length_; ++i)
+            counts_[i].store(0, std::memory_order_relaxed);
+
+        total_count_.store(0, std::memory_order_relaxed);
+        total_sum_.store(0, std::memory_order_relaxed);
+        min_.store(UINT64_MAX, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+    uint64 hdr_histogram::min() const noexcept
+    {
+        auto min = min_.load(std::memory_order_relaxed);
+        return min == UINT64_MAX ? 0 : min;
+    }
+
+    uint64 hdr_histogram::max() const noexcept
+    {
+        return max_.load(std::memory_order_relaxed);
+    }
+
+    double hdr_histogram::mean() const noexcept
+    {
+        auto total = count();
+        if (total == 0)
+            return 0.0;
+
+        return static_cast<double>(sum()) / static_cast<double>(total);
+    }
+
+    uint64 hdr_histogram::value_at_percentile(double percentile) const noexcept
+    {
+        auto total = count();
+        if (total == 0)
+            return 0;
+
+        percentile = std::clamp(percentile, 0.0, 100.0);
+        auto rank = static_cast<uint64>(percentile / 100.0 * static_cast<double>(total) + 0.5);
+        rank = std::max<uint64>(rank, 1);
+
+        uint64 seen = 0;
+        for (size_t i = 0; i < counts_length_; ++i)
+        {
+            seen += counts_[i].load(std::memory_order_relaxed);
+            if (seen >= rank)
+                return std::min(highest_equivalent(value_at_index(i)), max());
+        }
+
+        // Values recorded concurrently may not have shown up in the counts yet
+        return max();
+    }
+
+    bool hdr_histogram::equivalent(uint64 lhs, uint64 rhs) const noexcept
+    {
+        return lowest_equivalent(lhs) == lowest_equivalent(rhs);
+    }
+
+    void hdr_histogram::for_each(std::function<void(uint64 value, uint64 count)> const& callback) const
+    {
+        for (size_t i = 0; i < counts_length_; ++i)
+        {
+            if (auto count = counts_[i].load(std::memory_order_relaxed); count != 0)
+                callback(highest_equivalent(value_at_index(i)), count);
+        }
+    }
+
+    uint64 hdr_histogram::value_at_index(size_t index) const noexcept
+    {
+        auto bucket = static_cast<int>(index >> sub_bucket_half_count_magnitude_) - 1;
+        auto sub_bucket = (index & (sub_bucket_half_count_ - 1)) + sub_bucket_half_count_;
+
+        if (bucket < 0)
+        {
+            sub_bucket -= sub_bucket_half_count_;
+            bucket = 0;
+        }
+
+        return sub_bucket << bucket;
+    }
+
+    uint64 hdr_histogram::lowest_equivalent(uint64 value) const noexcept
+    {
+        auto bucket = bucket_index(value);
+        return (value >> bucket) << bucket;
+    }
+
+    uint64 hdr_histogram::highest_equivalent(uint64 value) const noexcept
+    {
+        auto bucket = bucket_index(value);
+        return lowest_equivalent(value) + (uint64{1} << bucket) - 1;
+    }
+}
@@ -0,0 +1,246 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/compression/codec.hpp>
+
+#include <rapidcheck/catch.h>
+
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace keycap::root::compression;
+
+namespace
+{
+    std::vector<codec_type> supported_codecs()
+    {
+        std::vector<codec_type> codecs;
+        for (auto type : {codec_type::None, codec_type::Zlib, codec_type::Lz4, codec_type::Zstd})
+        {
+            if (is_supported(type))
+                codecs.push_back(type);
+        }
+
+        return codecs;
+    }
+}
+
+TEST_CASE("Compression codecs")
+{
+    std::string input;
+    for (int i = 0; i < 1000; ++i)
+        input += "<player id=\"" + std::to_string(i) + "\" zone=\"" + std::to_string(i % 7) + "\"/>\n";
+
+    SECTION("None and Zlib must always be supported")
+    {
+        REQUIRE(is_supported(codec_type::None));
+        REQUIRE(is_supported(codec_type::Zlib));
+        REQUIRE(make_codec(codec_type::Zlib));
+    }
+
+    SECTION("Unsupported codecs must not be created")
+    {
+        REQUIRE_FALSE(is_supported(static_cast<codec_type>(42)));
+        REQUIRE_FALSE(make_codec(static_cast<codec_type>(42)));
+    }
+
+    SECTION("Every codec must decompress what it compressed")
+    {
+        for (auto type : supported_codecs())
+        {
+            auto codec = make_codec(type);
+            REQUIRE(codec->type() == type);
+
+            std::vector<uint8_t> compressed(codec->bound(input.size()));
+            auto size = codec->compress(std::span(reinterpret_cast<uint8_t const*>(input.data()), input.size()),
+                                        compressed);
+            REQUIRE(size);
+
+            std::vector<uint8_t> output(input.size());
+            REQUIRE(codec->decompress(std::span(compressed).first(*size), output) == input.size());
+            REQUIRE(std::string(output.begin(), output.end()) == input);
+        }
+    }
+
+    SECTION("Frames must be decompressed using the codec given by their header")
+    {
+        for (auto type : supported_codecs())
+        {
+            auto frame = compress(*make_codec(type), input.begin(), input.end());
+
+            auto header = read_frame_header(frame);
+            REQUIRE(header);
+            REQUIRE(header->codec == type);
+            REQUIRE(header->uncompressed_size == input.size());
+
+            auto output = decompress(frame.begin(), frame.end());
+            REQUIRE(std::string(output.begin(), output.end()) == input);
+        }
+    }
+
+    SECTION("Levels must be clamped to the range of the codec")
+    {
+        REQUIRE(make_codec(codec_type::Zlib, 42)->level() == 9);
+        REQUIRE(make_codec(codec_type::Zlib, -42)->level() == 0);
+        REQUIRE(make_codec(codec_type::Zlib)->level() == default_level(codec_type::Zlib));
+    }
+
+    SECTION("Compressing with the zlib codec must yield the zlib format at every level")
+    {
+        for (int level = 0; level <= 9; ++level)
+        {
+            auto frame = compress(*make_codec(codec_type::Zlib, level), input.begin(), input.end());
+            auto output = decompress(frame.begin(), frame.end());
+
+            REQUIRE(std::string(output.begin(), output.end()) == input);
+        }
+    }
+
+    SECTION("Data that can't be compressed must be stored uncompressed")
+    {
+        std::vector<uint8_t> data{0x42, 0x13, 0x37};
+
+        auto frame = compress(*make_codec(codec_type::Zlib), data.begin(), data.end());
+
+        REQUIRE(read_frame_header(frame)->codec == codec_type::None);
+        REQUIRE(frame.size() == read_frame_header(frame)->size + data.size());
+        REQUIRE(decompress(frame.begin(), frame.end()) == data);
+    }
+
+    SECTION("Malformed frames must yield nothing")
+    {
+        auto frame = compress(*make_codec(codec_type::Zlib), input.begin(), input.end());
+
+        auto truncated = frame;
+        truncated.resize(truncated.size() / 2);
+        REQUIRE(decompress(truncated.begin(), truncated.end()).empty());
+
+        auto unknown = frame;
+        unknown[0] = 42;
+        REQUIRE(decompress(unknown.begin(), unknown.end()).empty());
+
+        std::vector<uint8_t> incomplete_header{static_cast<uint8_t>(codec_type::Zlib), 0x80};
+        REQUIRE_FALSE(read_frame_header(incomplete_header));
+    }
+
+    SECTION("Frames claiming more data than their payload can hold must yield nothing")
+    {
+        // Zlib, 2^56 bytes as varint and 4 bytes of payload
+        std::vector<uint8_t> oversized{static_cast<uint8_t>(codec_type::Zlib), 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+                                       0x80, 0x01, 1, 2, 3, 4};
+
+        REQUIRE(read_frame_header(oversized)->uncompressed_size == uint64_t{1} << 56);
+        REQUIRE(decompress(oversized).empty());
+        REQUIRE(decompress(*make_codec(codec_type::Zlib), oversized).empty());
+
+        // 2^33 bytes are below the default maximum on 64 bit platforms, but can't fit into 4 bytes of payload either
+        std::vector<uint8_t> large{static_cast<uint8_t>(codec_type::Zlib), 0x80, 0x80, 0x80, 0x80, 0x20, 1, 2, 3, 4};
+        REQUIRE(read_frame_header(large)->uncompressed_size == uint64_t{1} << 33);
+        REQUIRE(decompress(large).empty());
+    }
+
+    SECTION("Frames exceeding the maximum size must yield nothing")
+    {
+        auto frame = compress(*make_codec(codec_type::Zlib), input.begin(), input.end());
+        std::vector<uint8_t> expected(input.begin(), input.end());
+
+        REQUIRE(decompress(frame, input.size() - 1).empty());
+        REQUIRE(decompress(frame, input.size()) == expected);
+    }
+
+    SECTION("Frame headers must hold 64 bit sizes")
+    {
+        std::vector<uint8_t> header{static_cast<uint8_t>(codec_type::Zstd), 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                    0xFF, 0xFF, 0x01};
+
+        REQUIRE(read_frame_header(header)->uncompressed_size == std::numeric_limits<uint64_t>::max());
+        REQUIRE(read_frame_header(header)->size == header.size());
+    }
+
+    rc::prop("Frames of arbitrary data must be decompressed to the input", [](std::vector<uint8_t> data) {
+        auto frame = compress(*make_codec(codec_type::Zlib), data.begin(), data.end());
+
+        REQUIRE(decompress(frame.begin(), frame.end()) == data);
+    });
+}
+
+TEST_CASE("Compression blocks")
+{
+    std::vector<uint8_t> input;
+    for (int i = 0; input.size() < 1000000; ++i)
+    {
+        auto line = "<player id=\"" + std::to_string(i) + "\" zone=\"" + std::to_string(i % 7) + "\"/>\n";
+        input.insert(input.end(), line.begin(), line.end());
+    }
+
+    SECTION("Every codec must decompress the blocks it compressed")
+    {
+        for (auto type : supported_codecs())
+        {
+            auto data = compress_blocks(*make_codec(type), input, 4, 64 * 1024);
+
+            REQUIRE(decompress_blocks(data, 4) == input);
+            REQUIRE(decompress_blocks(data, 1) == input);
+        }
+    }
+
+    SECTION("The result must not depend on the number of threads")
+    {
+        auto codec = make_codec(codec_type::Zlib);
+
+        REQUIRE(compress_blocks(*codec, input, 1, 64 * 1024) == compress_blocks(*codec, input, 8, 64 * 1024));
+    }
+
+    SECTION("Empty inputs must yield no blocks")
+    {
+        auto data = compress_blocks(*make_codec(codec_type::Zlib), {});
+
+        REQUIRE(data == std::vector<uint8_t>{0});
+        REQUIRE(decompress_blocks(data).empty());
+    }
+
+    SECTION("Malformed blocks must yield nothing")
+    {
+        auto data = compress_blocks(*make_codec(codec_type::Zlib), input, 4, 64 * 1024);
+
+        auto truncated = data;
+        truncated.pop_back();
+        REQUIRE(decompress_blocks(truncated).empty());
+
+        auto trailing = data;
+        trailing.push_back(0);
+        REQUIRE(decompress_blocks(trailing).empty());
+
+        auto corrupted = data;
+        corrupted[corrupted.size() / 2] ^= 0xFF;
+        REQUIRE(decompress_blocks(corrupted).empty());
+
+        REQUIRE(decompress_blocks(std::vector<uint8_t>{0xFF, 0xFF, 0xFF, 0x7F}).empty());
+    }
+
+    SECTION("Blocks claiming more data than they can hold must yield nothing")
+    {
+        // A single block of 10 bytes: Zlib, 2^33 bytes as varint and 4 bytes of payload
+        std::vector<uint8_t> oversized{1, 10, static_cast<uint8_t>(codec_type::Zlib), 0x80, 0x80, 0x80, 0x80, 0x20,
+                                       1,  2,  3,  4};
+        REQUIRE(decompress_blocks(oversized).empty());
+
+        auto data = compress_blocks(*make_codec(codec_type::Zlib), input, 4, 64 * 1024);
+        REQUIRE(decompress_blocks(data, 4, input.size() - 1).empty());
+        REQUIRE(decompress_blocks(data, 4, input.size()) == input);
+    }
+}
@@ -0,0 +1,165 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/compression/codec.hpp>
+#include <keycap/root/compression/dictionary.hpp>
+#include <keycap/root/compression/zip.hpp>
+#include <keycap/root/network/memory_stream.hpp>
+
+#include <rapidcheck/catch.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace keycap::root::compression;
+namespace net = keycap::root::network;
+
+namespace
+{
+    // Small messages as typically sent between services: a few fields with varying values
+    std::vector<net::memory_stream> make_samples(size_t count)
+    {
+        std::vector<net::memory_stream> samples;
+        for (size_t i = 0; i < count; ++i)
+        {
+            net::memory_stream stream;
+            stream.put<uint32_t>(0x1234);
+            stream.put(std::string{"character_update name=\"Player"} + std::to_string(i % 50) + "\" zone=\""
+                       + std::to_string(i % 7) + "\" level=" + std::to_string(i % 80) + " online=1");
+            samples.push_back(std::move(stream));
+        }
+
+        return samples;
+    }
+
+    std::vector<uint8_t> to_vector(net::memory_stream stream)
+    {
+        return stream.to_vector();
+    }
+}
+
+TEST_CASE("Compression dictionaries")
+{
+    auto samples = make_samples(1000);
+    auto message = to_vector(make_samples(1001).back());
+
+    SECTION("Trained dictionaries must not exceed the maximum size")
+    {
+        auto trained = train_dictionary(samples, 4096);
+
+        REQUIRE_FALSE(trained.content().empty());
+        REQUIRE(trained.content().size() <= 4096);
+    }
+
+    SECTION("Dictionaries built from few samples must consist of the samples, the most frequent last")
+    {
+        std::vector<uint8_t> rare{'a', 'b'};
+        std::vector<uint8_t> frequent{'c', 'd'};
+        std::vector<std::span<uint8_t const>> few{rare, frequent, frequent};
+
+        auto built = train_dictionary(few, 16);
+        REQUIRE(std::vector<uint8_t>(built.content().begin(), built.content().end())
+                == std::vector<uint8_t>{'a', 'b', 'c', 'd'});
+
+        auto truncated = train_dictionary(few, 3);
+        REQUIRE(std::vector<uint8_t>(truncated.content().begin(), truncated.content().end())
+                == std::vector<uint8_t>{'b', 'c', 'd'});
+    }
+
+    SECTION("The id of a dictionary must be the adler32 checksum of its content")
+    {
+        REQUIRE(dictionary{std::vector<uint8_t>{'a', 'b', 'c'}}.id() == 0x024d0127);
+    }
+
+    SECTION("Small messages must compress better with a trained dictionary")
+    {
+        auto trained = std::make_shared<dictionary const>(train_dictionary(samples));
+
+        for (auto type : {codec_type::Zlib, codec_type::Zstd})
+        {
+            if (!is_supported(type))
+                continue;
+
+            auto plain = make_codec(type);
+            auto primed = make_codec(type, trained);
+            REQUIRE(primed);
+
+            auto without = compress(*plain, message);
+            auto with = compress(*primed, message);
+            REQUIRE(with.size() < without.size());
+            REQUIRE(with.size() < message.size() / 2);
+
+            REQUIRE(decompress(*primed, with) == message);
+        }
+    }
+
+    SECTION("Frames compressed with a dictionary must not decompress without it")
+    {
+        auto trained = std::make_shared<dictionary const>(train_dictionary(samples));
+        auto frame = compress(*make_codec(codec_type::Zlib, trained), message);
+
+        REQUIRE(decompress(frame).empty());
+        REQUIRE(decompress(*make_codec(codec_type::Zlib), frame).empty());
+    }
+
+    SECTION("Blocks compressed with a dictionary must be decompressed using it")
+    {
+        auto trained = std::make_shared<dictionary const>(train_dictionary(samples));
+
+        std::vector<uint8_t> input;
+        for (auto& sample : make_samples(200))
+        {
+            auto data = to_vector(std::move(sample));
+            input.insert(input.end(), data.begin(), data.end());
+        }
+
+        for (auto type : {codec_type::Zlib, codec_type::Zstd})
+        {
+            if (!is_supported(type))
+                continue;
+
+            auto primed = make_codec(type, trained);
+            auto blocks = compress_blocks(*primed, input, 4, 256);
+
+            REQUIRE(decompress_blocks(*primed, blocks, 4) == input);
+            REQUIRE(decompress_blocks(blocks).empty());
+            REQUIRE(decompress_blocks(*make_codec(type), blocks).empty());
+        }
+    }
+
+    SECTION("Codecs without dictionary support must not be created")
+    {
+        auto trained = std::make_shared<dictionary const>(train_dictionary(samples));
+
+        REQUIRE_FALSE(make_codec(codec_type::Lz4, trained));
+    }
+
+    SECTION("zip must compress with preset dictionaries")
+    {
+        auto trained = train_dictionary(samples);
+
+        std::vector<uint8_t> compressed(zip::compress_bound(message.size()) + 4);
+        auto size = zip::compress_into(message, compressed, 8, trained.content());
+        REQUIRE(size);
+        compressed.resize(*size);
+
+        std::vector<uint8_t> output(message.size());
+        REQUIRE_FALSE(zip::decompress_into(compressed, output));
+        REQUIRE(zip::decompress_into(compressed, output, trained.content()) == message.size());
+        REQUIRE(output == message);
+    }
+}
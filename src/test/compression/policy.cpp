@@ -0,0 +1,144 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/compression/policy.hpp>
+
+#include <rapidcheck/catch.h>
+
+#include <random>
+#include <vector>
+
+using namespace keycap::root::compression;
+
+namespace
+{
+    std::vector<uint8_t> repetitive_data(size_t size)
+    {
+        std::vector<uint8_t> data(size);
+        for (size_t i = 0; i < size; ++i)
+            data[i] = static_cast<uint8_t>("Foobar"[i % 6]);
+
+        return data;
+    }
+
+    std::vector<uint8_t> make_random_bytes(size_t size)
+    {
+        std::mt19937 engine{42};
+        std::uniform_int_distribution<int> distribution{0, 255};
+
+        std::vector<uint8_t> data(size);
+        for (auto& byte : data)
+            byte = static_cast<uint8_t>(distribution(engine));
+
+        return data;
+    }
+}
+
+TEST_CASE("Compression policy")
+{
+    std::shared_ptr<codec const> zlib = make_codec(codec_type::Zlib);
+
+    SECTION("The entropy of constant data must be 0 and of uniformly distributed bytes 8 bits")
+    {
+        REQUIRE(estimate_entropy(std::vector<uint8_t>(100, 7)) == 0.0);
+
+        std::vector<uint8_t> all(256);
+        for (size_t i = 0; i < all.size(); ++i)
+            all[i] = static_cast<uint8_t>(i);
+
+        REQUIRE(estimate_entropy(all) == Approx(8.0));
+        REQUIRE(estimate_entropy(make_random_bytes(64 * 1024)) > 7.9);
+    }
+
+    SECTION("Small inputs must be stored uncompressed")
+    {
+        compression_policy policy{zlib};
+        auto input = repetitive_data(64);
+
+        auto frame = policy.compress(input);
+        REQUIRE(read_frame_header(frame)->codec == codec_type::None);
+        REQUIRE(decompress(frame) == input);
+        REQUIRE(policy.statistics().skipped_small == 1);
+        REQUIRE(policy.statistics().compressed == 0);
+    }
+
+    SECTION("Incompressible inputs must be stored uncompressed without compressing them")
+    {
+        compression_policy policy{zlib};
+        auto input = make_random_bytes(16 * 1024);
+
+        REQUIRE_FALSE(policy.should_compress(input));
+
+        auto frame = policy.compress(input);
+        REQUIRE(read_frame_header(frame)->codec == codec_type::None);
+        REQUIRE(decompress(frame) == input);
+        REQUIRE(policy.statistics().skipped_entropy == 1);
+    }
+
+    SECTION("Small incompressible inputs must be detected despite their lower entropy estimate")
+    {
+        compression_policy policy{zlib};
+
+        for (size_t size : {128, 200, 256, 300, 500})
+        {
+            REQUIRE_FALSE(policy.should_compress(make_random_bytes(size)));
+            REQUIRE(policy.should_compress(repetitive_data(size)));
+        }
+    }
+
+    SECTION("Compressible inputs must be compressed and counted")
+    {
+        compression_policy policy{zlib};
+        auto input = repetitive_data(16 * 1024);
+
+        REQUIRE(policy.should_compress(input));
+
+        auto frame = policy.compress(input);
+        REQUIRE(read_frame_header(frame)->codec == codec_type::Zlib);
+        REQUIRE(decompress(frame) == input);
+
+        auto statistics = policy.statistics();
+        REQUIRE(statistics.compressed == 1);
+        REQUIRE(statistics.input_bytes == input.size());
+        REQUIRE(statistics.output_bytes == frame.size());
+        REQUIRE(statistics.saved_bytes() > 0);
+    }
+
+    SECTION("Message types that don't pay off must be skipped until they are probed again")
+    {
+        // Passing the entropy check lets the policy learn from compressing the data instead
+        policy_settings settings;
+        settings.max_entropy = 8.0;
+        settings.probe_interval = 4;
+
+        compression_policy policy{zlib, settings};
+        auto incompressible = make_random_bytes(1024);
+        auto compressible = repetitive_data(1024);
+
+        policy.compress(incompressible, 1);
+        REQUIRE_FALSE(policy.should_compress(incompressible, 1));
+        REQUIRE(policy.should_compress(compressible, 2));
+
+        for (int i = 0; i < 3; ++i)
+            REQUIRE(decompress(policy.compress(incompressible, 1)) == incompressible);
+
+        REQUIRE(policy.statistics().skipped_learned == 3);
+        REQUIRE(policy.should_compress(incompressible, 1));
+
+        policy.compress(incompressible, 1);
+        REQUIRE(policy.statistics().compressed == 2);
+    }
+}
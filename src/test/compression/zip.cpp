@@ -15,10 +15,18 @@
 */
 
 #include <keycap/root/compression/zip.hpp>
+#include <keycap/root/network/memory_stream.hpp>
 
 #include <rapidcheck/catch.h>
 
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
 using namespace keycap::root::compression;
+namespace net = keycap::root::network;
 
 TEST_CASE("Zip")
 {
@@ -191,4 +199,364 @@ TEST_CASE("Zip")
 
         REQUIRE(std::equal(output.begin(), output.end(), zip::decompress(input.begin(), input.end()).begin()));
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Zip streams")
+{
+    std::vector<uint8_t> input(100000);
+    for (size_t i = 0; i < input.size(); ++i)
+        input[i] = static_cast<uint8_t>((i * 7) % 251 + i / 1000);
+
+    auto compressed = zip::compress(input.begin(), input.end());
+
+    SECTION("Compressing data in chunks must yield the same result as compressing it at once")
+    {
+        zip::deflate_stream stream;
+        std::vector<uint8_t> output;
+
+        for (size_t i = 0; i < input.size(); i += 777)
+        {
+            auto chunk = std::span<uint8_t const>(input).subspan(i, std::min<size_t>(777, input.size() - i));
+            REQUIRE(stream.write(chunk, output).consumed == chunk.size());
+        }
+
+        stream.finish(output);
+
+        REQUIRE(stream.finished());
+        REQUIRE(output == compressed);
+    }
+
+    SECTION("Decompressing data in chunks must yield the original data")
+    {
+        zip::inflate_stream stream;
+        net::memory_stream output;
+
+        for (size_t i = 0; i < compressed.size(); i += 100)
+        {
+            auto chunk = std::span<uint8_t const>(compressed).subspan(i, std::min<size_t>(100, compressed.size() - i));
+            REQUIRE(stream.write(chunk, output).consumed == chunk.size());
+        }
+
+        REQUIRE(stream.finished());
+        REQUIRE(output.buffer() == input);
+    }
+
+    SECTION("Decompressing into a small buffer must continue where it stopped")
+    {
+        zip::inflate_stream stream;
+        std::vector<uint8_t> output;
+        std::array<uint8_t, 1000> buffer{};
+
+        std::span<uint8_t const> remaining = compressed;
+        while (!stream.finished())
+        {
+            auto result = stream.write(remaining, buffer);
+            output.insert(output.end(), buffer.begin(), buffer.begin() + static_cast<ptrdiff_t>(result.produced));
+            remaining = remaining.subspan(result.consumed);
+        }
+
+        REQUIRE(remaining.empty());
+        REQUIRE(output == input);
+    }
+
+    SECTION("Data following the end of the compressed stream must not be consumed")
+    {
+        auto data = compressed;
+        data.insert(data.end(), {1, 2, 3});
+
+        zip::inflate_stream stream;
+        std::vector<uint8_t> output;
+
+        REQUIRE(stream.write(data, output).consumed == compressed.size());
+        REQUIRE(stream.finished());
+        REQUIRE(output == input);
+    }
+
+    SECTION("Flushing must make all data written so far decompressible while keeping the history")
+    {
+        zip::deflate_stream deflate;
+        zip::inflate_stream inflate;
+
+        std::vector<uint8_t> message(input.begin(), input.begin() + 200);
+        std::vector<size_t> sizes;
+
+        for (int i = 0; i < 3; ++i)
+        {
+            std::vector<uint8_t> flushed;
+            deflate.write(message, flushed);
+            deflate.flush(flushed);
+            sizes.push_back(flushed.size());
+
+            std::vector<uint8_t> output;
+            REQUIRE(inflate.write(flushed, output).consumed == flushed.size());
+            REQUIRE(output == message);
+        }
+
+        REQUIRE_FALSE(deflate.finished());
+        REQUIRE(sizes[1] < sizes[0] / 4);
+    }
+
+    SECTION("Malformed data must throw")
+    {
+        std::vector<uint8_t> data{1, 2, 3, 4, 5, 6, 7, 8};
+
+        zip::inflate_stream stream;
+        std::vector<uint8_t> output;
+
+        REQUIRE_THROWS(stream.write(data, output));
+    }
+
+    SECTION("Resetting a stream must allow it to be reused")
+    {
+        zip::deflate_stream deflate;
+        std::vector<uint8_t> output;
+        deflate.write(input, output);
+        deflate.finish(output);
+
+        output.clear();
+        deflate.reset();
+        deflate.write(input, output);
+        deflate.finish(output);
+
+        REQUIRE(output == compressed);
+
+        zip::inflate_stream inflate;
+        std::vector<uint8_t> decompressed;
+        inflate.write(compressed, decompressed);
+
+        decompressed.clear();
+        inflate.reset();
+        inflate.write(compressed, decompressed);
+
+        REQUIRE(decompressed == input);
+    }
+
+    rc::prop("Streaming arbitrary data through both streams must yield the input", [](std::vector<uint8_t> data) {
+        zip::deflate_stream deflate;
+        std::vector<uint8_t> output;
+        deflate.write(data, output);
+        deflate.finish(output);
+
+        zip::inflate_stream inflate;
+        std::vector<uint8_t> decompressed;
+        inflate.write(output, decompressed);
+
+        REQUIRE(decompressed == data);
+    });
+}
+
+TEST_CASE("Zip decompression into known buffers")
+{
+    std::vector<uint8_t> input(100000);
+    for (size_t i = 0; i < input.size(); ++i)
+        input[i] = static_cast<uint8_t>((i * 7) % 251 + i / 1000);
+
+    auto compressed = zip::compress(input.begin(), input.end());
+
+    SECTION("Decompressing with the uncompressed size must yield the original data")
+    {
+        REQUIRE(zip::decompress(compressed.begin(), compressed.end(), input.size()) == input);
+    }
+
+    SECTION("Decompressing with a too small uncompressed size must still yield the original data")
+    {
+        REQUIRE(zip::decompress(compressed.begin(), compressed.end(), 10) == input);
+    }
+
+    SECTION("Decompressing truncated data must yield nothing")
+    {
+        REQUIRE(zip::decompress(compressed.begin(), compressed.end() - 10).empty());
+    }
+
+    SECTION("decompress_into() must decompress into the given buffer")
+    {
+        std::vector<uint8_t> output(input.size() + 10);
+
+        REQUIRE(zip::decompress_into(compressed, output) == input.size());
+        REQUIRE(std::equal(input.begin(), input.end(), output.begin()));
+    }
+
+    SECTION("decompress_into() must fail if the buffer is too small")
+    {
+        std::vector<uint8_t> output(input.size() - 1);
+
+        REQUIRE_FALSE(zip::decompress_into(compressed, output));
+    }
+
+    SECTION("decompress_into() must fail on malformed data")
+    {
+        std::vector<uint8_t> data{1, 2, 3, 4, 5, 6, 7, 8};
+        std::vector<uint8_t> output(100);
+
+        REQUIRE_FALSE(zip::decompress_into(data, output));
+    }
+}
+
+TEST_CASE("Zip context reuse")
+{
+    std::string small = "Hello, World!";
+    std::string large(100000, 'x');
+    for (size_t i = 0; i < large.size(); i += 7)
+        large[i] = static_cast<char>('a' + i % 26);
+
+    std::vector<uint8_t> const expected_small
+        = {120, 218, 243, 72, 205, 201, 201, 215, 81, 8, 207, 47, 202, 73, 81, 4, 0, 31, 158, 4, 106};
+    auto expected_large = zip::compress(large.begin(), large.end());
+
+    SECTION("Compressing alternating inputs must always yield the same result")
+    {
+        for (int i = 0; i < 10; ++i)
+        {
+            REQUIRE(zip::compress(small.begin(), small.end()) == expected_small);
+            REQUIRE(zip::compress(large.begin(), large.end()) == expected_large);
+        }
+    }
+
+    SECTION("Decompressing after a failed decompression must succeed")
+    {
+        auto truncated = expected_large;
+        truncated.resize(truncated.size() / 2);
+
+        REQUIRE(zip::decompress(truncated.begin(), truncated.end()).empty());
+
+        auto output = zip::decompress(expected_large.begin(), expected_large.end());
+        REQUIRE(std::string(output.begin(), output.end()) == large);
+    }
+
+    SECTION("Every thread must yield the same result")
+    {
+        std::vector<std::thread> threads;
+        std::array<bool, 4> succeeded{};
+
+        for (size_t t = 0; t < succeeded.size(); ++t)
+        {
+            threads.emplace_back([&, t] {
+                auto input = large;
+                bool success = true;
+                for (int i = 0; i < 10; ++i)
+                {
+                    auto compressed = zip::compress(input.begin(), input.end());
+                    auto output = zip::decompress(compressed.begin(), compressed.end());
+                    success = success && compressed == expected_large && std::equal(output.begin(), output.end(),
+                                                                                    large.begin(), large.end());
+                }
+
+                succeeded[t] = success;
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        REQUIRE(succeeded == std::array<bool, 4>{true, true, true, true});
+    }
+}
+
+TEST_CASE("Zip parallel compression")
+{
+    std::vector<uint8_t> input(1000000);
+    for (size_t i = 0; i < input.size(); ++i)
+        input[i] = static_cast<uint8_t>("The quick brown fox jumps over the lazy dog"[(i * 7 + i / 1000) % 43]);
+
+    SECTION("The blocks must form a zlib stream that decompresses to the input")
+    {
+        for (size_t threads : {1, 4})
+        {
+            auto compressed = zip::compress_parallel(input, 8, threads, 64 * 1024);
+            REQUIRE(zip::decompress(compressed.begin(), compressed.end()) == input);
+        }
+    }
+
+    SECTION("The result must not depend on the number of threads")
+    {
+        REQUIRE(zip::compress_parallel(input, 8, 1, 64 * 1024) == zip::compress_parallel(input, 8, 8, 64 * 1024));
+    }
+
+    SECTION("Priming the blocks must keep the size close to compressing at once")
+    {
+        auto parallel = zip::compress_parallel(input, 8, 4, 64 * 1024);
+        auto serial = zip::compress(input.begin(), input.end());
+
+        REQUIRE(parallel.size() < serial.size() + serial.size() / 10);
+    }
+
+    SECTION("Inputs smaller than a block and every level must yield a valid stream")
+    {
+        std::vector<uint8_t> small(input.begin(), input.begin() + 1000);
+        for (int level = 0; level <= 9; ++level)
+        {
+            auto compressed = zip::compress_parallel(small, level);
+            REQUIRE(zip::decompress(compressed.begin(), compressed.end()) == small);
+        }
+    }
+
+    SECTION("Empty inputs must yield nothing")
+    {
+        REQUIRE(zip::compress_parallel({}).empty());
+    }
+}
+
+TEST_CASE("Zip files")
+{
+    auto const directory = std::filesystem::temp_directory_path();
+    auto const original = directory / "keycap-root-zip.bin";
+    auto const compressed = directory / "keycap-root-zip.bin.z";
+    auto const restored = directory / "keycap-root-zip.bin.out";
+
+    // Spans several chunks of the file helpers
+    std::vector<uint8_t> input(3 * 1024 * 1024 + 17);
+    for (size_t i = 0; i < input.size(); ++i)
+        input[i] = static_cast<uint8_t>((i * 7) ^ (i >> 10));
+
+    auto write = [](std::filesystem::path const& path, std::vector<uint8_t> const& data) {
+        std::ofstream file{path, std::ios::binary | std::ios::trunc};
+        file.write(reinterpret_cast<char const*>(data.data()), static_cast<std::streamsize>(data.size()));
+    };
+
+    auto read = [](std::filesystem::path const& path) {
+        std::ifstream file{path, std::ios::binary};
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    };
+
+    write(original, input);
+
+    SECTION("Compressing a file must yield the same result as compressing its contents")
+    {
+        auto size = zip::compress_file(original, compressed);
+
+        REQUIRE(size == std::filesystem::file_size(compressed));
+        REQUIRE(read(compressed) == zip::compress(input.begin(), input.end()));
+    }
+
+    SECTION("Decompressing a compressed file must restore the original")
+    {
+        zip::compress_file(original, compressed);
+
+        REQUIRE(zip::decompress_file(compressed, restored) == input.size());
+        REQUIRE(read(restored) == input);
+    }
+
+    SECTION("Decompressing a truncated file must throw")
+    {
+        auto data = zip::compress(input.begin(), input.end());
+        data.resize(data.size() / 2);
+        write(compressed, data);
+
+        REQUIRE_THROWS(zip::decompress_file(compressed, restored));
+    }
+
+    SECTION("Missing files must throw")
+    {
+        REQUIRE_THROWS(zip::compress_file(directory / "keycap-root-missing.bin", compressed));
+    }
+
+    SECTION("The bound of inputs beyond 2^32 bytes must exceed their size")
+    {
+        size_t const size = (size_t{1} << 33) + 5;
+        REQUIRE(zip::compress_bound(size) > size);
+    }
+
+    std::filesystem::remove(original);
+    std::filesystem::remove(compressed);
+    std::filesystem::remove(restored);
+}
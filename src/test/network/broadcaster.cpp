@@ -0,0 +1,134 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/network/broadcaster.hpp>
+
+#include <rapidcheck/catch.h>
+
+#include <memory>
+#include <vector>
+
+namespace net = keycap::root::network;
+
+namespace
+{
+    class recording_connection : public net::connection_base
+    {
+      public:
+        explicit recording_connection(boost::asio::io_context& context)
+          : net::connection_base{boost::asio::ip::tcp::socket{context}, context}
+        {
+        }
+
+        void send(std::span<uint8_t> data) override
+        {
+            received.push_back(net::make_shared_buffer(data));
+        }
+
+        void send(net::shared_buffer data) override
+        {
+            received.push_back(std::move(data));
+        }
+
+        std::vector<net::shared_buffer> received;
+    };
+}
+
+TEST_CASE("broadcaster")
+{
+    boost::asio::io_context context1;
+    boost::asio::io_context context2;
+
+    auto connection1 = std::make_shared<recording_connection>(context1);
+    auto connection2 = std::make_shared<recording_connection>(context1);
+    auto connection3 = std::make_shared<recording_connection>(context2);
+
+    net::broadcaster broadcaster;
+    broadcaster.subscribe(1, connection1);
+    broadcaster.subscribe(1, connection2);
+    broadcaster.subscribe(1, connection3);
+    broadcaster.subscribe(2, connection3);
+
+    std::vector<uint8_t> data{1, 2, 3, 4};
+
+    auto run = [&] {
+        context1.run();
+        context2.run();
+    };
+
+    SECTION("Broadcasts must share a single buffer between all subscribers")
+    {
+        broadcaster.broadcast(1, data);
+        run();
+
+        REQUIRE(connection1->received.size() == 1);
+        REQUIRE(connection2->received.size() == 1);
+        REQUIRE(connection3->received.size() == 1);
+        REQUIRE(*connection1->received[0] == data);
+        REQUIRE(connection1->received[0] == connection2->received[0]);
+        REQUIRE(connection1->received[0] == connection3->received[0]);
+    }
+
+    SECTION("Broadcasts must only be delivered on the subscribers' io_context")
+    {
+        broadcaster.broadcast(1, data);
+        context2.run();
+
+        REQUIRE(connection1->received.empty());
+        REQUIRE(connection3->received.size() == 1);
+    }
+
+    SECTION("Broadcasts must only reach subscribers of the channel")
+    {
+        net::memory_stream stream;
+        stream.put<uint32_t>(42);
+
+        broadcaster.broadcast(2, std::move(stream));
+        broadcaster.broadcast(3, data);
+        run();
+
+        REQUIRE(connection1->received.empty());
+        REQUIRE(connection2->received.empty());
+        REQUIRE(connection3->received.size() == 1);
+        REQUIRE(connection3->received[0]->size() == sizeof(uint32_t));
+    }
+
+    SECTION("Subscribing more than once must not duplicate broadcasts")
+    {
+        broadcaster.subscribe(1, connection1);
+        REQUIRE(broadcaster.subscribers(1) == 3);
+
+        broadcaster.broadcast(1, data);
+        run();
+        REQUIRE(connection1->received.size() == 1);
+    }
+
+    SECTION("Unsubscribed connections must no longer receive broadcasts")
+    {
+        broadcaster.unsubscribe(1, connection1.get());
+        broadcaster.unsubscribe(connection3.get());
+        REQUIRE(broadcaster.subscribers(1) == 1);
+        REQUIRE(broadcaster.subscribers(2) == 0);
+
+        broadcaster.broadcast(1, data);
+        broadcaster.broadcast(2, data);
+        run();
+
+        REQUIRE(connection1->received.empty());
+        REQUIRE(connection2->received.size() == 1);
+        REQUIRE(connection3->received.empty());
+    }
+}
@@ -23,6 +23,10 @@
 
 #include <rapidcheck/catch.h>
 
+#include <atomic>
+#include <memory>
+#include <thread>
+
 namespace net = keycap::root::network;
 
 class TestHandler;
@@ -72,6 +76,24 @@ class TestHandler : public net::message_handler
     net::data_router& router_;
 };
 
+class CountingConnection : public net::connection_base
+{
+  public:
+    explicit CountingConnection(boost::asio::io_context& context)
+      : net::connection_base{boost::asio::ip::tcp::socket{context}, context}
+    {
+    }
+
+    using net::connection_base::send;
+
+    void send(std::span<uint8_t> data) override
+    {
+        ++SendCalled;
+    }
+
+    int SendCalled = 0;
+};
+
 TEST_CASE("data_router")
 {
     DummyService service;
@@ -109,4 +131,155 @@ TEST_CASE("data_router")
         REQUIRE_FALSE(handler.OnLinkCalled);
         REQUIRE(handler2.OnLinkCalled);
     }
+
+    SECTION("data_router::route_outbound() must route data to all ConnectionHandlers without keeping them alive")
+    {
+        boost::asio::io_context context;
+        auto connection = std::make_shared<CountingConnection>(context);
+        std::weak_ptr<CountingConnection> observer = connection;
+
+        router.configure_outbound(connection);
+        router.route_outbound(data);
+        REQUIRE(connection->SendCalled == 1);
+
+        connection.reset();
+        REQUIRE(observer.expired());
+
+        router.route_outbound(data);
+    }
+
+    SECTION("data_router::remove_outbound() must remove the given ConnectionHandler")
+    {
+        boost::asio::io_context context;
+        auto connection = std::make_shared<CountingConnection>(context);
+
+        router.configure_outbound(connection);
+        router.remove_outbound(connection.get());
+        router.route_outbound(data);
+        REQUIRE(connection->SendCalled == 0);
+        REQUIRE(connection.use_count() == 1);
+    }
+
+    SECTION("Handlers must be configurable while data is being routed")
+    {
+        std::vector<std::unique_ptr<TestHandler>> handlers;
+        for (int i = 0; i < 8; ++i)
+            handlers.push_back(std::make_unique<TestHandler>(router));
+
+        std::atomic_bool done = false;
+        std::thread configurator{[&] {
+            while (!done)
+            {
+                for (auto& testHandler : handlers)
+                    router.remove_handler(testHandler.get());
+
+                for (auto& testHandler : handlers)
+                    router.configure_inbound(testHandler.get());
+            }
+        }};
+
+        bool succeeded = true;
+        for (int i = 0; i < 10000; ++i)
+            succeeded = router.route_inbound(service, data) && succeeded;
+
+        done = true;
+        configurator.join();
+
+        REQUIRE(succeeded);
+
+        REQUIRE(handler.OnMessageCalled);
+        REQUIRE(handler2.OnMessageCalled);
+    }
+}
+
+namespace
+{
+    // Frames used by the tests: uint16 size (including the header), uint16 opcode, payload
+    std::optional<net::frame_header> read_test_frame(std::span<uint8_t const> data)
+    {
+        if (data.size() < 4)
+            return {};
+
+        net::frame_header header;
+        header.size = data[0] | (data[1] << 8);
+        header.opcode = data[2] | (data[3] << 8);
+        return header;
+    }
+
+    void put_test_frame(std::vector<uint8_t>& data, uint16_t opcode, std::string const& payload)
+    {
+        auto size = static_cast<uint16_t>(4 + payload.size());
+        data.insert(
+            data.end(), {static_cast<uint8_t>(size), static_cast<uint8_t>(size >> 8), static_cast<uint8_t>(opcode),
+                         static_cast<uint8_t>(opcode >> 8)});
+        data.insert(data.end(), payload.begin(), payload.end());
+    }
+}
+
+TEST_CASE("data_router dispatch")
+{
+    DummyService service;
+    net::data_router router;
+    TestHandler handler{router};
+
+    std::vector<std::string> received;
+    auto make_handler = [&](std::string const& name) {
+        return [&, name](net::data_router const&, net::service_type, std::span<uint8_t> frame) {
+            received.push_back(name + ":" + std::string(frame.begin() + 4, frame.end()));
+            return true;
+        };
+    };
+
+    auto table = std::make_shared<net::opcode_table>(&read_test_frame, 16);
+    table->add(1, make_handler("dense"));
+    table->add(0x1234, make_handler("sparse"));
+    router.configure_dispatch(table);
+
+    SECTION("Every frame must be routed to exactly the handler registered for its opcode")
+    {
+        std::vector<uint8_t> data;
+        put_test_frame(data, 1, "Foo");
+        put_test_frame(data, 0x1234, "Bar");
+        put_test_frame(data, 1, "Baz");
+
+        REQUIRE(router.route_inbound(service, data));
+        REQUIRE(received == std::vector<std::string>{"dense:Foo", "sparse:Bar", "dense:Baz"});
+        REQUIRE_FALSE(handler.OnMessageCalled);
+    }
+
+    SECTION("Frames spanning multiple reads must be routed once they are complete")
+    {
+        std::vector<uint8_t> data;
+        put_test_frame(data, 1, "Foo");
+        put_test_frame(data, 0x1234, "Barbaz");
+
+        for (size_t i = 0; i < data.size(); i += 3)
+        {
+            std::span<uint8_t> chunk{data.data() + i, std::min<size_t>(3, data.size() - i)};
+            REQUIRE(router.route_inbound(service, chunk));
+        }
+
+        REQUIRE(received == std::vector<std::string>{"dense:Foo", "sparse:Barbaz"});
+    }
+
+    SECTION("Frames without a registered handler must fail")
+    {
+        std::vector<uint8_t> data;
+        put_test_frame(data, 2, "Foo");
+
+        REQUIRE_FALSE(router.route_inbound(service, data));
+        REQUIRE(received.empty());
+    }
+
+    SECTION("Removing the dispatch table must route to all message_handlers again")
+    {
+        std::vector<uint8_t> data;
+        put_test_frame(data, 1, "Foo");
+
+        router.configure_dispatch(nullptr);
+
+        REQUIRE(router.route_inbound(service, data));
+        REQUIRE(received.empty());
+        REQUIRE(handler.OnMessageCalled);
+    }
 }
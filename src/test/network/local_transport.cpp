@@ -0,0 +1,240 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/network/shm_transport.hpp>
+#include <keycap/root/network/transport.hpp>
+
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/local/connect_pair.hpp>
+
+#include <rapidcheck/catch.h>
+
+#include <atomic>
+#include <chrono>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+namespace net = keycap::root::network;
+
+using boost::asio::awaitable;
+using boost::asio::local::stream_protocol;
+
+namespace
+{
+    // Runs both contexts, each on its own thread, until done returns true or a few seconds passed
+    template <typename Predicate>
+    void run_until(boost::asio::io_context& context1, boost::asio::io_context& context2, Predicate done)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+        auto run = [&](boost::asio::io_context& context) {
+            while (!done() && std::chrono::steady_clock::now() < deadline)
+            {
+                context.restart();
+                context.run_for(std::chrono::milliseconds{1});
+            }
+        };
+
+        std::thread thread{[&] { run(context1); }};
+        run(context2);
+        thread.join();
+    }
+
+    // Writes data on the first end and reads it on the second one
+    std::vector<uint8_t> transfer(
+        boost::asio::io_context& context1, net::transport& first, boost::asio::io_context& context2,
+        net::transport& second, std::vector<uint8_t> const& data)
+    {
+        std::vector<uint8_t> received;
+        std::atomic<bool> done = false;
+
+        boost::asio::co_spawn(
+            context1, [&]() -> awaitable<void> { co_await first.write(data); }, boost::asio::detached);
+
+        boost::asio::co_spawn(
+            context2,
+            [&]() -> awaitable<void> {
+                std::vector<uint8_t> buffer(1000);
+                while (received.size() < data.size())
+                {
+                    auto size = co_await second.read_some(buffer);
+                    received.insert(received.end(), buffer.begin(), buffer.begin() + static_cast<ptrdiff_t>(size));
+                }
+
+                done = true;
+            },
+            boost::asio::detached);
+
+        run_until(context1, context2, [&] { return done.load(); });
+        return received;
+    }
+}
+
+TEST_CASE("unix_transport")
+{
+    boost::asio::io_context context1;
+    boost::asio::io_context context2;
+
+    stream_protocol::socket socket1{context1};
+    stream_protocol::socket socket2{context2};
+    boost::asio::local::connect_pair(socket1, socket2);
+
+    net::unix_transport first{std::move(socket1)};
+    net::unix_transport second{std::move(socket2)};
+
+    REQUIRE(first.kind() == net::transport_kind::Unix);
+    REQUIRE(first.is_open());
+
+    SECTION("Data written to one end must be read from the other in order")
+    {
+        std::vector<uint8_t> data(100000);
+        std::iota(data.begin(), data.end(), uint8_t{0});
+
+        REQUIRE(transfer(context1, first, context2, second, data) == data);
+    }
+
+    SECTION("Closing an end must close it")
+    {
+        first.close();
+        REQUIRE_FALSE(first.is_open());
+    }
+}
+
+#ifdef KEYCAP_ROOT_HAS_SHM_TRANSPORT
+TEST_CASE("shm_transport")
+{
+    boost::asio::io_context context1;
+    boost::asio::io_context context2;
+
+    stream_protocol::socket socket1{context1};
+    stream_protocol::socket socket2{context2};
+    boost::asio::local::connect_pair(socket1, socket2);
+
+    std::unique_ptr<net::transport> first;
+    std::unique_ptr<net::transport> second;
+
+    std::atomic<int> connected = 0;
+
+    boost::asio::co_spawn(
+        context1,
+        [&]() -> awaitable<void> {
+            first = co_await net::shm_transport::connect(std::move(socket1), 4096);
+            ++connected;
+        },
+        boost::asio::detached);
+
+    boost::asio::co_spawn(
+        context2,
+        [&]() -> awaitable<void> {
+            second = co_await net::shm_transport::accept(std::move(socket2));
+            ++connected;
+        },
+        boost::asio::detached);
+
+    run_until(context1, context2, [&] { return connected == 2; });
+
+    REQUIRE(first);
+    REQUIRE(second);
+    REQUIRE(first->kind() == net::transport_kind::SharedMemory);
+    REQUIRE(first->is_open());
+    REQUIRE(second->is_open());
+
+    SECTION("Data written to one end must be read from the other in order, even when exceeding the capacity")
+    {
+        std::vector<uint8_t> data(100000);
+        std::iota(data.begin(), data.end(), uint8_t{0});
+
+        REQUIRE(transfer(context1, *first, context2, *second, data) == data);
+        REQUIRE(transfer(context2, *second, context1, *first, data) == data);
+    }
+
+    SECTION("Closing one end must fail pending reads of the other once all data has been read")
+    {
+        std::vector<uint8_t> data{1, 2, 3};
+        std::vector<uint8_t> buffer(16);
+        size_t received = 0;
+        std::atomic<bool> failed = false;
+
+        boost::asio::co_spawn(
+            context1,
+            [&]() -> awaitable<void> {
+                co_await first->write(data);
+                first->close();
+            },
+            boost::asio::detached);
+
+        boost::asio::co_spawn(
+            context2,
+            [&]() -> awaitable<void> {
+                try
+                {
+                    while (true)
+                        received += co_await second->read_some(buffer);
+                }
+                catch (boost::system::system_error const&)
+                {
+                    failed = true;
+                }
+            },
+            boost::asio::detached);
+
+        run_until(context1, context2, [&] { return failed.load(); });
+
+        REQUIRE(received == data.size());
+        REQUIRE(failed);
+        REQUIRE_FALSE(first->is_open());
+        REQUIRE(second->is_open());
+    }
+
+    SECTION("Closing one end with data still pending must let the other end read it before failing")
+    {
+        std::vector<uint8_t> data(20000, 42);
+        size_t received = 0;
+        std::atomic<bool> failed = false;
+
+        boost::asio::co_spawn(
+            context1,
+            [&]() -> awaitable<void> {
+                co_await first->write(data);
+                first->close();
+            },
+            boost::asio::detached);
+
+        // Reads the way connection::do_read does
+        boost::asio::co_spawn(
+            context2,
+            [&]() -> awaitable<void> {
+                std::vector<uint8_t> buffer(1000);
+                try
+                {
+                    while (second->is_open())
+                        received += co_await second->read_some(buffer);
+                }
+                catch (boost::system::system_error const& error)
+                {
+                    failed = error.code() == boost::asio::error::eof;
+                }
+            },
+            boost::asio::detached);
+
+        run_until(context1, context2, [&] { return failed.load(); });
+
+        REQUIRE(received == data.size());
+        REQUIRE(failed);
+    }
+}
+#endif
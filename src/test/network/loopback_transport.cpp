@@ -0,0 +1,181 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/network/loopback_transport.hpp>
+
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+
+#include <rapidcheck/catch.h>
+
+#include <numeric>
+#include <thread>
+#include <vector>
+
+namespace net = keycap::root::network;
+
+using boost::asio::awaitable;
+
+TEST_CASE("loopback_transport")
+{
+    boost::asio::io_context context1;
+    boost::asio::io_context context2;
+
+    auto [first, second] = net::make_loopback_pair(context1, context2, 64);
+
+    REQUIRE(first->kind() == net::transport_kind::Loopback);
+    REQUIRE(first->is_open());
+
+    SECTION("Data written to one end must be read from the other in order, even when exceeding the capacity")
+    {
+        std::vector<uint8_t> data(10000);
+        std::iota(data.begin(), data.end(), uint8_t{0});
+
+        std::vector<uint8_t> received;
+
+        boost::asio::co_spawn(
+            context1, [&]() -> awaitable<void> { co_await first->write(data); }, boost::asio::detached);
+
+        boost::asio::co_spawn(
+            context2,
+            [&]() -> awaitable<void> {
+                std::vector<uint8_t> buffer(100);
+                while (received.size() < data.size())
+                {
+                    auto size = co_await second->read_some(buffer);
+                    received.insert(received.end(), buffer.begin(), buffer.begin() + static_cast<ptrdiff_t>(size));
+                }
+            },
+            boost::asio::detached);
+
+        std::thread thread{[&] { context1.run(); }};
+        context2.run();
+        thread.join();
+
+        REQUIRE(received == data);
+    }
+
+    SECTION("Both ends must be able to send at the same time")
+    {
+        std::vector<uint8_t> ping{'p', 'i', 'n', 'g'};
+        std::vector<uint8_t> pong{'p', 'o', 'n', 'g'};
+        std::vector<uint8_t> received1(4);
+        std::vector<uint8_t> received2(4);
+
+        boost::asio::co_spawn(
+            context1,
+            [&]() -> awaitable<void> {
+                co_await first->write(ping);
+                co_await first->read_some(received1);
+            },
+            boost::asio::detached);
+
+        boost::asio::co_spawn(
+            context2,
+            [&]() -> awaitable<void> {
+                co_await second->read_some(received2);
+                co_await second->write(pong);
+            },
+            boost::asio::detached);
+
+        std::thread thread{[&] { context1.run(); }};
+        context2.run();
+        thread.join();
+
+        REQUIRE(received1 == pong);
+        REQUIRE(received2 == ping);
+    }
+
+    SECTION("Closing one end must fail pending reads of the other once all data has been read")
+    {
+        std::vector<uint8_t> data{1, 2, 3};
+        std::vector<uint8_t> buffer(16);
+        size_t received = 0;
+        bool failed = false;
+
+        boost::asio::co_spawn(
+            context1,
+            [&]() -> awaitable<void> {
+                co_await first->write(data);
+                first->close();
+            },
+            boost::asio::detached);
+
+        boost::asio::co_spawn(
+            context2,
+            [&]() -> awaitable<void> {
+                try
+                {
+                    while (true)
+                        received += co_await second->read_some(buffer);
+                }
+                catch (boost::system::system_error const&)
+                {
+                    failed = true;
+                }
+            },
+            boost::asio::detached);
+
+        context2.run_for(std::chrono::milliseconds{10});
+        context1.run();
+        context2.restart();
+        context2.run();
+
+        REQUIRE(received == data.size());
+        REQUIRE(failed);
+        REQUIRE_FALSE(first->is_open());
+        REQUIRE(second->is_open());
+    }
+
+    SECTION("Closing one end with data still pending must let the other end read it before failing")
+    {
+        std::vector<uint8_t> data(5000, 42);
+        std::vector<uint8_t> buffer(100);
+        size_t received = 0;
+        bool failed = false;
+
+        boost::asio::co_spawn(
+            context1,
+            [&]() -> awaitable<void> {
+                co_await first->write(data);
+                first->close();
+            },
+            boost::asio::detached);
+
+        // Reads the way connection::do_read does
+        boost::asio::co_spawn(
+            context2,
+            [&]() -> awaitable<void> {
+                try
+                {
+                    while (second->is_open())
+                        received += co_await second->read_some(buffer);
+                }
+                catch (boost::system::system_error const& error)
+                {
+                    failed = error.code() == boost::asio::error::eof;
+                }
+            },
+            boost::asio::detached);
+
+        std::thread thread{[&] { context1.run(); }};
+        context2.run();
+        thread.join();
+
+        REQUIRE(received == data.size());
+        REQUIRE(failed);
+    }
+}
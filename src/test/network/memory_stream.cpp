@@ -14,6 +14,7 @@
     limitations under the License.
 */
 
+#include <keycap/root/compression/zip.hpp>
 #include <keycap/root/network/memory_stream.hpp>
 
 #include <rapidcheck/catch.h>
@@ -304,3 +305,45 @@ TEST_CASE("memory_stream")
         REQUIRE(stream.get<uint16_t>() == expected);
     }
 }
+
+TEST_CASE("memory_stream decompression")
+{
+    namespace zip = keycap::root::compression::zip;
+
+    std::string text = "Hello, World! Hello, World! Hello, World!";
+    auto compressed = zip::compress(text.begin(), text.end());
+
+    net::memory_stream stream;
+    stream.put<uint32_t>(0xC0CA);
+    stream.put(compressed);
+    stream.put<uint16_t>(0xBEEF);
+    stream.get<uint32_t>();
+
+    SECTION("Decompressing with the uncompressed length must replace the compressed data in place")
+    {
+        REQUIRE(stream.decompress(compressed.size(), text.size()) == text.size());
+        REQUIRE(stream.get_string(text.size()) == text);
+        REQUIRE(stream.get<uint16_t>() == 0xBEEF);
+        REQUIRE_FALSE(stream.has_data_remaining());
+    }
+
+    SECTION("Decompressing into a larger uncompressed length must only keep the decompressed data")
+    {
+        REQUIRE(stream.decompress(compressed.size(), text.size() + 100) == text.size());
+        REQUIRE(stream.get_string(text.size()) == text);
+        REQUIRE(stream.get<uint16_t>() == 0xBEEF);
+    }
+
+    SECTION("Decompressing into a too small uncompressed length must leave the stream untouched")
+    {
+        auto buffer = stream.buffer();
+
+        REQUIRE(stream.decompress(compressed.size(), text.size() - 1) == 0);
+        REQUIRE(stream.buffer() == buffer);
+    }
+
+    SECTION("Decompressing more than the stream contains must throw")
+    {
+        REQUIRE_THROWS(stream.decompress(stream.size() + 1, text.size()));
+    }
+}
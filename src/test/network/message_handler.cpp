@@ -0,0 +1,88 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/network/message_handler.hpp>
+
+#include <rapidcheck/catch.h>
+
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace net = keycap::root::network;
+
+namespace
+{
+    class NullHandler : public net::message_handler
+    {
+      public:
+        bool on_data(net::data_router const& router, net::service_type service, std::span<uint8_t> data) override
+        {
+            return true;
+        }
+
+        bool on_link(net::data_router const& router, net::service_type service, net::link_status status) override
+        {
+            return true;
+        }
+    };
+}
+
+TEST_CASE("message_handler ids")
+{
+    SECTION("Handlers must receive unique ids")
+    {
+        std::vector<NullHandler> handlers(100);
+
+        std::set<std::uint64_t> ids;
+        for (auto const& handler : handlers)
+            ids.insert(handler.id());
+
+        REQUIRE(ids.size() == handlers.size());
+    }
+
+    SECTION("Handlers created on different threads must receive unique ids")
+    {
+        std::vector<std::vector<NullHandler>> handlers(4);
+        std::vector<std::thread> threads;
+        for (auto& perThread : handlers)
+            threads.emplace_back([&perThread] { perThread = std::vector<NullHandler>(1000); });
+
+        for (auto& thread : threads)
+            thread.join();
+
+        std::set<std::uint64_t> ids;
+        for (auto const& perThread : handlers)
+        {
+            for (auto const& handler : perThread)
+                ids.insert(handler.id());
+        }
+
+        REQUIRE(ids.size() == 4000);
+    }
+
+    SECTION("A copied handler must receive a fresh id")
+    {
+        NullHandler handler;
+        NullHandler copy{handler};
+
+        REQUIRE(copy.id() != handler.id());
+
+        // operator== isn't const and thus can't be decomposed by REQUIRE
+        bool const equal = copy == handler;
+        REQUIRE_FALSE(equal);
+    }
+}
@@ -0,0 +1,161 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/network/data_router.hpp>
+#include <keycap/root/network/message_registry.hpp>
+#include <keycap/root/network/registered_message.hpp>
+
+#include <rapidcheck/catch.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace net = keycap::root::network;
+
+namespace
+{
+    struct ping
+    {
+        static constexpr net::registered_command opcode = net::registered_command::Update;
+
+        uint32_t sequence = 0;
+    };
+
+    struct greeting
+    {
+        static constexpr uint32_t opcode = 7;
+
+        std::string text;
+
+        static greeting decode(net::memory_stream& stream)
+        {
+            return greeting{stream.get_string()};
+        }
+    };
+
+    struct far_away
+    {
+        static constexpr uint32_t opcode = 0x10000;
+
+        uint16_t value = 0;
+    };
+
+    struct recorder
+    {
+        std::vector<std::string> calls;
+
+        void operator()(ping const& message)
+        {
+            calls.push_back("ping:" + std::to_string(message.sequence));
+        }
+
+        bool operator()(greeting const& message)
+        {
+            calls.push_back("greeting:" + message.text);
+            return !message.text.empty();
+        }
+
+        void operator()(far_away const& message)
+        {
+            calls.push_back("far_away:" + std::to_string(message.value));
+        }
+    };
+
+    template <typename T>
+    std::vector<uint8_t> to_bytes(T const& value)
+    {
+        net::memory_stream stream;
+        stream.put(value);
+        return stream.to_vector();
+    }
+}
+
+TEST_CASE("message_registry")
+{
+    recorder handler;
+
+    SECTION("Dense registries must decode into the message registered for the opcode")
+    {
+        using registry = net::message_registry<ping, greeting>;
+        static_assert(registry::contains(0) && registry::contains(7) && !registry::contains(1));
+
+        REQUIRE(registry::dispatch(0, to_bytes(uint32_t{42}), handler));
+        REQUIRE(registry::dispatch(7, to_bytes(std::string{"Hello"}), handler));
+        REQUIRE(handler.calls == std::vector<std::string>{"ping:42", "greeting:Hello"});
+    }
+
+    SECTION("Sparse registries must decode into the message registered for the opcode")
+    {
+        using registry = net::message_registry<ping, far_away>;
+
+        REQUIRE(registry::dispatch(0x10000, to_bytes(uint16_t{1337}), handler));
+        REQUIRE(registry::dispatch(0, to_bytes(uint32_t{1}), handler));
+        REQUIRE(handler.calls == std::vector<std::string>{"far_away:1337", "ping:1"});
+    }
+
+    SECTION("Unknown opcodes, malformed payloads and failing handlers must fail")
+    {
+        using registry = net::message_registry<ping, greeting>;
+
+        REQUIRE_FALSE(registry::dispatch(1, to_bytes(uint32_t{42}), handler));
+        REQUIRE_FALSE(registry::dispatch(4096, to_bytes(uint32_t{42}), handler));
+        REQUIRE_FALSE(registry::dispatch(0, to_bytes(uint16_t{42}), handler));
+        REQUIRE_FALSE(registry::dispatch(7, to_bytes(std::string{}), handler));
+        REQUIRE(handler.calls == std::vector<std::string>{"greeting:"});
+    }
+
+    SECTION("Additional arguments must be forwarded to the handler")
+    {
+        using registry = net::message_registry<ping>;
+
+        uint32_t calls = 0;
+        REQUIRE(registry::dispatch(0, to_bytes(uint32_t{3}), [](uint32_t& counter, ping const& message) {
+            counter += message.sequence;
+        }, calls));
+        REQUIRE(calls == 3);
+    }
+
+    SECTION("Registries must be usable as handlers of an opcode_table")
+    {
+        using registry = net::message_registry<ping, far_away>;
+
+        // Frames consist of a uint32 opcode followed by a uint16 payload size
+        net::opcode_table table{[](std::span<uint8_t const> data) -> std::optional<net::frame_header> {
+            if (data.size() < 6)
+                return {};
+
+            net::frame_header header;
+            std::memcpy(&header.opcode, data.data(), sizeof(uint32_t));
+            header.size = 6 + static_cast<size_t>(data[4] | (data[5] << 8));
+            return header;
+        }};
+
+        std::vector<std::string> calls;
+        registry::add_to(table, 6, [&](net::data_router const&, net::service_type, auto const& message) {
+            calls.push_back(std::to_string(message.opcode == 0 ? 0 : 1));
+        });
+
+        net::data_router router;
+        std::vector<uint8_t> frame{0, 0, 0, 0, 4, 0, 1, 0, 0, 0};
+        auto const* entry = table.find(0);
+        REQUIRE(entry);
+        REQUIRE((*entry)(router, net::service_type{0}, frame));
+        REQUIRE(table.find(0x10000));
+        REQUIRE_FALSE(table.find(1));
+        REQUIRE(calls == std::vector<std::string>{"0"});
+    }
+}
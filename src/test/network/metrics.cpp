@@ -0,0 +1,122 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/network/metrics.hpp>
+
+#include <rapidcheck/catch.h>
+
+#include <format>
+#include <thread>
+#include <vector>
+
+namespace net = keycap::root::network;
+
+TEST_CASE("metrics")
+{
+    SECTION("A counter must sum up the increments of all threads")
+    {
+        net::counter counter;
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 8; ++i)
+        {
+            threads.emplace_back([&] {
+                for (int j = 0; j < 10000; ++j)
+                    counter.add();
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        REQUIRE(counter.value() == 80000);
+    }
+
+    SECTION("Latencies must only be recorded if enabled")
+    {
+        net::service_metrics metrics;
+
+#ifdef KEYCAP_ROOT_LATENCY_METRICS
+        REQUIRE(metrics.record_latency());
+#endif
+
+        metrics.record_latency(false);
+        REQUIRE_FALSE(metrics.record_latency());
+    }
+
+    SECTION("service_metrics must only keep track of connections that are still alive")
+    {
+        net::service_metrics metrics;
+
+        auto first = std::make_shared<net::connection_metrics>();
+        auto second = std::make_shared<net::connection_metrics>();
+        REQUIRE(first->id != second->id);
+
+        metrics.track(first);
+        metrics.track(second);
+        second.reset();
+
+        std::vector<uint64_t> ids;
+        metrics.for_each_connection([&](net::connection_metrics const& connection) { ids.push_back(connection.id); });
+
+        REQUIRE(ids == std::vector<uint64_t>{first->id});
+    }
+
+    SECTION("The Prometheus dump must group the samples of all services by metric")
+    {
+        net::service_metrics auth;
+        auth.bytes_received.add(42);
+        auth.handler_time.record(3);
+
+        auto connection = std::make_shared<net::connection_metrics>();
+        connection->bytes_sent = 7;
+        auth.track(connection);
+
+        net::service_metrics world;
+        world.bytes_received.add(1);
+
+        net::prometheus_writer writer;
+        writer.add("auth", auth);
+        writer.add("world", world);
+        auto text = writer.str();
+
+        REQUIRE(
+            text.find("# TYPE keycap_received_bytes_total counter\n"
+                      "keycap_received_bytes_total{service=\"auth\"} 42\n"
+                      "keycap_received_bytes_total{service=\"world\"} 1\n")
+            != std::string::npos);
+        REQUIRE(text.find("# TYPE keycap_handler_seconds summary\n") != std::string::npos);
+        REQUIRE(text.find("keycap_handler_seconds{service=\"auth\",quantile=\"0.99\"} 3e-09\n") != std::string::npos);
+        REQUIRE(text.find("keycap_handler_seconds_count{service=\"auth\"} 1\n") != std::string::npos);
+        REQUIRE(
+            text.find(std::format(
+                "keycap_connection_sent_bytes_total{{service=\"auth\",connection=\"{}\"}} 7\n", connection->id))
+            != std::string::npos);
+    }
+
+    SECTION("The prometheus_writer must escape label values")
+    {
+        net::service_metrics metrics;
+        metrics.bytes_received.add(1);
+
+        net::prometheus_writer writer;
+        writer.add("a\\b\"c\nd", metrics);
+
+        REQUIRE(
+            writer.str().find("keycap_received_bytes_total{service=\"a\\\\b\\\"c\\nd\"} 1\n")
+            != std::string::npos);
+    }
+}
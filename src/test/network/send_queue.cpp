@@ -0,0 +1,105 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/network/send_queue.hpp>
+
+#include <rapidcheck/catch.h>
+
+#include <string>
+#include <vector>
+
+namespace net = keycap::root::network;
+
+namespace
+{
+    net::shared_buffer make_message(std::string const& text)
+    {
+        return std::make_shared<std::vector<uint8_t> const>(text.begin(), text.end());
+    }
+
+    std::vector<std::string> drain(net::send_queue& queue)
+    {
+        std::vector<std::string> messages;
+        while (auto data = queue.pop())
+            messages.emplace_back(data->begin(), data->end());
+
+        return messages;
+    }
+}
+
+TEST_CASE("send_queue")
+{
+    net::send_queue queue;
+
+    SECTION("Empty queues must not return any message")
+    {
+        REQUIRE(queue.empty());
+        REQUIRE(queue.pop() == nullptr);
+    }
+
+    SECTION("Messages within a lane must be sent in order")
+    {
+        queue.push(make_message("a"));
+        queue.push(make_message("b"));
+        queue.push(make_message("c"));
+
+        REQUIRE(queue.size(net::send_priority::Normal) == 3);
+        REQUIRE(drain(queue) == std::vector<std::string>{"a", "b", "c"});
+        REQUIRE(queue.empty());
+    }
+
+    SECTION("High priority messages must always be sent first")
+    {
+        queue.push(make_message("low"), net::send_priority::Low);
+        queue.push(make_message("normal"), net::send_priority::Normal);
+        queue.push(make_message("high"), net::send_priority::High);
+
+        REQUIRE(drain(queue) == std::vector<std::string>{"high", "normal", "low"});
+    }
+
+    SECTION("Normal and Low messages must share the queue by weight")
+    {
+        queue.set_weights(2, 1);
+
+        for (int i = 0; i < 3; ++i)
+            queue.push(make_message("L"), net::send_priority::Low);
+
+        for (int i = 0; i < 5; ++i)
+            queue.push(make_message("N"), net::send_priority::Normal);
+
+        REQUIRE(drain(queue) == std::vector<std::string>{"N", "N", "L", "N", "N", "L", "N", "L"});
+    }
+
+    SECTION("Chunked payloads must be framed chunk by chunk and allow other messages in between")
+    {
+        std::vector<bool> last_flags;
+        queue.push_chunked(make_message("abcdefgh"), net::send_priority::Low, 3,
+                           [&](std::span<uint8_t const> chunk, bool last) {
+                               last_flags.push_back(last);
+                               return make_message("[" + std::string(chunk.begin(), chunk.end()) + "]");
+                           });
+
+        REQUIRE(queue.size(net::send_priority::Low) == 1);
+
+        auto first = queue.pop();
+        REQUIRE(std::string(first->begin(), first->end()) == "[abc]");
+
+        queue.push(make_message("urgent"), net::send_priority::High);
+
+        REQUIRE(drain(queue) == std::vector<std::string>{"urgent", "[def]", "[gh]"});
+        REQUIRE(last_flags == std::vector<bool>{false, false, true});
+    }
+}
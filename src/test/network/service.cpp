@@ -154,5 +154,51 @@ namespace ServiceTest
             REQUIRE(client.data == "Pong");
             REQUIRE(client.status == net::link_status::Up);
         }
+
+        SECTION("Services must count the traffic of their connections")
+        {
+            ServerService server;
+            server.start(host, port + 1);
+
+            ClientService client;
+            client.start(host, port + 1);
+
+            std::this_thread::sleep_for(std::chrono::milliseconds{20});
+
+            REQUIRE(client.data == "Pong");
+            REQUIRE(server.metrics().connections.value() == 1);
+            REQUIRE(server.metrics().bytes_received.value() == 4);
+            REQUIRE(server.metrics().bytes_sent.value() == 4);
+#ifdef KEYCAP_ROOT_LATENCY_METRICS
+            REQUIRE(server.metrics().send_latency.count() == 1);
+            REQUIRE(server.metrics().handler_time.count() == server.metrics().reads.value());
+#endif
+
+            size_t connections = 0;
+            server.metrics().for_each_connection([&](net::connection_metrics const& connection) {
+                REQUIRE(connection.bytes_received == 4);
+                REQUIRE(connection.writes == 1);
+                ++connections;
+            });
+
+            REQUIRE(connections == 1);
+        }
+
+        SECTION("Services must not record latencies if disabled")
+        {
+            ServerService server;
+            server.metrics().record_latency(false);
+            server.start(host, port + 2);
+
+            ClientService client;
+            client.start(host, port + 2);
+
+            std::this_thread::sleep_for(std::chrono::milliseconds{20});
+
+            REQUIRE(client.data == "Pong");
+            REQUIRE(server.metrics().writes.value() == 1);
+            REQUIRE(server.metrics().send_latency.count() == 0);
+            REQUIRE(server.metrics().handler_time.count() == 0);
+        }
     }
 }
\ No newline at end of file
@@ -18,12 +18,15 @@
 #include <keycap/root/network/registered_message.hpp>
 #include <keycap/root/network/service_connection.hpp>
 #include <keycap/root/network/service_locator.hpp>
+#include <keycap/root/network/shm_transport.hpp>
 #include <keycap/root/utility/crc32.hpp>
 #include <keycap/root/utility/utility.hpp>
 
 #include <rapidcheck/catch.h>
 
+#include <atomic>
 #include <chrono>
+#include <filesystem>
 
 namespace net = keycap::root::network;
 namespace util = keycap::root::utility;
@@ -42,6 +45,7 @@ struct server_service : public net::service<connection>
     }
 
     net::link_status status = net::link_status::Down;
+    net::transport_kind transport = net::transport_kind::Tcp;
     std::string data;
 };
 
@@ -105,6 +109,447 @@ struct data_connection : public net::service_connection
     server_service<data_connection>& my_service_;
 };
 
+struct collecting_connection : public net::service_connection
+{
+    collecting_connection(boost::asio::ip::tcp::socket socket, net::service_base& service)
+      : service_connection{std::move(socket), service}
+      , my_service_{static_cast<server_service<collecting_connection>&>(service)}
+    {
+        router_.configure_inbound(this);
+    }
+
+    bool on_data(
+        net::data_router const& router, net::service_type service, uint64 sender, net::memory_stream& stream) override
+    {
+        my_service_.data += stream.get_string(stream.size());
+        return true;
+    }
+
+    bool on_link(net::data_router const& router, net::service_type service, net::link_status status) override
+    {
+        my_service_.status = status;
+        return true;
+    }
+
+  private:
+    server_service<collecting_connection>& my_service_;
+};
+
+// Supports connections within the same process
+struct local_connection : public net::service_connection
+{
+    local_connection(boost::asio::ip::tcp::socket socket, net::service_base& service)
+      : service_connection{std::move(socket), service}
+      , my_service_{static_cast<server_service<local_connection>&>(service)}
+    {
+        router_.configure_inbound(this);
+    }
+
+    local_connection(std::unique_ptr<net::transport> transport, net::service_base& service)
+      : service_connection{std::move(transport), service}
+      , my_service_{static_cast<server_service<local_connection>&>(service)}
+    {
+        router_.configure_inbound(this);
+    }
+
+    bool on_data(
+        net::data_router const& router, net::service_type service, uint64 sender, net::memory_stream& stream) override
+    {
+        my_service_.data += stream.get_string(stream.size());
+
+        stream.clear();
+        stream.put("Arrived");
+        send_answer(sender, stream);
+
+        return true;
+    }
+
+    bool on_link(net::data_router const& router, net::service_type service, net::link_status status) override
+    {
+        my_service_.status = status;
+        my_service_.transport = get_transport().kind();
+        return true;
+    }
+
+  private:
+    server_service<local_connection>& my_service_;
+};
+
+// Both ends of the compressed tests share a zlib codec using a dictionary of typical messages
+std::shared_ptr<keycap::root::compression::codec const> test_codec()
+{
+    namespace compression = keycap::root::compression;
+
+    std::string const content = "Foobar Arrived Foobar Arrived";
+    static std::shared_ptr<compression::codec const> const codec = compression::make_codec(
+        compression::codec_type::Zlib,
+        std::make_shared<compression::dictionary const>(std::vector<uint8_t>(content.begin(), content.end())));
+
+    return codec;
+}
+
+struct compressed_connection : public net::service_connection
+{
+    compressed_connection(boost::asio::ip::tcp::socket socket, net::service_base& service)
+      : service_connection{std::move(socket), service}
+      , my_service_{static_cast<server_service<compressed_connection>&>(service)}
+    {
+        router_.configure_inbound(this);
+        set_compression(test_codec());
+    }
+
+    bool on_data(
+        net::data_router const& router, net::service_type service, uint64 sender, net::memory_stream& stream) override
+    {
+        my_service_.data = stream.get_string(stream.size());
+
+        stream.clear();
+        stream.put("Arrived");
+        send_answer(sender, stream);
+
+        return true;
+    }
+
+    bool on_link(net::data_router const& router, net::service_type service, net::link_status status) override
+    {
+        my_service_.status = status;
+        return true;
+    }
+
+  private:
+    server_service<compressed_connection>& my_service_;
+};
+
+struct stream_compressed_connection : public net::service_connection
+{
+    stream_compressed_connection(boost::asio::ip::tcp::socket socket, net::service_base& service)
+      : service_connection{std::move(socket), service}
+      , my_service_{static_cast<server_service<stream_compressed_connection>&>(service)}
+    {
+        router_.configure_inbound(this);
+        enable_compression();
+    }
+
+    bool on_data(
+        net::data_router const& router, net::service_type service, uint64 sender, net::memory_stream& stream) override
+    {
+        my_service_.data += stream.get_string(stream.size());
+
+        stream.clear();
+        stream.put("Arrived");
+        send_answer(sender, stream);
+
+        return true;
+    }
+
+    bool on_link(net::data_router const& router, net::service_type service, net::link_status status) override
+    {
+        my_service_.status = status;
+        return true;
+    }
+
+  private:
+    server_service<stream_compressed_connection>& my_service_;
+};
+
+struct batch_counting_connection : public net::service_connection
+{
+    batch_counting_connection(boost::asio::ip::tcp::socket socket, net::service_base& service)
+      : service_connection{std::move(socket), service}
+    {
+    }
+
+    bool on_data(
+        net::data_router const& router, net::service_type service, uint64 sender, net::memory_stream& stream) override
+    {
+        data += stream.get_string(stream.size());
+        return true;
+    }
+
+    bool on_batch(
+        net::data_router const& router, net::service_type service,
+        std::span<net::registered_message> messages) override
+    {
+        batch_sizes.push_back(messages.size());
+        return service_connection::on_batch(router, service, messages);
+    }
+
+    bool on_link(net::data_router const& router, net::service_type service, net::link_status status) override
+    {
+        return true;
+    }
+
+    std::vector<size_t> batch_sizes;
+    std::string data;
+};
+
+TEST_CASE("service_connection")
+{
+    server_service<batch_counting_connection> service;
+    auto connection = std::make_shared<batch_counting_connection>(
+        boost::asio::ip::tcp::socket{service.io_context()}, service);
+    auto& handler = static_cast<net::message_handler&>(*connection);
+
+    auto make_frame = [](std::string const& str) {
+        net::registered_message msg;
+        msg.command = net::registered_command::Update;
+        msg.payload.put(str);
+        msg.sign();
+        return msg.encode().to_vector();
+    };
+
+    SECTION("All messages within a single chunk must be dispatched as one batch")
+    {
+        std::vector<uint8_t> data;
+        for (std::string str : {"Foo", "Bar", "Baz"})
+        {
+            auto frame = make_frame(str);
+            data.insert(data.end(), frame.begin(), frame.end());
+        }
+
+        auto partial = make_frame("Qux");
+        data.insert(data.end(), partial.begin(), partial.begin() + 3);
+
+        REQUIRE(handler.on_data(connection->get_router(), net::service_type{0}, data));
+        REQUIRE(connection->batch_sizes == std::vector<size_t>{3});
+        REQUIRE(connection->data == "FooBarBaz");
+
+        REQUIRE(handler.on_data(
+            connection->get_router(), net::service_type{0}, std::span(partial.data() + 3, partial.size() - 3)));
+        REQUIRE(connection->batch_sizes == std::vector<size_t>{3, 1});
+        REQUIRE(connection->data == "FooBarBazQux");
+    }
+
+    SECTION("Batch frames must be expanded into the batch")
+    {
+        net::registered_batch batch;
+        for (std::string str : {"Foo", "Bar"})
+        {
+            net::memory_stream stream;
+            stream.put(str);
+            batch.add(0, net::registered_command::Update, stream);
+        }
+
+        auto data = batch.to_message().encode().to_vector();
+        auto frame = make_frame("Baz");
+        data.insert(data.end(), frame.begin(), frame.end());
+
+        REQUIRE(handler.on_data(connection->get_router(), net::service_type{0}, data));
+        REQUIRE(connection->batch_sizes == std::vector<size_t>{3});
+        REQUIRE(connection->data == "FooBarBaz");
+    }
+
+    SECTION("Compressed frames must be decompressed using the connection's codec")
+    {
+        connection->set_compression(test_codec());
+
+        net::registered_message msg;
+        msg.command = net::registered_command::Update;
+        msg.payload.put(std::string{"Foobar"});
+        msg.compress(*test_codec());
+        msg.sign();
+
+        auto data = msg.encode().to_vector();
+        REQUIRE(handler.on_data(connection->get_router(), net::service_type{0}, data));
+        REQUIRE(connection->data == "Foobar");
+    }
+
+    SECTION("Compressed frames must fail without a codec")
+    {
+        net::registered_message msg;
+        msg.command = net::registered_command::Update;
+        msg.payload.put(std::string{"Foobar"});
+        msg.compress(*test_codec());
+        msg.sign();
+
+        auto data = msg.encode().to_vector();
+        REQUIRE_FALSE(handler.on_data(connection->get_router(), net::service_type{0}, data));
+    }
+}
+
+TEST_CASE("registered_message compression")
+{
+    namespace compression = keycap::root::compression;
+
+    net::registered_message msg;
+    msg.sender = 42;
+    msg.command = net::registered_command::Request;
+    msg.payload.put(std::string{"Foobar Arrived"});
+
+    SECTION("Decompressing a compressed message must restore its command and payload")
+    {
+        msg.compress(*test_codec());
+        REQUIRE(msg.command.get() == net::registered_command::Compressed);
+
+        REQUIRE(msg.decompress(*test_codec()));
+        REQUIRE(msg.command.get() == net::registered_command::Request);
+        REQUIRE(msg.payload.get_string(msg.payload.size()) == "Foobar Arrived");
+    }
+
+    SECTION("Empty payloads must survive compression")
+    {
+        msg.payload.clear();
+        msg.compress(*test_codec());
+
+        REQUIRE(msg.decompress(*test_codec()));
+        REQUIRE(msg.payload.size() == 0);
+    }
+
+    SECTION("Decompressing with a different dictionary must fail")
+    {
+        // Too short payloads are stored uncompressed, which every codec accepts
+        msg.payload.clear();
+        for (int i = 0; i < 4; ++i)
+            msg.payload.put(std::string{"Foobar Arrived"});
+
+        msg.compress(*test_codec());
+        auto frame = msg.payload.to_span().subspan(sizeof(net::registered_command));
+        REQUIRE(compression::read_frame_header(frame)->codec == compression::codec_type::Zlib);
+
+        std::string const content = "Something else entirely";
+        auto other = compression::make_codec(
+            compression::codec_type::Zlib,
+            std::make_shared<compression::dictionary const>(std::vector<uint8_t>(content.begin(), content.end())));
+
+        REQUIRE_FALSE(msg.decompress(*other));
+    }
+
+    SECTION("Messages compressed through a policy must only be packed if it's worth it")
+    {
+        compression::compression_policy policy{test_codec()};
+
+        msg.compress(policy, 0);
+        REQUIRE(msg.command.get() == net::registered_command::Request);
+        REQUIRE(msg.payload.get_string(msg.payload.size()) == "Foobar Arrived");
+
+        msg.payload.clear();
+        for (int i = 0; i < 20; ++i)
+            msg.payload.put(std::string{"Foobar Arrived"});
+        auto data = msg.payload.to_span();
+        std::vector<uint8_t> payload(data.begin(), data.end());
+
+        msg.compress(policy, 0);
+        REQUIRE(msg.command.get() == net::registered_command::Compressed);
+        REQUIRE(msg.payload.size() < payload.size());
+
+        REQUIRE(msg.decompress(policy.get_codec()));
+        REQUIRE(msg.payload.to_vector() == payload);
+
+        REQUIRE(policy.statistics().skipped_small == 1);
+        REQUIRE(policy.statistics().compressed == 1);
+    }
+
+    SECTION("Payloads stored uncompressed must be restored by any codec")
+    {
+        msg.compress(*test_codec());
+        auto frame = msg.payload.to_span().subspan(sizeof(net::registered_command));
+        REQUIRE(compression::read_frame_header(frame)->codec == compression::codec_type::None);
+
+        REQUIRE(msg.decompress(*compression::make_codec(compression::codec_type::Zlib)));
+        REQUIRE(msg.payload.get_string(msg.payload.size()) == "Foobar Arrived");
+    }
+}
+
+TEST_CASE("registered_batch")
+{
+    SECTION("Unpacking a batch must yield all messages in the order they were added")
+    {
+        net::registered_batch batch;
+
+        for (std::string str : {"Foo", "Bar", "Baz"})
+        {
+            net::memory_stream stream;
+            stream.put(str);
+            batch.add(str.size(), net::registered_command::Update, stream);
+        }
+
+        REQUIRE(batch.count() == 3);
+
+        auto encoded = batch.to_message().encode();
+        auto msg = net::registered_message::decode(encoded);
+        REQUIRE(util::validate_crc32(msg.crc, msg.sender, msg.command, msg.payload));
+
+        auto messages = net::registered_batch::unpack(msg.payload);
+        REQUIRE(messages);
+        REQUIRE(messages->size() == 3);
+        REQUIRE((*messages)[0].payload.get_string(3) == "Foo");
+        REQUIRE((*messages)[1].payload.get_string(3) == "Bar");
+        REQUIRE((*messages)[2].payload.get_string(3) == "Baz");
+        REQUIRE((*messages)[2].sender == 3);
+    }
+
+    SECTION("Unpacking a truncated batch must fail")
+    {
+        net::memory_stream payload;
+        payload.put<uint32>(100);
+        payload.put<uint64>(0);
+
+        REQUIRE_FALSE(net::registered_batch::unpack(payload));
+    }
+}
+
+TEST_CASE("registered_message_reader")
+{
+    auto make_frame = [](uint64 sender, std::string const& str) {
+        net::registered_message msg;
+        msg.sender = sender;
+        msg.command = net::registered_command::Update;
+        msg.payload.put(str);
+        msg.sign();
+        return msg.encode().to_vector();
+    };
+
+    net::registered_message_reader reader;
+
+    SECTION("A message arriving byte by byte must be read once it is complete")
+    {
+        auto frame = make_frame(42, "Foobar");
+
+        for (size_t i = 0; i < frame.size(); ++i)
+        {
+            REQUIRE_FALSE(reader.can_read());
+            reader.put(std::span(frame.data() + i, 1));
+        }
+
+        REQUIRE(reader.can_read());
+
+        auto msg = reader.read();
+        REQUIRE(msg);
+        REQUIRE(msg->sender == 42);
+        REQUIRE(msg->payload.get_string(6) == "Foobar");
+        REQUIRE_FALSE(reader.can_read());
+    }
+
+    SECTION("Multiple messages within a single chunk must all be read")
+    {
+        auto data = make_frame(1, "Foo");
+        auto second = make_frame(2, "Barbaz");
+        auto third = make_frame(3, "Qux");
+        data.insert(data.end(), second.begin(), second.end());
+        data.insert(data.end(), third.begin(), third.begin() + 5);
+
+        reader.put(data);
+
+        REQUIRE(reader.read()->payload.get_string(3) == "Foo");
+        REQUIRE(reader.read()->payload.get_string(6) == "Barbaz");
+        REQUIRE_FALSE(reader.can_read());
+
+        reader.put(std::span(third.data() + 5, third.size() - 5));
+        REQUIRE(reader.read()->payload.get_string(3) == "Qux");
+    }
+
+    SECTION("A message with a mismatching checksum must be rejected")
+    {
+        auto frame = make_frame(1, "Foo");
+        frame.back() ^= 0xFF;
+
+        reader.put(frame);
+
+        REQUIRE(reader.can_read());
+        REQUIRE_FALSE(reader.read());
+    }
+}
+
 TEST_CASE("service_locator")
 {
     net::service_locator locator;
@@ -244,4 +689,255 @@ TEST_CASE("service_locator")
         REQUIRE(service.data == "Foobar");
         REQUIRE(received_data == "Arrived");
     }
-}
\ No newline at end of file
+
+    SECTION("Compressed registered messages must yield an answer if both ends share the codec")
+    {
+        std::string const host = "localhost";
+        uint16_t const port = 5575;
+        net::service_type const type{1};
+
+        server_service<compressed_connection> service;
+        service.start(host, port);
+
+        locator.set_compression(test_codec());
+        locator.locate(type, host, port);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+
+        net::memory_stream stream;
+        stream.put(std::string{"Foobar"});
+
+        std::string received_data;
+        locator.send_registered(
+            type, stream, service.io_context(), [&](net::service_type sender, net::memory_stream data) -> bool {
+                received_data = data.get_string(strlen("Arrived"));
+                return true;
+            });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+
+        REQUIRE(service.data == "Foobar");
+        REQUIRE(received_data == "Arrived");
+
+        // Too small to be worth compressing
+        REQUIRE(locator.compression_statistics().skipped_small == 1);
+    }
+
+    SECTION("Registered messages must yield answers over stream compressed links")
+    {
+        std::string const host = "localhost";
+        uint16_t const port = 5576;
+        net::service_type const type{1};
+
+        server_service<stream_compressed_connection> service;
+        service.start(host, port);
+
+        locator.set_stream_compression(6);
+        locator.locate(type, host, port);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+
+        std::atomic<int> answers = 0;
+        for (std::string str : {"Foo", "Bar", "Foo"})
+        {
+            net::memory_stream stream;
+            stream.put(str);
+
+            locator.send_registered(
+                type, stream, service.io_context(), [&](net::service_type sender, net::memory_stream data) -> bool {
+                    if (data.get_string(strlen("Arrived")) == "Arrived")
+                        ++answers;
+                    return true;
+                });
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{30});
+
+        REQUIRE(service.data == "FooBarFoo");
+        REQUIRE(answers == 3);
+    }
+
+    SECTION("Messages send within the flush window must arrive as individual messages")
+    {
+        std::string const host = "localhost";
+        uint16_t const port = 5572;
+        net::service_type const type{1};
+
+        server_service<collecting_connection> service;
+        service.start(host, port);
+
+        locator.locate(type, host, port);
+        locator.set_flush_window(std::chrono::milliseconds{5});
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+
+        for (std::string str : {"Foo", "Bar", "Baz"})
+        {
+            net::memory_stream stream;
+            stream.put(str);
+            locator.send_to(type, stream);
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{30});
+
+        REQUIRE(service.data == "FooBarBaz");
+    }
+
+    SECTION("Flushing a full batch early must not cut the flush window of the next batch short")
+    {
+        std::string const host = "localhost";
+        uint16_t const port = 5577;
+        net::service_type const type{1};
+
+        server_service<collecting_connection> service;
+        service.start(host, port);
+
+        locator.locate(type, host, port);
+        locator.set_flush_window(std::chrono::milliseconds{200});
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+
+        // Exceeds the maximum batch size and thus is sent right away
+        std::string const full(64 * 1024, 'x');
+        net::memory_stream stream;
+        stream.put(full);
+        locator.send_to(type, stream);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{100});
+
+        stream.clear();
+        stream.put(std::string{"Foo"});
+        locator.send_to(type, stream);
+
+        // The timer of the first batch has expired, the one of the second hasn't
+        std::this_thread::sleep_for(std::chrono::milliseconds{150});
+        REQUIRE(service.data == full);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{150});
+        REQUIRE(service.data == full + "Foo");
+    }
+
+    SECTION("Services within the same process must be located through a loopback_transport")
+    {
+        std::string const host = "localhost";
+        uint16_t const port = 5573;
+        net::service_type const type{1};
+
+        server_service<local_connection> service;
+        service.start(host, port);
+
+        locator.locate(type, host, port);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+
+        REQUIRE(service.status == net::link_status::Up);
+        REQUIRE(service.transport == net::transport_kind::Loopback);
+
+        net::memory_stream stream;
+        stream.put(std::string{"Foobar"});
+
+        std::string received_data;
+        locator.send_registered(
+            type, stream, service.io_context(), [&](net::service_type sender, net::memory_stream data) -> bool {
+                received_data = data.get_string(strlen("Arrived"));
+                return true;
+            });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+
+        REQUIRE(service.data == "Foobar");
+        REQUIRE(received_data == "Arrived");
+    }
+
+    SECTION("Services not supporting loopback_transports must be located through TCP")
+    {
+        std::string const host = "localhost";
+        uint16_t const port = 5574;
+        net::service_type const type{1};
+
+        server_service<collecting_connection> service;
+        service.start(host, port);
+
+        locator.locate(type, host, port);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+
+        REQUIRE(service.status == net::link_status::Up);
+
+        net::memory_stream stream;
+        stream.put(std::string{"Foo"});
+        locator.send_to(type, stream);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+
+        REQUIRE(service.data == "Foo");
+    }
+
+    SECTION("Services within the same process must be located through a loopback_transport for any endpoint")
+    {
+        auto const path = (std::filesystem::temp_directory_path() / "keycap-root-locator.sock").string();
+        net::service_type const type{1};
+
+        server_service<local_connection> service;
+        service.start(net::service_endpoint::shared_memory(path));
+
+        locator.locate(type, net::service_endpoint::shared_memory(path));
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+
+        REQUIRE(service.status == net::link_status::Up);
+        REQUIRE(service.transport == net::transport_kind::Loopback);
+    }
+
+    SECTION("Services must accept clients of other processes through unix domain sockets")
+    {
+        auto const path = (std::filesystem::temp_directory_path() / "keycap-root-unix.sock").string();
+
+        server_service<local_connection> service;
+        service.start(net::service_endpoint::unix_socket(path));
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+
+        boost::asio::io_context context;
+        boost::asio::local::stream_protocol::socket socket{context};
+        socket.connect(boost::asio::local::stream_protocol::endpoint{path});
+        net::unix_transport client{std::move(socket)};
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+
+        REQUIRE(service.status == net::link_status::Up);
+        REQUIRE(service.transport == net::transport_kind::Unix);
+    }
+
+#ifdef KEYCAP_ROOT_HAS_SHM_TRANSPORT
+    SECTION("Services must accept clients of other processes through shared memory")
+    {
+        auto const path = (std::filesystem::temp_directory_path() / "keycap-root-shm.sock").string();
+
+        server_service<local_connection> service;
+        service.start(net::service_endpoint::shared_memory(path));
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+
+        boost::asio::io_context context;
+        boost::asio::local::stream_protocol::socket socket{context};
+        socket.connect(boost::asio::local::stream_protocol::endpoint{path});
+
+        std::unique_ptr<net::transport> client;
+        boost::asio::co_spawn(
+            context,
+            [&]() -> boost::asio::awaitable<void> {
+                client = co_await net::shm_transport::connect(std::move(socket), 4096);
+            },
+            boost::asio::detached);
+
+        for (int i = 0; i < 50 && !client; ++i)
+            context.run_one_for(std::chrono::milliseconds{100});
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+
+        REQUIRE(service.status == net::link_status::Up);
+        REQUIRE(service.transport == net::transport_kind::SharedMemory);
+    }
+#endif
+}
@@ -18,8 +18,29 @@
 
 #include <rapidcheck/catch.h>
 
+#include <array>
+#include <numeric>
+#include <vector>
+
 namespace util = keycap::root::utility;
 
+namespace
+{
+    // Bitwise reference implementation of the reflected CRC with the given polynomial
+    uint32 reference_crc(uint32 polynomial, std::vector<uint8> const& data)
+    {
+        uint32 crc = ~uint32{0};
+        for (auto byte : data)
+        {
+            crc ^= byte;
+            for (int bit = 0; bit < 8; ++bit)
+                crc = (crc >> 1) ^ ((crc & 1) ? polynomial : 0);
+        }
+
+        return ~crc;
+    }
+}
+
 TEST_CASE("crc32")
 {
     SECTION("Hashing single string must yield a valid result")
@@ -38,4 +59,88 @@ TEST_CASE("crc32")
         REQUIRE(0x4A17B156 == util::crc32(std::string("Hello"), ' ', std::string("World")));
         REQUIRE(0x4A17B156 == util::crc32(std::string("Hello"), ' ', std::string("World")));
     }
+
+    SECTION("Known check values must be reproduced")
+    {
+        std::string const check = "123456789";
+
+        REQUIRE(util::crc32_update(0, check.data(), check.size()) == 0xCBF43926);
+        REQUIRE(util::crc32c_update(0, check.data(), check.size()) == 0xE3069283);
+        REQUIRE(util::checksum(util::checksum_algorithm::Crc32c, check) == 0xE3069283);
+    }
+
+    SECTION("Accelerated checksums must match the reference implementation for all sizes and alignments")
+    {
+        std::vector<uint8> buffer(4096 + 16);
+        std::iota(buffer.begin(), buffer.end(), uint8{7});
+
+        constexpr std::array<size_t, 4> offsets{0, 1, 3, 8};
+        constexpr std::array<size_t, 12> sizes{0, 1, 15, 16, 63, 64, 65, 127, 128, 200, 1000, 4096};
+
+        for (auto offset : offsets)
+        {
+            for (auto size : sizes)
+            {
+                std::vector<uint8> data(buffer.data() + offset, buffer.data() + offset + size);
+
+                REQUIRE(util::crc32_update(0, data.data(), size) == reference_crc(0xEDB88320, data));
+                REQUIRE(util::crc32c_update(0, data.data(), size) == reference_crc(0x82F63B78, data));
+            }
+        }
+    }
+
+    SECTION("Continuing a checksum must yield the same result as checksumming all data at once")
+    {
+        std::vector<uint8> data(1000);
+        std::iota(data.begin(), data.end(), uint8{0});
+
+        for (auto algorithm : {util::checksum_algorithm::Crc32, util::checksum_algorithm::Crc32c})
+        {
+            auto expected = util::checksum_update(algorithm, 0, data.data(), data.size());
+            auto first = util::checksum_update(algorithm, 0, data.data(), 333);
+            auto crc = util::checksum_update(algorithm, first, data.data() + 333, data.size() - 333);
+
+            REQUIRE(crc == expected);
+        }
+    }
+
+    SECTION("Combining the checksums of two segments must yield the checksum of their concatenation")
+    {
+        std::vector<uint8> data(5000);
+        std::iota(data.begin(), data.end(), uint8{3});
+
+        constexpr std::array<size_t, 6> splits{0, 1, 64, 2500, 4999, 5000};
+
+        for (auto split : splits)
+        {
+            auto size2 = data.size() - split;
+
+            auto crc32 = util::crc32_update(0, data.data(), data.size());
+            auto crc32_1 = util::crc32_update(0, data.data(), split);
+            auto crc32_2 = util::crc32_update(0, data.data() + split, size2);
+            REQUIRE(util::crc32_combine(crc32_1, crc32_2, size2) == crc32);
+
+            auto crc32c = util::crc32c_update(0, data.data(), data.size());
+            auto crc32c_1 = util::crc32c_update(0, data.data(), split);
+            auto crc32c_2 = util::crc32c_update(0, data.data() + split, size2);
+            REQUIRE(util::crc32c_combine(crc32c_1, crc32c_2, size2) == crc32c);
+        }
+    }
+
+    SECTION("crc_stream must yield the same checksum as hashing all values at once")
+    {
+        std::string const hello = "Hello";
+        std::string const world = "World";
+
+        util::crc_stream stream;
+        stream.update(std::span(reinterpret_cast<uint8 const*>(hello.data()), hello.size()));
+        stream.put(' ');
+
+        util::crc_stream second;
+        second.update(world.data(), world.size());
+        stream.combine(second);
+
+        REQUIRE(stream.value() == 0x4A17B156);
+        REQUIRE(stream.size() == 11);
+    }
 }
\ No newline at end of file
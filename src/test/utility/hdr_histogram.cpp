@@ -0,0 +1,142 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/utility/hdr_histogram.hpp>
+
+#include <rapidcheck/catch.h>
+
+#include <thread>
+#include <vector>
+
+namespace util = keycap::root::utility;
+
+TEST_CASE("hdr_histogram")
+{
+    util::hdr_histogram histogram{3'600'000'000, 3};
+
+    SECTION("A just created histogram must not contain any values")
+    {
+        REQUIRE(histogram.count() == 0);
+        REQUIRE(histogram.min() == 0);
+        REQUIRE(histogram.max() == 0);
+        REQUIRE(histogram.value_at_percentile(99) == 0);
+    }
+
+    SECTION("Small values must be recorded exactly")
+    {
+        for (uint64 i = 0; i <= 2000; ++i)
+            histogram.record(i);
+
+        REQUIRE(histogram.count() == 2001);
+        REQUIRE(histogram.sum() == 2001 * 1000);
+        REQUIRE(histogram.min() == 0);
+        REQUIRE(histogram.max() == 2000);
+        REQUIRE(histogram.value_at_percentile(50) == 1000);
+        REQUIRE(histogram.value_at_percentile(100) == 2000);
+    }
+
+    SECTION("Percentiles must be within the requested precision")
+    {
+        for (uint64 i = 1; i <= 1'000'000; ++i)
+            histogram.record(i * 1000);
+
+        auto within = [](uint64 actual, uint64 expected) {
+            return actual >= expected && actual - expected <= expected / 1000;
+        };
+
+        REQUIRE(within(histogram.value_at_percentile(50), 500'000'000));
+        REQUIRE(within(histogram.value_at_percentile(99), 990'000'000));
+        REQUIRE(within(histogram.value_at_percentile(99.9), 999'000'000));
+        REQUIRE(histogram.value_at_percentile(100) == 1'000'000'000);
+    }
+
+    SECTION("Values above the highest trackable value must be recorded as the highest trackable value")
+    {
+        histogram.record(UINT64_MAX);
+
+        REQUIRE(histogram.count() == 1);
+        REQUIRE(histogram.max() == histogram.highest_trackable());
+        REQUIRE(histogram.equivalent(histogram.value_at_percentile(100), histogram.highest_trackable()));
+    }
+
+    SECTION("Merging histograms must yield the same as recording all values into a single one")
+    {
+        util::hdr_histogram other{3'600'000'000, 2};
+        util::hdr_histogram combined{3'600'000'000, 3};
+
+        for (uint64 i = 1; i <= 1000; ++i)
+        {
+            histogram.record(i * 7);
+            other.record(i * 11);
+            combined.record(i * 7);
+            combined.record(i * 11);
+        }
+
+        histogram.merge(other);
+
+        REQUIRE(histogram.count() == combined.count());
+        REQUIRE(histogram.sum() == combined.sum());
+        REQUIRE(histogram.max() == combined.max());
+
+        // The merged values only keep the precision of the histogram they were recorded into
+        for (double percentile : {10.0, 50.0, 90.0, 99.0})
+        {
+            auto expected = combined.value_at_percentile(percentile);
+            auto actual = histogram.value_at_percentile(percentile);
+            REQUIRE(actual <= expected + expected / 100);
+            REQUIRE(expected <= actual + actual / 100);
+        }
+    }
+
+    SECTION("Values must not get lost when recording from multiple threads")
+    {
+        std::vector<std::thread> threads;
+        for (uint64 i = 0; i < 8; ++i)
+        {
+            threads.emplace_back([&, i] {
+                for (uint64 j = 0; j < 10000; ++j)
+                    histogram.record(i * 1000 + j % 1000);
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        uint64 counted = 0;
+        histogram.for_each([&](uint64, uint64 count) { counted += count; });
+
+        REQUIRE(histogram.count() == 80000);
+        REQUIRE(counted == 80000);
+        REQUIRE(histogram.max() == 7999);
+    }
+
+    SECTION("Resetting a histogram must remove all values")
+    {
+        histogram.record(42);
+        histogram.reset();
+
+        REQUIRE(histogram.count() == 0);
+        REQUIRE(histogram.value_at_percentile(50) == 0);
+    }
+
+    rc::prop("Every recorded value must be equivalent to the value at its percentile", [](uint32 value) {
+        util::hdr_histogram single{};
+        single.record(value);
+
+        REQUIRE(single.equivalent(single.value_at_percentile(50), value));
+        REQUIRE(single.value_at_percentile(50) >= value);
+    });
+}
@@ -0,0 +1,61 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/utility/parallel.hpp>
+
+#include <rapidcheck/catch.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+namespace util = keycap::root::utility;
+
+TEST_CASE("parallel_for")
+{
+    SECTION("Every index must be visited exactly once")
+    {
+        std::vector<std::atomic_int> visits(1000);
+        util::parallel_for(visits.size(), 4, [&](size_t i) { ++visits[i]; });
+
+        for (auto& visit : visits)
+            REQUIRE(visit == 1);
+    }
+
+    SECTION("Nothing must be called without any indices")
+    {
+        bool called = false;
+        util::parallel_for(0, 4, [&](size_t) { called = true; });
+
+        REQUIRE_FALSE(called);
+    }
+
+    SECTION("Exceptions must be rethrown on the calling thread")
+    {
+        auto f = [](size_t i) {
+            if (i == 42)
+                throw std::runtime_error{"Failed"};
+        };
+
+        REQUIRE_THROWS_AS(util::parallel_for(100, 4, f), std::runtime_error);
+    }
+
+    SECTION("A thread count of 0 must use at least one thread")
+    {
+        REQUIRE(util::thread_count(0) >= 1);
+        REQUIRE(util::thread_count(3) == 3);
+    }
+}
@@ -0,0 +1,78 @@
+/*
+    Copyright 2017 KeycapEmu
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <keycap/root/utility/spsc_ring.hpp>
+
+#include <rapidcheck/catch.h>
+
+#include <numeric>
+#include <thread>
+#include <vector>
+
+namespace util = keycap::root::utility;
+
+TEST_CASE("spsc_ring")
+{
+    SECTION("The capacity must be rounded up to the next power of two")
+    {
+        REQUIRE(util::spsc_ring{100}.capacity() == 128);
+        REQUIRE(util::spsc_ring{128}.capacity() == 128);
+    }
+
+    SECTION("Writes must not exceed the capacity and reads must wrap around")
+    {
+        util::spsc_ring ring{8};
+        std::vector<uint8_t> data{1, 2, 3, 4, 5, 6};
+        std::vector<uint8_t> buffer(6);
+
+        REQUIRE(ring.write(data) == 6);
+        REQUIRE(ring.read(std::span(buffer).first(4)) == 4);
+        REQUIRE(ring.write(data) == 6);
+        REQUIRE(ring.write(data) == 0);
+        REQUIRE(ring.size() == 8);
+
+        REQUIRE(ring.read(buffer) == 6);
+        REQUIRE(buffer == std::vector<uint8_t>{5, 6, 1, 2, 3, 4});
+        REQUIRE(ring.read(buffer) == 2);
+        REQUIRE(ring.empty());
+    }
+
+    SECTION("Data must be transferred between threads in order")
+    {
+        util::spsc_ring ring{64};
+
+        std::vector<uint8_t> data(100000);
+        std::iota(data.begin(), data.end(), uint8_t{0});
+
+        std::thread producer{[&] {
+            std::span<uint8_t const> remaining = data;
+            while (!remaining.empty())
+                remaining = remaining.subspan(ring.write(remaining.first(std::min<size_t>(remaining.size(), 48))));
+        }};
+
+        std::vector<uint8_t> received;
+        std::vector<uint8_t> buffer(40);
+        while (received.size() < data.size())
+        {
+            auto size = ring.read(buffer);
+            received.insert(received.end(), buffer.begin(), buffer.begin() + static_cast<ptrdiff_t>(size));
+        }
+
+        producer.join();
+
+        REQUIRE(received == data);
+    }
+}